@@ -18,11 +18,18 @@
 /* ******************** HEADER (INCLUDE) SECTION ******************* */
 #include "qemu-common.h"
 #include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/main-loop.h"
 #include "hw/hw.h"
 #include "sysemu/sysemu.h"
 #include "e500-ccsr.h"
 #include "hw/sysbus.h"
+#include "qapi/error.h"
+#include "qapi/visitor.h"
+#include "exec/address-spaces.h"
 #include "hw/ppc/mpc8560_cpm.h"
+#include "hw/ppc/mpc8560_cpm_bd.h"
+#include <zlib.h>
 
 /* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
 //#define DEBUG_CPM
@@ -95,6 +102,77 @@
 #define SCCE_TX_SHIFT		(1)
 #define SCCE_TX_MASK		(1 << SCCE_TX_SHIFT)
 #define SCCE_RX_MASK		(1)
+#define SCCE_CCR_MASK		(0x0008)	/* UART, control character rejected */
+#define SCCE_BRKS_MASK		(0x0020)	/* UART, break start */
+#define SCCE_BRKE_MASK		(0x0040)	/* UART, break end */
+#define SCCE_TXE_MASK		(0x0010)	/* BISYNC, HDLC, transmit error */
+
+#define SCC_RXBD_OV			(0x0002)	/* receive overrun, every SCC mode */
+#define SCC_TXBD_UN			(0x0002)	/* BISYNC, HDLC, transmit underrun */
+#define SCC_TXBD_CT			(0x0001)	/* UART, CTS lost, its only transmit error */
+
+#define TODR_TOD			(0x8000)	/* transmit on demand */
+#define SCC_BD_POLL_MIN_NS	(100 * 1000)	/* about a character at 115200 baud */
+#define SCC_BD_POLL_MAX_NS	(4 * 1000 * 1000)
+
+#define GSMR_L_MODE(gsmr)	((gsmr) & 0xf)	/* GSMR_L[MODE] */
+#define GSMR_L_ENT			(0x00000010)
+#define GSMR_L_ENR			(0x00000020)
+#define GSMR_MODE_HDLC		(0x0)
+#define GSMR_MODE_UART		(0x4)
+#define GSMR_MODE_BISYNC	(0x8)
+
+#define PSMR_CL(psmr)		(((psmr) >> 12) & 0x3)	/* UART, 5 + CL data bits */
+#define PSMR_UM(psmr)		(((psmr) >> 10) & 0x3)	/* UART mode */
+#define PSMR_UM_NORMAL		(0)
+#define PSMR_UM_MANUAL		(1)	/* manual multidrop, every address is received */
+#define PSMR_UM_AUTO		(3)	/* automatic multidrop, UADDR1/2 are matched */
+#define PSMR_PEN			(0x0010)
+#define PSMR_RPM(psmr)		(((psmr) >> 2) & 0x3)	/* receive parity */
+#define UART_RPM_ODD		(0)
+#define UART_RPM_LOW		(1)
+#define UART_RPM_EVEN		(2)
+#define UART_RPM_HIGH		(3)
+
+#define UART_CHAR_E			(0x8000)	/* CHARACTERn, entry not valid, end of table */
+#define UART_CHAR_R			(0x4000)	/* CHARACTERn, reject, goes to RCCR only */
+#define UART_RCCM_VALID		(0xc000)	/* RCCM upper bits, set once the table is set up */
+
+#define UART_RXBD_C			(0x0800)	/* closed on a control character */
+#define UART_RXBD_A			(0x0400)	/* buffer starts with an address */
+#define UART_RXBD_AM		(0x0080)	/* ... that matched UADDR1 */
+#define UART_RXBD_BR		(0x0020)	/* closed on a break */
+#define UART_RXBD_PR		(0x0008)	/* parity error in the last character */
+#define UART_RXBD_STATUS	(UART_RXBD_C | UART_RXBD_A | UART_RXBD_AM | UART_RXBD_BR | UART_RXBD_PR)
+
+#define PSMR_BSC_CRC(psmr)	(((psmr) >> 10) & 0x3)	/* BISYNC, block check */
+#define BSC_BCS_CRC16		(1)
+#define BSC_BCS_LRC_EVEN	(2)
+#define BSC_BCS_LRC_ODD		(3)
+#define PSMR_BSC_RBCS		(0x0200)	/* receive BCS enable */
+#define PSMR_BSC_RTR		(0x0100)	/* receiver transparent */
+
+#define BSC_CHAR_V			(0x8000)	/* BSYNC, BDLE valid */
+#define BSC_CHAR_B			(0x2000)	/* CHARACTERn, a BCS follows */
+#define BSC_CHAR_H			(0x1000)	/* CHARACTERn, hunt for SYNC afterwards */
+
+#define BSC_RXBD_L			(0x0800)	/* closed on a control character */
+#define BSC_RXBD_CR			(0x0004)	/* BCS error */
+#define BSC_RXBD_STATUS		(BSC_RXBD_L | BSC_RXBD_CR)
+
+#define BSC_TXBD_TB			(0x0400)	/* BCS after this buffer, with L */
+#define BSC_TXBD_BR			(0x0200)	/* BCS reset before this buffer */
+#define BSC_TXBD_TR			(0x0100)	/* transparent, DLE goes out doubled */
+
+#define UART_RX_STORE		(0x1)	/* character goes into the buffer */
+#define UART_RX_CLOSE		(0x2)	/* buffer is closed after it */
+#define UART_RX_OPEN		(0x4)	/* character starts a buffer of its own */
+
+#define GSMR_L_DIAG(gsmr)	(((gsmr) >> 6) & 0x3)	/* GSMR_L[DIAG] */
+#define SCC_DIAG_NORMAL		(0)
+#define SCC_DIAG_LOOPBACK	(1)	/* TX feeds RX, TXD idle */
+#define SCC_DIAG_ECHO		(2)	/* RXD is retransmitted on TXD */
+#define SCC_DIAG_LOOP_ECHO	(3)	/* both, the external line only sees its own data back */
 
 #define CPCR_RST_SHIFT		(31)
 #define CPCR_RST_MASK		((1) << (CPCR_RST_SHIFT))
@@ -105,18 +183,254 @@
 #define CPCR_FLG_SHIFT		(16)
 #define CPCR_FLG_MASK		((1) << (CPCR_FLG_SHIFT))
 #define CPCR_OPCODE_MASK	(0xf)
+
+#define SIVEC_CODE_SHIFT	(26)
+
+#define CP_WORK_FCC_TX(f)	(0x00000002 << (f))	/* FTODR[TOD] or GFMR[ENT], see mpc8560_cpm_cp_kick() */
+#define CP_WORK_SCC_TX(n)	(0x00000010 << (n))	/* TODR[TOD] */
+#define CP_WORK_SCC_RX(n)	(0x00000100 << (n))	/* SCCE[RX] acknowledged while the RxBDs ran out */
+
+#define CPM_HAS(s, blk)		((s)->blocks & (1 << (blk)))
+
+/* Work per channel and CP pass, what is left over waits for the next pass */
+#define CP_BUDGET_FCC_TX	(16)	/* frames */
+#define CP_BUDGET_SCC_TX	(8)		/* TxBDs */
+
+#define SMEVR_BER			(0x00000001)	/* bus error, address in SMAER */
+#define SMCTR_RESET			(0x38000000)
+
+#define PCAPNG_SHB			(0x0a0d0d0a)
+#define PCAPNG_IDB			(0x00000001)
+#define PCAPNG_EPB			(0x00000006)
+#define PCAPNG_BYTE_ORDER	(0x1a2b3c4d)	/* written in host order, readers swap */
+#define PCAPNG_OPT_IF_NAME	(2)
+#define PCAPNG_OPT_EPB_FLAGS	(2)
+#define PCAPNG_EPB_INBOUND	(0x1)
+#define PCAPNG_EPB_OUTBOUND	(0x2)
+#define LINKTYPE_ETHERNET	(1)
+#define LINKTYPE_C_HDLC		(104)	/* Cisco HDLC framing, the closest fit for bare HDLC frames */
+#define LINKTYPE_USER0		(147)
+
+#define IOPORT_PIN_MASK(pin)	(0x80000000U >> (pin))
+#define IOPORT_REG_MASK		(0x1f)
+#define IOPORT_PC_INT_PINS	(0xffff0000U)	/* PC0 ~ PC15 can interrupt */
+#define SIEXR_EDPC(pin)		(0x80000000U >> (pin))	/* same layout as SIPNR_H, EDPC0 is the MSB */
+
+#define MDIO_PREAMBLE_BITS	(32)
+#define MDIO_CMD_BITS		(14)	/* ST(2) OP(2) PHYAD(5) REGAD(5) */
+#define MDIO_DATA_BITS		(16)
+#define MDIO_ST_01			(0x1)
+#define MDIO_OP_WRITE		(0x1)
+#define MDIO_OP_READ		(0x2)
+
+#define DPRAM_ADDR(off)		(MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1 + (off))
+#define MCC_PAGE(m)			(MPC8560_CCSRBAR_BASE + PG_MCC_1 + (0x100 * (m)))
+#define MCC_CH_PARAM(ch)	DPRAM_ADDR((ch) * MC_SIZE)
+
+#define CPCR_MCN_SHIFT		(6)
+#define CPCR_MCN_MASK		((0xff) << (CPCR_MCN_SHIFT))
+
+#define SI_MR_SAD(mr)		(((mr) >> 12) & 0x7)	/* starting bank of the routing table */
+#define SI_MR_CRT			(0x0040)	/* common receive and transmit routing */
+#define SI_GMR_EN(t)		(0x1 << (t))
+#define SI_CMDR_CSRR(t)		(0x80 >> (2 * (t)))
+#define SI_CMDR_CSRT(t)		(0x40 >> (2 * (t)))
+#define SI_STR_CRORR(t)		SI_CMDR_CSRR(t)	/* Rx of TDM t is routed by the shadow table */
+#define SI_STR_CRORT(t)		SI_CMDR_CSRT(t)
+#define SI_RSR_SSAD(rsr, t)	(((rsr) >> (12 - (4 * (t)))) & 0x7)	/* shadow starting bank */
+#define SI_RAM_RX			(0x400)
+
+#define SIRAM_MCC			(0x8000)
+#define SIRAM_MCSEL(e)		(((e) >> 5) & 0xff)
+#define SIRAM_CNT(e)		(((e) >> 2) & 0x7)
+#define SIRAM_BYT			(0x0002)
+#define SIRAM_LST			(0x0001)
+#define SIRAM_BITS(e)		((SIRAM_CNT(e) + 1) * (((e) & SIRAM_BYT) ? 8 : 1))
+
+#define CPM_TDM_FRAME_NS	(125000)
+
+#define CHAMR_MODE			(0x8000)	/* 1 = HDLC, 0 = transparent */
+#define CHAMR_CRC			(0x0080)	/* 1 = CRC-32 */
+
+#define MCC_BD_W			(0x2000)
+#define MCC_BD_I			(0x1000)
+#define MCC_TXBD_R			(0x8000)
+#define MCC_TXBD_L			(0x0800)
+#define MCC_RXBD_E			(0x8000)
+#define MCC_RXBD_L			(0x0800)
+#define MCC_RXBD_F			(0x0400)
+#define MCC_RXBD_LG			(0x0020)
+#define MCC_RXBD_NO			(0x0010)
+#define MCC_RXBD_AB			(0x0008)
+#define MCC_RXBD_CR			(0x0004)
+#define MCC_RXBD_STATUS		(MCC_RXBD_L | MCC_RXBD_F | MCC_RXBD_LG | MCC_RXBD_NO | MCC_RXBD_AB | MCC_RXBD_CR)
+
+#define MCC_INT_V			(0x80000000)
+#define MCC_INT_W			(0x40000000)
+#define MCC_INT_CHNUM_SHIFT	(20)
+#define MCC_EV_BSY			(0x0001)
+#define MCC_EV_RXF			(0x0002)
+#define MCC_EV_TXB			(0x0020)
+#define MCC_EV_UN			(0x0040)
+#define MCC_EV_RXB			(0x0080)
+
+#define MCCE_IQOV			(0x8000)
+#define MCCE_RINT0			(0x0800)
+#define MCCE_TINT			(0x0080)
+
+#define HDLC_FLAG			(0x7e)
+#define HDLC_CRC16_RESIDUE	(0xf0b8)
+#define HDLC_CRC32_RESIDUE	(0x2144df1c)
+
+#define FCC_PAGE(f)			(MPC8560_CCSRBAR_BASE + PG_FCC_1 + (0x100 * (f)))
+#define SCC_PG(n)			((TYPE_PRAM_PAGE)(PG_SCC_1 + (0x100 * (n))))
+#define SCC_PAGE(n)			(MPC8560_CCSRBAR_BASE + SCC_PG(n))
+#define PRAM_LOG_BASE		(PG_SCC_1 - CPM_BASE_DPRAM2)	/* dirty logged parameter pages, from DPRAM2 */
+#define PRAM_LOG_LEN		(PG_FCC_1 + (0x100 * CPM_NUM_FCC) - PG_SCC_1)
+#define GFMR_MODE_MASK		(0x0000000f)
+#define GFMR_MODE_ATM		(0xa)
+#define GFMR_ENR			(0x00000020)
+#define GFMR_ENT			(0x00000010)
+#define GFMR_MODE_ETH		(0xc)
+#define FCC_IS_ATM(p)		(((p)->gfmr & GFMR_MODE_MASK) == GFMR_MODE_ATM)
+#define FCC_IS_ETH(p)		(((p)->gfmr & GFMR_MODE_MASK) == GFMR_MODE_ETH)
+#define FPSMR_PRO			(0x00400000)	/* promiscuous */
+#define FPSMR_BRO			(0x00000200)	/* broadcast reject */
+#define FTODR_TOD			(0x8000)
+#define FCCE_ETH_GRA		(0x00800000)
+#define FCCE_ETH_TXE		(0x00100000)
+#define FCCE_ETH_RXF		(0x00080000)
+#define FCCE_ETH_BSY		(0x00040000)
+#define FCCE_ETH_TXB		(0x00020000)
+#define FCCE_ETH_RXB		(0x00010000)
+#define FCCE_ATM_IQOV0		(0x00000010)
+#define FCCE_ATM_GINT0		(0x00000001)
+
+#define ATM_INT_V			(0x80000000)
+#define ATM_INT_W			(0x40000000)
+#define ATM_INT_EV_SHIFT	(16)	/* channel number in the low half */
+#define ATM_EV_RXB			(0x0001)
+#define ATM_EV_RXF			(0x0002)
+#define ATM_EV_BSY			(0x0004)
+#define ATM_EV_TXB			(0x0008)
+#define ATM_EV_UN			(0x0010)
+
+#define ATM_BD_W			(0x2000)
+#define ATM_BD_I			(0x1000)
+#define ATM_BD_L			(0x0800)
+#define ATM_TXBD_R			(0x8000)
+#define ATM_RXBD_E			(0x8000)
+#define ATM_RXBD_F			(0x0400)
+#define ATM_RXBD_ABT		(0x0008)
+#define ATM_RXBD_CR			(0x0004)
+#define ATM_RXBD_LN			(0x0002)
+#define ATM_RXBD_STATUS		(ATM_BD_L | ATM_RXBD_F | ATM_RXBD_ABT | ATM_RXBD_CR | ATM_RXBD_LN)
+#define ATM_CT_AAL			(0x7)
+#define ATM_CT_AAL5			(0x1)
+
+#define ATM_HDR_PTI_AUU		(0x00000002)	/* last cell of a CPCS-PDU */
+#define ATM_HDR_VPVC(h)		(((h) >> 4) & 0x00ffffff)
+#define ATM_HEC_POLY		(0x07)
+#define ATM_HEC_COSET		(0x55)
+#define AAL5_CRC_POLY		(0x04c11db7)
+#define AAL5_CRC_RESIDUE	(0xc704dd7b)
+#define AAL5_TRAILER		(8)
+#define CPM_ATM_TICK_NS		(1000000)
+
+#define ETH_BD_R			(0x8000)
+#define ETH_BD_E			(0x8000)
+#define ETH_BD_W			(0x2000)
+#define ETH_BD_I			(0x1000)
+#define ETH_BD_L			(0x0800)
+#define ETH_TXBD_PAD		(0x4000)
+#define ETH_TXBD_STATUS		(0x03ff)	/* DEF HB LC RL RC UN CSL */
+#define ETH_TXBD_UN			(0x0002)
+#define ETH_TX_MAX_BDS		(256)	/* longest TxBD chain taken for one frame */
+#define ETH_RXBD_F			(0x0400)
+#define ETH_RXBD_M			(0x0100)	/* only taken because of FPSMR[PRO] */
+#define ETH_RXBD_BC			(0x0080)
+#define ETH_RXBD_MC			(0x0040)
+#define ETH_RXBD_LG			(0x0020)
+#define ETH_RXBD_OV			(0x0002)	/* overrun, here the frame data could not be written */
+#define ETH_RXBD_STATUS		(0x0dff)	/* L F M BC MC LG NO SH CR OV CL */
+#define ETH_HLEN			(14)
+#define ETH_MIN_FRAME		(60)	/* without FCS */
+#define ETH_FCS				(4)
+
+#define MII_BMCR			(0x00)
+#define MII_BMSR			(0x01)
+#define MII_PHYID1			(0x02)
+#define MII_PHYID2			(0x03)
+#define MII_ANAR			(0x04)
+#define MII_ANLPAR			(0x05)
+#define MII_BMCR_RESET		(0x8000)
+#define MII_BMCR_ANRESTART	(0x0200)
 /* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
+/* Fixed priority used to resolve SIVEC, highest first (see TYPE_INT_SRC_PRI) */
+static const uint8_t mpc8560_cpm_int_pri[] =
+{
+	IC_FCC_1, IC_FCC_2, IC_FCC_3, IC_MCC_1, IC_MCC_2,
+	IC_SCC_1, IC_SCC_2, IC_SCC_3, IC_SCC_4,
+	IC_PC_15, IC_TIMER_1, IC_PC_15 + 1, IC_PC_15 + 2,
+	IC_PC_15 + 3, IC_PC_15 + 4, IC_TIMER_2, IC_PC_15 + 5, IC_RISC_TB, IC_I2C,
+	IC_PC_15 + 6, IC_PC_15 + 7, IC_TIMER_3, IC_PC_15 + 8, IC_PC_15 + 9,
+	IC_PC_15 + 10, IC_TIMER_4, IC_PC_15 + 11, IC_SPI, IC_PC_15 + 12,
+	IC_PC_15 + 13, IC_PC_15 + 14, IC_PC_0, IC_SDMA,
+};
 
 /* ********************* FUNCTION PROTOTYPES *********************** */
+static void mpc8560_cpm_mdio_reset(CPMState* s);
+static void mpc8560_cpm_ioport_update(CPMState* s, int port);
+static void mpc8560_cpm_cp_cpcr_mcc_op(void* opaque);
+static void mpc8560_cpm_cp_cpcr_fcc_op(void* opaque);
+static void mpc8560_cpm_frame_rx_cb(CPMScc* c);
+static void mpc8560_cpm_uart_compile(CPMScc* c);
+static void mpc8560_cpm_pram_sync(CPMState* s);
+static void mpc8560_cpm_cp_kick(CPMState* s, uint32_t work);
+static void mpc8560_cpm_bsc_reset_bcs(CPMScc* c);
+static gboolean mpc8560_cpm_tdm_tx_watch_cb(GIOChannel* chan, GIOCondition cond, void* opaque);
 
 /* ************************* CODE SECTION ************************** */
+/* frames gathered for the MCC captures, before the channel table is cleared or freed */
+static void mpc8560_cpm_mcc_free_taps(CPMState* s)
+{
+	int i;
+
+	for (i = 0; i < s->mcc_ch_num; i++) {
+		if (s->mcc_ch[i].tx_tap)
+			g_byte_array_free( s->mcc_ch[i].tx_tap, TRUE );
+		else { /* QAC */ }
+		if (s->mcc_ch[i].rx_tap)
+			g_byte_array_free( s->mcc_ch[i].rx_tap, TRUE );
+		else { /* QAC */ }
+		s->mcc_ch[i].tx_tap = NULL;
+		s->mcc_ch[i].rx_tap = NULL;
+	}
+
+	return ;
+}
+
 static void mpc8560_cpm_reset_direct(void* opaque)
 {
 	CPMState* s = (CPMState*)opaque;
 	uint32_t ret;
+	int i;
+
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		/* recv_fifo trigger level */
+		s->scc[i].rx_fifo_itl = 1;
+		cpm_ring_reset( &(s->scc[i].rx_ring) );
+		cpm_ring_reset( &(s->scc[i].echo_ring) );
+		s->scc[i].uart_hunt = 0;
+		s->scc[i].uart_brk_pending = 0;
+		s->scc[i].rx_ov_pending = 0;
+		s->scc[i].rx_stalled = 0;
+		s->scc[i].tx_done = 0;
+		s->scc[i].tx_blocked = 0;
+	}
 
-	/* recv_fifo trigger level */
-	s->recv_fifo_itl_scc1 = 1;
+	/* queued channel work is dropped, the CP restarts idle */
+	s->cp_work = 0;
 	
 	/* Interrupt controller */
 	s->sicr	= 0x0;
@@ -132,25 +446,20 @@ static void mpc8560_cpm_reset_direct(void* opaque)
 	/* Clock */
 
 	/* ** Input/Output Port ** */
-	/* Port C */
-	s->pdirc = 0x0;
-	s->pparc = 0x0;
-	s->psorc = 0x0;
-	s->podrc = 0x0;
-	s->pdatc = 0x0;
-
-	/* Port D */
-	s->pdird = 0x0;
-	s->ppard = 0x0;
-	s->psord = 0x0;
-	s->podrd = 0x0;
-	s->pdatd = 0x0;
+	/* Port A ~ D, pin_in belongs to the board and survives reset */
+	for (i = 0; i < CPM_NUM_IOPORTS; i++) {
+		s->ioport[i].pdir = 0x0;
+		s->ioport[i].ppar = 0x0;
+		s->ioport[i].psor = 0x0;
+		s->ioport[i].podr = 0x0;
+		s->ioport[i].pdat = 0x0;
+		/* every pin is an input again, its line follows the board */
+		mpc8560_cpm_ioport_update(s, i);
+	}
 
 	/* BRGs 1 ~ 8 */
-	s->brgc1 = 0x0; /*  (0x919f0ULL) BRG1 configuration register / RW / 0x0000_0000 */
-	s->brgc2 = 0x0; /*  (0x919f4ULL) BRG2 configuration register / RW / 0x0000_0000 */
-	s->brgc3 = 0x0; /*  (0x919f8ULL) BRG3 configuration register / RW / 0x0000_0000 */
-	s->brgc4 = 0x0; /*  (0x919fcULL) BRG4 configuration register / RW / 0x0000_0000 */
+	for (i = 0; i < CPM_NUM_BRG; i++)
+		s->brgc[i] = 0x0;
 
 	/* Communications processor */
 	s->cpcr = 0x0;
@@ -161,24 +470,92 @@ static void mpc8560_cpm_reset_direct(void* opaque)
 	s->rtsr = 0x0;
 
 	/* ** SCCx ** */
-	s->gsmr_l1 = 0x0;
-	s->gsmr_h1 = 0x0;
-	s->psmr1 = 0x0;
-	s->todr1 = 0x0;
-	s->dsr1 = 0x7e7e;
-	s->scce1 = 0x0;
-	s->scc_resv1 = 0x0; /* Errata Rev. 1 */
-	s->sccm1 = 0x0;
-	s->sccs1 = 0x0;
-
-	s->gsmr_l2 = 0x0;
-	s->gsmr_h2 = 0x0;
-	s->psmr2 = 0x0;
-	s->todr2 = 0x0;
-	s->dsr2 = 0x7e7e;
-	s->scce2 = 0x0;
-	s->sccm2 = 0x0;
-	s->sccs2 = 0x0;
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		s->scc[i].gsmr_l = 0x0;
+		s->scc[i].gsmr_h = 0x0;
+		s->scc[i].psmr = 0x0;
+		s->scc[i].todr = 0x0;
+		s->scc[i].dsr = 0x7e7e;
+		s->scc[i].scce = 0x0;
+		s->scc[i].resv = 0x0; /* Errata Rev. 1 */
+		s->scc[i].sccm = 0x0;
+		s->scc[i].sccs = 0x0;
+		s->scc[i].irq_lat.pending = 0;	/* the histogram itself is kept */
+		s->scc[i].bsc_rx_dle = 0;
+		s->scc[i].bsc_rx_bcs = 0;
+		s->scc[i].bsc_tx_open = 0;
+		s->scc[i].bsc_tx_tail_len = 0;
+		mpc8560_cpm_uart_compile(&(s->scc[i]));
+	}
+	/* ENT and ENR are clear, the BD polls wait for GSMR_L */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		if (s->scc[i].bd_poll)
+			qemu_del_timer(s->scc[i].bd_poll);
+		else { /* QAC */ }
+	}
+
+	/* ** SDMA, the transfer counters survive a CP reset ** */
+	s->sdma.smaer = 0x0;
+	s->sdma.smevr = 0x0;
+	s->sdma.smctr = SMCTR_RESET;
+	s->sdma.lmaer = 0x0;
+	s->sdma.lmevr = 0x0;
+	s->sdma.lmctr = SMCTR_RESET;
+
+	/* ** SI 1 ~ 2, MCC 1 ~ 2 ** */
+	for (i = 0; i < CPM_NUM_SI; i++) {
+		memset(s->si[i].mr, 0, sizeof(s->si[i].mr));
+		s->si[i].gmr = 0x0;
+		s->si[i].cmdr = 0x0;
+		s->si[i].str = 0x0;
+		s->si[i].rsr = 0x0;
+		memset(s->si[i].txram, 0, sizeof(s->si[i].txram));
+		memset(s->si[i].rxram, 0, sizeof(s->si[i].rxram));
+		s->si[i].plan_dirty = 0xf;
+		s->mcc[i].mcce = 0x0;
+		s->mcc[i].mccm = 0x0;
+		s->mcc[i].mccf = 0x0;
+		s->mcc[i].irq_lat.pending = 0;	/* the histogram itself is kept */
+	}
+	if (s->mcc_ch) {
+		mpc8560_cpm_mcc_free_taps(s);
+		memset(s->mcc_ch, 0, s->mcc_ch_num * sizeof(CPMMccChannel));
+	} else { /* QAC */ }
+	if (s->tdm_timer)
+		qemu_del_timer(s->tdm_timer);
+	else { /* QAC */ }
+
+	/* ** FCC 1 ~ 3, TC Layer ** */
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		s->fcc[i].gfmr = 0x0;
+		s->fcc[i].fpsmr = 0x0;
+		s->fcc[i].ftodr = 0x0;
+		s->fcc[i].fdsr = 0x7e7e;
+		s->fcc[i].fcce = 0x0;
+		s->fcc[i].fccm = 0x0;
+		s->fcc[i].fccs = 0x0;
+		s->fcc[i].irq_lat.pending = 0;	/* the histogram itself is kept */
+		s->fcc[i].rx_cell_len = 0;
+		s->fcc[i].tx_rr = 0;
+		s->fcc[i].eth_rbd = 0;
+		s->fcc[i].eth_tbd = 0;
+		s->fcc[i].eth_gaddr = 0;
+		s->fcc[i].eth_iaddr = 0;
+		memset(s->fcc[i].eth_paddr, 0, sizeof(s->fcc[i].eth_paddr));
+		s->fcc[i].eth_mflr = 0;
+		if (s->fcc[i].atm_ch)
+			memset(s->fcc[i].atm_ch, 0, s->fcc[i].atm_ch_num * sizeof(CPMAtmChannel));
+		else { /* QAC */ }
+		if (s->fcc[i].atm_lookup)
+			g_hash_table_remove_all(s->fcc[i].atm_lookup);
+		else { /* QAC */ }
+	}
+	if (s->atm_timer)
+		qemu_del_timer(s->atm_timer);
+	else { /* QAC */ }
+	memset(s->tc, 0, sizeof(s->tc));
+	s->tcgsr = 0x0;
+	s->tcger = 0x0;
 
 	/* ****** CPM Mux ****** */
 	s->cmxsi1cr = 0x0;	/* (0x91b00ULL) CPM mux SI1 clock route register / RW / 0x00 */
@@ -209,10 +586,399 @@ static void mpc8560_cpm_reset(DeviceState* d)
 	CPMState* s = MPC8560_CPM(d);
 	DPRINTF("HIT");
 	mpc8560_cpm_reset_direct(s);
+	/* The PHY is a board part, CPCR[RST] does not reach it */
+	mpc8560_cpm_mdio_reset(s);
+
+	return ;
+}
+
+/**
+ * @fn static uint32_t* mpc8560_cpm_int_bit(CPMState* s, uint8_t code, uint32_t* mask, uint32_t** simr)
+ * @brief Locates the SIPNR/SIMR bit of an interrupt source code
+ *
+ */
+static uint32_t* mpc8560_cpm_int_bit(CPMState* s, uint8_t code, uint32_t* mask, uint32_t** simr)
+{
+	if (code >= IC_PC_15) { /* Port C lives in the high half, PC0 is the MSB, PC15 is bit 16 */
+		*mask = 1U << (code - 32);
+		*simr = &(s->simr_h);
+		return &(s->sipnr_h);
+	} else if (code >= IC_FCC_1) {
+		*mask = 1U << (63 - code);
+	} else {
+		*mask = 1U << (16 - code);
+	}
+	*simr = &(s->simr_l);
+
+	return &(s->sipnr_l);
+}
+
+/**
+ * @fn static void mpc8560_cpm_update_irq(CPMState* s)
+ * @brief Resolves SIVEC from pending and unmasked sources and drives the line
+ *
+ */
+static void mpc8560_cpm_update_irq(CPMState* s)
+{
+	uint32_t mask;
+	uint32_t* sipnr;
+	uint32_t* simr;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mpc8560_cpm_int_pri); i++) {
+		sipnr = mpc8560_cpm_int_bit(s, mpc8560_cpm_int_pri[i], &mask, &simr);
+		if (*sipnr & *simr & mask) {
+			s->sivec = mpc8560_cpm_int_pri[i] << SIVEC_CODE_SHIFT;
+			DPRINTF("IRQ RAISE code %d", mpc8560_cpm_int_pri[i]);
+			qemu_irq_raise(s->irq);
+			return ;
+		} else { /* QAC */ }
+	}
+
+	s->sivec = 0x0;
+	qemu_irq_lower(s->irq);
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_raise_int(CPMState* s, uint8_t code)
+ * @brief Latches an interrupt source into SIPNR
+ *
+ * Returns 1 when the source was not pending yet, so callers count each
+ * interrupt once however many events pile up behind it.
+ */
+static int mpc8560_cpm_raise_int(CPMState* s, uint8_t code)
+{
+	uint32_t mask;
+	uint32_t* simr;
+	uint32_t* sipnr = mpc8560_cpm_int_bit(s, code, &mask, &simr);
+	const int fresh = !(*sipnr & mask);
+
+	*sipnr = *sipnr | mask;
+	mpc8560_cpm_update_irq(s);
+
+	return fresh;
+}
+
+/**
+ * @fn static void mpc8560_cpm_clear_int(CPMState* s, uint8_t code)
+ * @brief Drops an interrupt source once its event register is clear
+ *
+ */
+static void mpc8560_cpm_clear_int(CPMState* s, uint8_t code)
+{
+	uint32_t mask;
+	uint32_t* simr;
+	uint32_t* sipnr = mpc8560_cpm_int_bit(s, code, &mask, &simr);
+
+	*sipnr = *sipnr & ~mask;
+	mpc8560_cpm_update_irq(s);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_sdma_fault(CPMState* s, hwaddr addr)
+ * @brief Latches the first faulting address and raises the SDMA interrupt
+ *
+ */
+static void mpc8560_cpm_sdma_fault(CPMState* s, hwaddr addr)
+{
+	CPMSdma* d = &(s->sdma);
+
+	if (!(d->smevr & SMEVR_BER))
+		d->smaer = addr;
+	else { /* QAC */ }
+	d->smevr = d->smevr | SMEVR_BER;
+	d->faults++;
+	mpc8560_cpm_raise_int(s, IC_SDMA);
+	DPRINTF("SDMA bus error at %" HWADDR_PRIx, addr); /* the guest sees SMEVR/SMAER, stats count it */
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_sdma_rw(CPMState* s, hwaddr addr, uint8_t* buf, hwaddr len, int is_write)
+ * @brief The one path between the channels and guest buffers
+ *
+ * RAM is copied straight through a mapping, anything else goes through the
+ * bounce buffer. Returns -1 without touching memory if any of it would miss.
+ */
+static int mpc8560_cpm_sdma_rw(CPMState* s, hwaddr addr, uint8_t* buf, hwaddr len, int is_write)
+{
+	CPMSdma* d = &(s->sdma);
+	hwaddr plen;
+	void* p;
+
+	if (!len)
+		return 0;
+	else { /* QAC */ }
+
+	if (!address_space_access_valid(&address_space_memory, addr, len, is_write)) {
+		mpc8560_cpm_sdma_fault(s, addr);
+		return -1;
+	} else { /* QAC */ }
+
+	d->xfers++;
+	d->bytes += len;
+	while (len > 0) {
+		plen = len;
+		p = cpu_physical_memory_map(addr, &plen, is_write);
+		if (!p || !plen) {
+			/* bounce buffer in use */
+			cpu_physical_memory_rw(addr, buf, len, is_write);
+			break;
+		} else { /* QAC */ }
+
+		if (is_write)
+			memcpy(p, buf, plen);
+		else
+			memcpy(buf, p, plen);
+		cpu_physical_memory_unmap(p, plen, is_write, plen);
+		addr += plen;
+		buf += plen;
+		len -= plen;
+	}
+
+	return 0;
+}
+
+static inline int mpc8560_cpm_sdma_read(CPMState* s, hwaddr addr, uint8_t* buf, hwaddr len)
+{
+	return mpc8560_cpm_sdma_rw(s, addr, buf, len, 0);
+}
+
+static inline int mpc8560_cpm_sdma_write(CPMState* s, hwaddr addr, const uint8_t* buf, hwaddr len)
+{
+	return mpc8560_cpm_sdma_rw(s, addr, (uint8_t*)buf, len, 1);
+}
+
+/**
+ * @fn static void mpc8560_cpm_tap_put(CPMState* s, TYPE_CPM_TAP tap, uint32_t ifid, int tx, const uint8_t* buf, uint32_t len)
+ * @brief Queues one pcapng enhanced packet block for the writer thread
+ *
+ * The data path only formats the block into the ring; a full ring loses the
+ * block rather than waiting on the file.
+ */
+static void mpc8560_cpm_tap_put(CPMState* s, TYPE_CPM_TAP tap, uint32_t ifid, int tx,
+		const uint8_t* buf, uint32_t len)
+{
+	static const uint8_t zero[4];
+	CPMTap* t = &(s->tap[tap]);
+	const uint32_t caplen = MIN(len, CPM_TAP_SNAPLEN);
+	const uint32_t pad = (4 - (caplen & 0x3)) & 0x3;
+	const uint16_t opt[2] = { PCAPNG_OPT_EPB_FLAGS, 4 };
+	uint32_t epb[7];
+	uint32_t tail[3];
+	uint64_t ts;
+
+	if (!t->on)
+		return ;
+	else { /* QAC */ }
+
+	epb[0] = PCAPNG_EPB;
+	epb[1] = sizeof(epb) + caplen + pad + sizeof(opt) + sizeof(tail);
+	if (cpm_ring_free(&(t->ring)) < epb[1]) {
+		t->dropped++;
+		return ;
+	} else { /* QAC */ }
+
+	ts = qemu_get_clock_ns(host_clock) / 1000;
+	epb[2] = ifid;
+	epb[3] = ts >> 32;
+	epb[4] = ts & 0xffffffff;
+	epb[5] = caplen;
+	epb[6] = len;
+	tail[0] = tx ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+	tail[1] = 0;	/* opt_endofopt */
+	tail[2] = epb[1];
+
+	cpm_ring_push(&(t->ring), (uint8_t*)epb, sizeof(epb));
+	cpm_ring_push(&(t->ring), buf, caplen);
+	cpm_ring_push(&(t->ring), zero, pad);
+	cpm_ring_push(&(t->ring), (const uint8_t*)opt, sizeof(opt));
+	cpm_ring_push(&(t->ring), (uint8_t*)tail, sizeof(tail));
+	/* only a writer that went idle on an empty ring needs the wakeup */
+	smp_mb();
+	if (atomic_xchg(&(t->idle), 0))
+		qemu_sem_post(&(t->sem));
+	else { /* QAC */ }
+
+	return ;
+}
+
+static void* mpc8560_cpm_tap_writer(void* opaque)
+{
+	CPMTap* t = (CPMTap*)opaque;
+	uint8_t buf[4096];
+	uint32_t n;
+
+	for (;;) {
+		n = cpm_ring_pop(&(t->ring), buf, sizeof(buf));
+		if (n) {
+			if (qemu_write_full(t->fd, buf, n) != (ssize_t)n) {
+				if (!atomic_read(&(t->werr)))
+					fprintf(stderr, "%s:%d] capture write failed (%s), blocks are lost from here.\n",
+							__func__, __LINE__, strerror(errno));
+				else { /* QAC */ }
+				atomic_inc(&(t->werr));
+			} else { /* QAC */ }
+			continue;
+		} else if (atomic_read(&(t->stop))) {
+			break;
+		} else { /* QAC */ }
+
+		/* announce the sleep, then look again so a block pushed meanwhile is not left behind */
+		atomic_set(&(t->idle), 1);
+		smp_mb();
+		if (cpm_ring_used(&(t->ring)) || atomic_read(&(t->stop))) {
+			/* whoever cleared idle first owes or takes the post, a spare one only costs a pass */
+			atomic_set(&(t->idle), 0);
+			continue;
+		} else { /* QAC */ }
+		qemu_sem_wait(&(t->sem));
+	}
+
+	return NULL;
+}
+
+/**
+ * @fn static void mpc8560_cpm_tap_idb(GByteArray* a, uint16_t linktype, const char* ifname)
+ * @brief Appends an interface description block
+ *
+ */
+static void mpc8560_cpm_tap_idb(GByteArray* a, uint16_t linktype, const char* ifname)
+{
+	const uint16_t namelen = strlen(ifname);
+	const uint32_t pad = (4 - (namelen & 0x3)) & 0x3;
+	const uint16_t head[2] = { linktype, 0 };
+	const uint16_t opt[2] = { PCAPNG_OPT_IF_NAME, namelen };
+	const uint32_t snaplen = CPM_TAP_SNAPLEN;
+	const uint32_t eoo = 0;
+	/* type, length, LinkType/reserved, SnapLen, if_name, opt_endofopt, length */
+	const uint32_t total = 8 + sizeof(head) + sizeof(snaplen) + sizeof(opt) + namelen + pad
+		+ sizeof(eoo) + sizeof(uint32_t);
+	const uint32_t hdr[2] = { PCAPNG_IDB, total };
+	static const uint8_t zero[4];
+
+	g_byte_array_append(a, (const guint8*)hdr, sizeof(hdr));
+	g_byte_array_append(a, (const guint8*)head, sizeof(head));
+	g_byte_array_append(a, (const guint8*)&snaplen, sizeof(snaplen));
+	g_byte_array_append(a, (const guint8*)opt, sizeof(opt));
+	g_byte_array_append(a, (const guint8*)ifname, namelen);
+	g_byte_array_append(a, zero, pad);
+	g_byte_array_append(a, (const guint8*)&eoo, sizeof(eoo));
+	g_byte_array_append(a, (const guint8*)&total, sizeof(total));
+
+	return ;
+}
+
+static void mpc8560_cpm_tap_stop(CPMState* s, TYPE_CPM_TAP tap)
+{
+	CPMTap* t = &(s->tap[tap]);
+
+	if (!t->on)
+		return ;
+	else { /* QAC */ }
+
+	/* the writer drains what is queued before it leaves, the file may be slow so the BQL is let go */
+	t->on = 0;
+	atomic_set(&(t->stop), 1);
+	qemu_sem_post(&(t->sem));
+	qemu_mutex_unlock_iothread();
+	qemu_thread_join(&(t->thread));
+	qemu_mutex_lock_iothread();
+	qemu_sem_destroy(&(t->sem));
+	cpm_ring_destroy(&(t->ring));
+	close(t->fd);
+	t->fd = -1;
 
 	return ;
 }
 
+/**
+ * @fn static int mpc8560_cpm_tap_start(CPMState* s, TYPE_CPM_TAP tap, const char* path)
+ * @brief Writes the section and interface blocks, then hands the file to a writer thread
+ *
+ * Link types follow the mode at the time capture starts: Ethernet for an FCC
+ * in Ethernet mode, HDLC for an SCC or MCC channel in HDLC mode, raw data
+ * (cells, bytes) everywhere else.
+ */
+static int mpc8560_cpm_tap_start(CPMState* s, TYPE_CPM_TAP tap, const char* path)
+{
+	const uint32_t shb[3] = { PCAPNG_SHB, 28, PCAPNG_BYTE_ORDER };
+	const uint16_t version[2] = { 1, 0 };
+	const int64_t seclen = -1;	/* unknown */
+	const uint32_t shb_total = 28;
+	CPMTap* t = &(s->tap[tap]);
+	GByteArray* a;
+	char* name;
+	int ok;
+	int ch;
+	int i;
+
+	t->fd = qemu_open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+	if (t->fd < 0)
+		return -errno;
+	else { /* QAC */ }
+
+	a = g_byte_array_new();
+	g_byte_array_append(a, (const guint8*)shb, sizeof(shb));
+	g_byte_array_append(a, (const guint8*)version, sizeof(version));
+	g_byte_array_append(a, (const guint8*)&seclen, sizeof(seclen));
+	g_byte_array_append(a, (const guint8*)&shb_total, sizeof(shb_total));
+	switch( tap ) {
+	case TAP_SCC_1:
+	case TAP_SCC_2:
+	case TAP_SCC_3:
+	case TAP_SCC_4:
+		name = g_strdup_printf("scc%d", tap - TAP_SCC_1 + 1);
+		mpc8560_cpm_tap_idb(a, (GSMR_L_MODE(s->scc[tap - TAP_SCC_1].gsmr_l) == GSMR_MODE_HDLC)
+				? LINKTYPE_C_HDLC : LINKTYPE_USER0, name);
+		g_free(name);
+		break;
+	case TAP_FCC_1:
+	case TAP_FCC_2:
+	case TAP_FCC_3:
+		name = g_strdup_printf("fcc%d", tap - TAP_FCC_1 + 1);
+		mpc8560_cpm_tap_idb(a, FCC_IS_ETH(&(s->fcc[tap - TAP_FCC_1])) ? LINKTYPE_ETHERNET : LINKTYPE_USER0, name);
+		g_free(name);
+		break;
+	case TAP_MCC_1:
+	case TAP_MCC_2:
+		/* interface n is channel n of the MCC */
+		for (i = 0; i < CPM_MCC_PER_MCC; i++) {
+			name = g_strdup_printf("mcc%d-ch%d", tap - TAP_MCC_1 + 1, i);
+			ch = ((tap - TAP_MCC_1) * CPM_MCC_PER_MCC) + i;
+			mpc8560_cpm_tap_idb(a, (lduw_phys(MCC_CH_PARAM(ch) + MC_CHAMR) & CHAMR_MODE) ? LINKTYPE_C_HDLC : LINKTYPE_USER0,
+					name);
+			g_free(name);
+		}
+		break;
+	default:
+		break;
+	}
+	ok = (qemu_write_full(t->fd, a->data, a->len) == (ssize_t)a->len);
+	g_byte_array_free(a, TRUE);
+	if (!ok) {
+		close(t->fd);
+		t->fd = -1;
+		return -EIO;
+	} else { /* QAC */ }
+
+	cpm_ring_create(&(t->ring), CPM_TAP_RING_LEN);
+	qemu_sem_init(&(t->sem), 0);
+	t->stop = 0;
+	t->idle = 0;
+	t->werr = 0;
+	t->dropped = 0;
+	qemu_thread_create(&(t->thread), mpc8560_cpm_tap_writer, t, QEMU_THREAD_JOINABLE);
+	t->on = 1;
+
+	return 0;
+}
+
 /**
  *
  *
@@ -226,51 +992,38 @@ static uint64_t mpc8560_cpm_default_read(void* opaque, hwaddr addr, unsigned siz
 	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
 
 	switch( addr ) {
-	/* Port C */
-	case BCTD(CPM_REG_PDIRC):	
-		ret = s->pdirc;	
-		break;
-	case BCTD(CPM_REG_PPARC):
-		ret = s->pparc;
-		break;
-	case BCTD(CPM_REG_PSORC):
-		ret = s->psorc;
-		break;
-	case BCTD(CPM_REG_PODRC):
-		ret = s->podrc;
+	/* SDMA */
+	case BCTD(CPM_REG_SMAER):
+		ret = s->sdma.smaer;
 		break;
-	case BCTD(CPM_REG_PDATC):
-		ret = s->pdatc;
+	case BCTD(CPM_REG_SMEVR):
+		ret = s->sdma.smevr;
 		break;
-	
-	/* Port D */
-	case BCTD(CPM_REG_PDIRD):
-		ret = s->pdird;
-		break;
-	case BCTD(CPM_REG_PPARD):
-		ret = s->ppard;
+	case BCTD(CPM_REG_SMCTR):
+		ret = s->sdma.smctr;
 		break;
-	case BCTD(CPM_REG_PSORD):
-		ret = s->psord;
+	case BCTD(CPM_REG_LMAER):
+		ret = s->sdma.lmaer;
 		break;
-	case BCTD(CPM_REG_PODRD):
-		ret = s->podrd;
+	case BCTD(CPM_REG_LMEVR):
+		ret = s->sdma.lmevr;
 		break;
-	case BCTD(CPM_REG_PDATD):
-		ret = s->pdatd;
+	case BCTD(CPM_REG_LMCTR):
+		ret = s->sdma.lmctr;
 		break;
-		/* BRGs 1 - 4 */	
+
+	/* BRGs 1 ~ 8 */
 	case BCTD(CPM_REG_BRGC1):
-		ret = s->brgc1;
-		break;
 	case BCTD(CPM_REG_BRGC2):
-		ret = s->brgc2;
-		break;
 	case BCTD(CPM_REG_BRGC3):
-		ret = s->brgc3;
-		break;
 	case BCTD(CPM_REG_BRGC4):
-		ret = s->brgc4;
+		ret = s->brgc[(addr - BCTD(CPM_REG_BRGC1)) >> 2];
+		break;
+	case BCTD(CPM_REG_BRGC5):
+	case BCTD(CPM_REG_BRGC6):
+	case BCTD(CPM_REG_BRGC7):
+	case BCTD(CPM_REG_BRGC8):
+		ret = s->brgc[4 + ((addr - BCTD(CPM_REG_BRGC5)) >> 2)];
 		break;
 	
 	/* ****** CPM Mux ****** */	
@@ -308,70 +1061,48 @@ static uint64_t mpc8560_cpm_default_read(void* opaque, hwaddr addr, unsigned siz
 static void mpc8560_cpm_default_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
 {
 	CPMState* s = (CPMState*)opaque;
+	int i;
 	
 	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
 	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
 	/* TODO : scale 'value' according to size?? */	
 	switch( addr ) {
-	/* Port C */
-	case BCTD(CPM_REG_PDIRC):
-		s->pdirc = value;
-		DPRINTF("pdirc -> %x", s->pdirc);
-		break;
-	case BCTD(CPM_REG_PPARC):
-		s->pparc = value;
-		DPRINTF("pparc -> %x", s->pparc);
-		break;
-	case BCTD(CPM_REG_PSORC):
-		s->psorc = value;
-		DPRINTF("psorc -> %x", s->psorc);
-		break;
-	case BCTD(CPM_REG_PODRC):
-		s->podrc = value;
-		DPRINTF("podrc -> %x", s->podrc);
+	/* SDMA */
+	case BCTD(CPM_REG_SMAER):	/* read only */
+	case BCTD(CPM_REG_LMAER):
 		break;
-	case BCTD(CPM_REG_PDATC):
-		s->pdatc = value;
-		DPRINTF("pdatc -> %x", s->pdatc);
+	case BCTD(CPM_REG_SMEVR):	/* cleared by writing ones */
+		s->sdma.smevr = s->sdma.smevr & ~(value);
+		if (!s->sdma.smevr)
+			mpc8560_cpm_clear_int(s, IC_SDMA);
+		else { /* QAC */ }
 		break;
-		/* Port D */
-	case BCTD(CPM_REG_PDIRD):
-		s->pdird = value;
-		DPRINTF("pdird -> %x", s->pdird);
+	case BCTD(CPM_REG_SMCTR):
+		s->sdma.smctr = value;
 		break;
-	case BCTD(CPM_REG_PPARD):
-		s->ppard = value;
-		DPRINTF("ppard -> %x", s->ppard);
+	case BCTD(CPM_REG_LMEVR):
+		s->sdma.lmevr = s->sdma.lmevr & ~(value);
 		break;
-	case BCTD(CPM_REG_PSORD):
-		s->psord = value;
-		DPRINTF("psord -> %x", s->psord);
+	case BCTD(CPM_REG_LMCTR):
+		s->sdma.lmctr = value;
 		break;
-	case BCTD(CPM_REG_PODRD):
-		s->podrd = value;
-		DPRINTF("podrd -> %x", s->podrd);
-		break;
-	case BCTD(CPM_REG_PDATD):
-		s->pdatd = value;
-		DPRINTF("pdatd -> %x", s->pdatd);
-		break;
-	
-	/* BRGs 1 - 4 */	
+
+	/* BRGs 1 ~ 8 */
 	case BCTD(CPM_REG_BRGC1):
-		s->brgc1 = value;
-		DPRINTF("brgc1 -> %x", s->brgc1);
-		break;
 	case BCTD(CPM_REG_BRGC2):
-		s->brgc2 = value;
-		DPRINTF("brgc2 -> %x", s->brgc2);
-		break;
 	case BCTD(CPM_REG_BRGC3):
-		s->brgc3 = value;
-		DPRINTF("brgc3 -> %x", s->brgc3);
-		break;
 	case BCTD(CPM_REG_BRGC4):
-		s->brgc4 = value;
-		DPRINTF("brgc4 -> %x", s->brgc4);
+		i = (addr - BCTD(CPM_REG_BRGC1)) >> 2;
+		s->brgc[i] = value;
+		DPRINTF("brgc%d -> %x", i + 1, s->brgc[i]);
+		break;
+	case BCTD(CPM_REG_BRGC5):
+	case BCTD(CPM_REG_BRGC6):
+	case BCTD(CPM_REG_BRGC7):
+	case BCTD(CPM_REG_BRGC8):
+		i = 4 + ((addr - BCTD(CPM_REG_BRGC5)) >> 2);
+		s->brgc[i] = value;
+		DPRINTF("brgc%d -> %x", i + 1, s->brgc[i]);
 		break;
 	
 	/* ****** CPM Mux ****** */	
@@ -407,24 +1138,352 @@ static void mpc8560_cpm_default_write(void* opaque, hwaddr addr, uint64_t value,
 }
 
 /**
+ * @fn static inline uint32_t mpc8560_cpm_ioport_pins(CPMIOPort* p)
+ * @brief Pin levels as seen through PDATx
+ *
+ */
+static inline uint32_t mpc8560_cpm_ioport_pins(CPMIOPort* p)
+{
+	/* Outputs read back the latch, open-drain outputs are wired-AND with the board */
+	return (p->pdat & p->pdir & ~(p->podr))
+		| (p->pdat & p->pin_in & p->pdir & p->podr)
+		| (p->pin_in & ~(p->pdir));
+}
+
+/**
+ * @fn static void mpc8560_cpm_ioport_update(CPMState* s, int port)
+ * @brief Delivers only those general purpose lines whose level has changed
  *
+ * Runs on every PDIRx/PPARx/PODRx/PDATx write and on board side changes,
+ * so pin_out never lags a pin that changed direction or drive type.
+ */
+static void mpc8560_cpm_ioport_update(CPMState* s, int port)
+{
+	CPMIOPort* p = &(s->ioport[port]);
+	/* Dedicated pins belong to their peripheral. Every other line carries the level PDATx
+	   reads back: an open-drain 1 is released to the board, and so is a pin turned input */
+	uint32_t gpio = ~(p->ppar) & ~(p->pin_claim);
+	uint32_t changed = (mpc8560_cpm_ioport_pins(p) ^ p->pin_out) & gpio;
+	int pin;
+
+	p->pin_out = p->pin_out ^ changed;
+	while (changed) {
+		pin = clz32(changed);
+		changed = changed & ~IOPORT_PIN_MASK(pin);
+		qemu_set_irq(s->ioport_out[(port * CPM_IOPORT_PINS) + pin],
+				!!(p->pin_out & IOPORT_PIN_MASK(pin)));
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_ioport_pc_int(CPMState* s, uint32_t old, uint32_t new)
+ * @brief Raises PC0 ~ PC15 interrupts for input pins that changed
  *
+ */
+static void mpc8560_cpm_ioport_pc_int(CPMState* s, uint32_t old, uint32_t new)
+{
+	CPMIOPort* p = &(s->ioport[IOPORT_C]);
+	uint32_t changed = (old ^ new) & ~(p->pdir) & IOPORT_PC_INT_PINS;
+	int pin;
+
+	while (changed) {
+		pin = clz32(changed);
+		changed = changed & ~IOPORT_PIN_MASK(pin);
+		/* EDPCx = 1 : high-to-low only, EDPCx = 0 : any change */
+		if ((s->siexr & SIEXR_EDPC(pin)) && (new & IOPORT_PIN_MASK(pin)))
+			continue;
+		else { /* QAC */ }
+		mpc8560_cpm_raise_int(s, IC_PC_0 - pin);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_ioport_set_pin(void* opaque, int n, int level)
+ * @brief gpio in handler, n = (port * 32) + pin
  *
  */
-static uint64_t mpc8560_cpm_intctrl_read(void* opaque, hwaddr addr, unsigned size)
+static void mpc8560_cpm_ioport_set_pin(void* opaque, int n, int level)
 {
-	uint32_t ret = 0;
 	CPMState* s = (CPMState*)opaque;
+	int port = n / CPM_IOPORT_PINS;
+	CPMIOPort* p = &(s->ioport[port]);
+	uint32_t mask = IOPORT_PIN_MASK(n % CPM_IOPORT_PINS);
+	uint32_t old = p->pin_in;
 
-	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
-	switch( addr ) {
-	case BCTI(CPM_REG_SICR):
-		ret = s->sicr;
-		break;
-	case BCTI(CPM_REG_SIVEC):
-		PARTIAL_READ(BCTI(CPM_REG_SIVEC), s->sivec, addr, size, ret);
-		break;
-	case BCTI(CPM_REG_SIPNR_H):
+	p->pin_in = level ? (old | mask) : (old & ~mask);
+	if (old == p->pin_in)
+		return ;
+	else { /* QAC */ }
+	if (port == IOPORT_C)
+		mpc8560_cpm_ioport_pc_int(s, old, p->pin_in);
+	else { /* QAC */ }
+	/* an input or an open-drain output passes the board level on */
+	mpc8560_cpm_ioport_update(s, port);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mdio_reset(CPMState* s)
+ * @brief Power-on state of the emulated PHY (link up, 100BASE-TX FD negotiated)
+ *
+ */
+static void mpc8560_cpm_mdio_reset(CPMState* s)
+{
+	CPMMdio* m = &(s->mdio);
+
+	memset(m->phy_regs, 0, sizeof(m->phy_regs));
+	m->phy_regs[MII_BMCR] = 0x1100;
+	m->phy_regs[MII_BMSR] = 0x786d;
+	m->phy_regs[MII_PHYID1] = 0x0013;
+	m->phy_regs[MII_PHYID2] = 0x78e2;
+	m->phy_regs[MII_ANAR] = 0x01e1;
+	m->phy_regs[MII_ANLPAR] = 0x45e1;
+
+	m->state = MDIO_ST_IDLE;
+	m->count = 0;
+	m->shift = 0;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mdio_phy_write(CPMMdio* m, uint8_t reg, uint16_t val)
+ * @brief
+ *
+ */
+static void mpc8560_cpm_mdio_phy_write(CPMMdio* m, uint8_t reg, uint16_t val)
+{
+	switch( reg ) {
+	case MII_BMCR: /* reset and restart bits are self clearing */
+		val = val & ~(MII_BMCR_RESET | MII_BMCR_ANRESTART);
+		break;
+	case MII_BMSR:
+	case MII_PHYID1:
+	case MII_PHYID2:
+	case MII_ANLPAR:
+		return ; /* read only */
+	default :
+		break;
+	}
+	m->phy_regs[reg] = val;
+	DPRINTF("phy reg %d -> %x", reg, val);
+
+	return ;
+}
+
+/**
+ * @fn static inline void mpc8560_cpm_mdio_drive(CPMState* s, int level)
+ * @brief PHY side of the MDIO line, 1 also means released (pulled up)
+ *
+ */
+static inline void mpc8560_cpm_mdio_drive(CPMState* s, int level)
+{
+	CPMMdio* m = &(s->mdio);
+	CPMIOPort* p = &(s->ioport[m->mdio_port]);
+
+	p->pin_in = level ? (p->pin_in | m->mdio_mask) : (p->pin_in & ~(m->mdio_mask));
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mdio_clock(CPMState* s)
+ * @brief Called for every MDC transition, samples and drives MDIO on rising edges
+ *
+ */
+static void mpc8560_cpm_mdio_clock(CPMState* s)
+{
+	CPMMdio* m = &(s->mdio);
+	uint32_t bit;
+	uint8_t phy;
+
+	if (!(s->ioport[m->mdc_port].pdat & m->mdc_mask))
+		return ; /* falling edge */
+	else { /* QAC */ }
+
+	switch( m->state ) {
+	case MDIO_ST_IDLE:
+		bit = mpc8560_cpm_ioport_pins(&(s->ioport[m->mdio_port])) & m->mdio_mask;
+		if (bit) {
+			m->count++;
+		} else if (m->count >= MDIO_PREAMBLE_BITS) {
+			/* first bit of ST */
+			m->state = MDIO_ST_CMD;
+			m->shift = 0;
+			m->count = 1;
+		} else {
+			m->count = 0;
+		}
+		break;
+	case MDIO_ST_CMD:
+		bit = mpc8560_cpm_ioport_pins(&(s->ioport[m->mdio_port])) & m->mdio_mask;
+		m->shift = (m->shift << 1) | !!bit;
+		if (++(m->count) < MDIO_CMD_BITS)
+			break;
+		else { /* QAC */ }
+
+		phy = (m->shift >> 5) & 0x1f;
+		m->reg = m->shift & 0x1f;
+		m->count = 0;
+		m->state = MDIO_ST_IDLE;
+		if (((m->shift >> 12) != MDIO_ST_01) || (phy != m->phy_addr)) {
+			DPRINTF("frame %x not for this PHY", m->shift);
+			break;
+		} else { /* QAC */ }
+
+		if (((m->shift >> 10) & 0x3) == MDIO_OP_READ) {
+			/* TA(0) followed by DATA, shifted out MSB first */
+			m->shift = m->phy_regs[m->reg];
+			m->count = MDIO_DATA_BITS + 1;
+			m->state = MDIO_ST_READ;
+		} else if (((m->shift >> 10) & 0x3) == MDIO_OP_WRITE) {
+			m->shift = 0;
+			m->state = MDIO_ST_WRITE;
+		} else { /* QAC */ }
+		break;
+	case MDIO_ST_READ:
+		if (m->count == 0) {
+			mpc8560_cpm_mdio_drive(s, 1);
+			m->state = MDIO_ST_IDLE;
+			m->count = 1;
+			break;
+		} else { /* QAC */ }
+		m->count--;
+		mpc8560_cpm_mdio_drive(s, (m->shift >> m->count) & 0x1);
+		break;
+	case MDIO_ST_WRITE:
+		bit = mpc8560_cpm_ioport_pins(&(s->ioport[m->mdio_port])) & m->mdio_mask;
+		m->shift = (m->shift << 1) | !!bit;
+		if (++(m->count) == (MDIO_DATA_BITS + 2)) { /* TA(10) + DATA */
+			mpc8560_cpm_mdio_phy_write(m, m->reg, m->shift & 0xffff);
+			m->state = MDIO_ST_IDLE;
+			m->count = 0;
+		} else { /* QAC */ }
+		break;
+	default :
+		m->state = MDIO_ST_IDLE;
+	}
+
+	return ;
+}
+
+/**
+ *
+ *
+ *
+ */
+static uint64_t mpc8560_cpm_ioport_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	uint32_t val;
+	CPMState* s = (CPMState*)opaque;
+	CPMIOPort* p = &(s->ioport[addr / 0x20]);
+	hwaddr base = addr & ~0x3;
+
+	switch( base & IOPORT_REG_MASK ) {
+	case BCTIO(CPM_REG_PDIRA):
+		val = p->pdir;
+		break;
+	case BCTIO(CPM_REG_PPARA):
+		val = p->ppar;
+		break;
+	case BCTIO(CPM_REG_PSORA):
+		val = p->psor;
+		break;
+	case BCTIO(CPM_REG_PODRA):
+		val = p->podr;
+		break;
+	case BCTIO(CPM_REG_PDATA):
+		val = mpc8560_cpm_ioport_pins(p);
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
+				__func__, __LINE__, (int)addr);
+		return ret;
+	}
+	PARTIAL_READ(base, val, addr, size, ret);
+
+	DPRINTF("opaque= %p, addr= %x, size= %x ret=%x", opaque, (uint32_t)addr, size, ret);
+	return ret;
+}
+
+/**
+ *
+ *
+ *
+ */
+static void mpc8560_cpm_ioport_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMState* s = (CPMState*)opaque;
+	int port = addr / 0x20;
+	CPMIOPort* p = &(s->ioport[port]);
+	hwaddr base = addr & ~0x3;
+	uint32_t* reg;
+	uint32_t old;
+
+	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
+	switch( base & IOPORT_REG_MASK ) {
+	case BCTIO(CPM_REG_PDIRA):
+		reg = &(p->pdir);
+		break;
+	case BCTIO(CPM_REG_PPARA):
+		reg = &(p->ppar);
+		break;
+	case BCTIO(CPM_REG_PSORA):
+		reg = &(p->psor);
+		break;
+	case BCTIO(CPM_REG_PODRA):
+		reg = &(p->podr);
+		break;
+	case BCTIO(CPM_REG_PDATA):
+		reg = &(p->pdat);
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
+				__func__, __LINE__, (int)addr, (unsigned)value);
+		return ;
+	}
+	old = *reg;
+	PARTIAL_WRITE(base, *reg, addr, size, value);
+	DPRINTF("port %c reg %x -> %x", 'A' + port, (uint32_t)(base & IOPORT_REG_MASK), *reg);
+
+	/* MDIO fast path, a bit-bang write that moves MDC is all the PHY cares about */
+	if ((port == s->mdio.mdc_port) && (reg == &(p->pdat)) && ((old ^ *reg) & s->mdio.mdc_mask))
+		mpc8560_cpm_mdio_clock(s);
+	else { /* QAC */ }
+
+	/* PSORx only selects the dedicated function, it never changes a driven level */
+	if (reg != &(p->psor))
+		mpc8560_cpm_ioport_update(s, port);
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ *
+ *
+ *
+ */
+static uint64_t mpc8560_cpm_intctrl_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	CPMState* s = (CPMState*)opaque;
+
+	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
+	switch( addr ) {
+	case BCTI(CPM_REG_SICR):
+		ret = s->sicr;
+		break;
+	case BCTI(CPM_REG_SIVEC):
+		PARTIAL_READ(BCTI(CPM_REG_SIVEC), s->sivec, addr, size, ret);
+		break;
+	case BCTI(CPM_REG_SIPNR_H):
 		ret = s->sipnr_h;
 		break;
 	case BCTI(CPM_REG_SIPNR_L):
@@ -444,7 +1503,8 @@ static uint64_t mpc8560_cpm_intctrl_read(void* opaque, hwaddr addr, unsigned siz
 		break;
 	case BCTI(CPM_REG_SIEXR):
 		ret = s->siexr;
-		default :
+		break;
+	default :
 		fprintf( stderr, "%s:%d] Unknown register raed: %x\n",
 				__func__, __LINE__, (int)addr);
 	}
@@ -477,10 +1537,12 @@ static void mpc8560_cpm_intctrl_write(void* opaque, hwaddr addr, uint64_t value,
 	case BCTI(CPM_REG_SIPNR_H): /* SIPNR bits are cleared by writing onces to them */
 		s->sipnr_h = s->sipnr_h & ~(value);
 		DPRINTF("sipnr_h -> %x", s->sipnr_h);
+		mpc8560_cpm_update_irq(s);
 		break;
 	case BCTI(CPM_REG_SIPNR_L):
 		s->sipnr_l = s->sipnr_l & ~(value);
 		DPRINTF("sipnr_l -> %x", s->sipnr_l);
+		mpc8560_cpm_update_irq(s);
 		break;
 	case BCTI(CPM_REG_SCPRR_H):
 		s->scprr_h = value;
@@ -493,17 +1555,20 @@ static void mpc8560_cpm_intctrl_write(void* opaque, hwaddr addr, uint64_t value,
 	case BCTI(CPM_REG_SIMR_H):
 		s->simr_h = value;
 		DPRINTF("simr_h -> %x", s->simr_h);
+		mpc8560_cpm_update_irq(s);
 		break;
 	case BCTI(CPM_REG_SIMR_L):
 		s->simr_l = value;
 		DPRINTF("simr_l -> %x", s->simr_l);
-		/* TODO : If the user sets the SIMR bit later, a previously pending interrupt request
-		   		is processed by the core, according to its assigned priority.
+		/* If the user sets the SIMR bit later, a previously pending interrupt request
+		   is processed by the core, according to its assigned priority.
 		*/
+		mpc8560_cpm_update_irq(s);
 		break;
 	case BCTI(CPM_REG_SIEXR):
 		s->siexr = value;
 		DPRINTF("siexr -> %x", s->siexr);
+		break;
 	
 	default :
 		fprintf( stderr, "%s:%d] Unknown register raed: %x\n",
@@ -561,6 +1626,7 @@ static uint64_t mpc8560_cpm_cp_read(void* opaque, hwaddr addr, unsigned size)
 static void mpc8560_cpm_scc_init_params_txrx(void* opaque)
 {
 	CPMState* s = (CPMState*)opaque;
+	CPMScc* c;
 	uint32_t t_val;
 	uint32_t page_idx = (s->cpcr & CPCR_PAGE_MASK) >> CPCR_PAGE_SHIFT;
 	const hwaddr t_base = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM2 + (0x100 * page_idx);
@@ -581,7 +1647,15 @@ static void mpc8560_cpm_scc_init_params_txrx(void* opaque)
 	t_val = lduw_phys(t_base + SR_RBASE);
 	stw_phys((t_base + SR_RBPTR), t_val);
 	stl_phys((t_base + SR_RSTATE), 0x0);
-	s->cur_rxbd_addr = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1 + t_val;
+	c = &(s->scc[page_idx]);
+	c->rxbd = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1 + t_val;
+
+	/* BISYNC block state */
+	c->bsc_rx_dle = 0;
+	c->bsc_rx_bcs = 0;
+	c->bsc_tx_open = 0;
+	c->bsc_tx_tail_len = 0;
+	mpc8560_cpm_bsc_reset_bcs(c);
 
 	DPRINTF("Initialized for page %d", page_idx);
 
@@ -597,6 +1671,7 @@ static void mpc8560_cpm_cp_cpcr_scc_op(void* opaque)
 {
 	CPMState* s = (CPMState*)opaque;
 	TYPE_CP_CMD_SCC op = s->cpcr & CPCR_OPCODE_MASK;
+	CPMScc* c = &(s->scc[((s->cpcr & CPCR_SBC_MASK) >> CPCR_SBC_SHIFT) - SC_SCC_1]);
 
 	/* Parsing OPCODE and process */
 	switch( op ) {
@@ -613,6 +1688,11 @@ static void mpc8560_cpm_cp_cpcr_scc_op(void* opaque)
 	case OP_ENTER_HUNT_MODE:
 		/* Issues a command to the channel to look for an IDLE or FLAG
 		   and ignore all incoming data */
+		if (GSMR_L_MODE(c->gsmr_l) == GSMR_MODE_BISYNC) {
+			c->uart_hunt = 1;
+			c->bsc_rx_dle = 0;
+			c->bsc_rx_bcs = 0;
+		} else { /* QAC */ }
 		break;
 	case OP_STOP_TX:
 		/* Tells the various transmit routines to take
@@ -628,6 +1708,8 @@ static void mpc8560_cpm_cp_cpcr_scc_op(void* opaque)
 	case OP_SET_GROUP_ADDRESS:
 		break;
 	case OP_RESET_BCS:
+		/* BISYNC, e.g. after SOH or STX, which are not part of the block check */
+		mpc8560_cpm_bsc_reset_bcs(c);
 		break;
 	default:
 		fprintf(stderr, "%s:%d] Unkown OPCODE.\n", __func__, __LINE__ );
@@ -636,6 +1718,66 @@ static void mpc8560_cpm_cp_cpcr_scc_op(void* opaque)
 	return ;
 }
 
+/**
+ * @fn static void mpc8560_cpm_instram_trace(CPMState* s)
+ * @brief Reports the instruction RAM ranges written since the last call
+ *
+ * Writes are collected by dirty logging, so a microcode download runs at
+ * RAM speed and is only looked at when the CP is told to use it.
+ */
+static void mpc8560_cpm_instram_trace(CPMState* s)
+{
+	hwaddr addr;
+	hwaddr start = CPM_SIZE_DPINSTRAM;	/* no dirty run open */
+
+	if (!s->instram_trace)
+		return ;
+	else { /* QAC */ }
+
+	memory_region_sync_dirty_bitmap( &(s->dpinstram) );
+
+	for (addr = 0; addr <= CPM_SIZE_DPINSTRAM; addr += CPM_INSTRAM_TRACE_GRAIN) {
+		if ((addr < CPM_SIZE_DPINSTRAM)
+				&& memory_region_get_dirty( &(s->dpinstram), addr, CPM_INSTRAM_TRACE_GRAIN, DIRTY_MEMORY_VGA )) {
+			if (start == CPM_SIZE_DPINSTRAM)
+				start = addr;
+			else { /* QAC */ }
+		} else if (start != CPM_SIZE_DPINSTRAM) {
+			fprintf( stderr, "%s:%d] instruction RAM written: %x ~ %x\n",
+					__func__, __LINE__, (unsigned)start, (unsigned)(addr - 1) );
+			start = CPM_SIZE_DPINSTRAM;
+		} else { /* QAC */ }
+	}
+	memory_region_reset_dirty( &(s->dpinstram), 0, CPM_SIZE_DPINSTRAM, DIRTY_MEMORY_VGA );
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_sbc_present(CPMState* s, TYPE_CPCR_SBC_CODE sbc)
+ * @brief Whether the sub-block a command addresses is modelled
+ *
+ */
+static int mpc8560_cpm_sbc_present(CPMState* s, TYPE_CPCR_SBC_CODE sbc)
+{
+	switch( sbc ) {
+	case SC_SCC_1:
+	case SC_SCC_2:
+	case SC_SCC_3:
+	case SC_SCC_4:
+		return CPM_HAS(s, BLK_SCC_1 + (sbc - SC_SCC_1));
+	case SC_FCC_1:
+	case SC_FCC_2:
+	case SC_FCC_3:
+		return CPM_HAS(s, BLK_FCC_1 + (sbc - SC_FCC_1));
+	case SC_MCC_1:
+	case SC_MCC_2:
+		return CPM_HAS(s, BLK_MCC_1 + (sbc - SC_MCC_1));
+	default :
+		return 1;
+	}
+}
+
 /**
  * @fn static void mpc8560_cpm_cp_cpcr_cb(void* opaque)
  * @brief
@@ -646,6 +1788,8 @@ static void mpc8560_cpm_cp_cpcr_cb(void* opaque)
 	CPMState* s = (CPMState*)opaque;
 	TYPE_CPCR_SBC_CODE sbc = (s->cpcr & CPCR_SBC_MASK) >> CPCR_SBC_SHIFT;
 
+	mpc8560_cpm_instram_trace(s);
+
 	/* Check RST and call mpc8560_cpm_reset() and clear RST, FLG both and return ? */
 	if (s->cpcr & CPCR_RST_MASK) {
 		mpc8560_cpm_reset_direct(opaque);
@@ -654,14 +1798,30 @@ static void mpc8560_cpm_cp_cpcr_cb(void* opaque)
 		return ; /* FIXME: confirm data sheet whether RST return immediately or not */
 	} else { /* QAC */ }
 
+	if (!mpc8560_cpm_sbc_present(s, sbc)) {
+		/* the block is left out, the command completes without effect */
+		s->cpcr = s->cpcr & ~(CPCR_FLG_MASK);
+		return ;
+	} else { /* QAC */ }
+
 	/* Parsing Sub-block code and process */
 	switch( sbc ) {
 	case SC_SCC_1:
 	case SC_SCC_2:
 	case SC_SCC_3:
 	case SC_SCC_4:
+		s->scc[sbc - SC_SCC_1].stats.commands++;
 		mpc8560_cpm_cp_cpcr_scc_op(opaque);
 		break;
+	case SC_MCC_1:
+	case SC_MCC_2:
+		mpc8560_cpm_cp_cpcr_mcc_op(opaque);
+		break;
+	case SC_FCC_1:
+	case SC_FCC_2:
+	case SC_FCC_3:
+		mpc8560_cpm_cp_cpcr_fcc_op(opaque);
+		break;
 	/* TODO: continued */
 	
 	default :
@@ -695,6 +1855,8 @@ static void mpc8560_cpm_cp_write(void* opaque, hwaddr addr, uint64_t value, unsi
 	case BCTCP(CPM_REG_RCCR):
 		s->rccr = value;
 		DPRINTF("rccr -> %x", s->rccr);
+		/* RCCR[ERAM] hands the downloaded microcode to the CP */
+		mpc8560_cpm_instram_trace(s);
 		break;
 	case BCTCP(CPM_REG_RTER):
 		s->rter = value;
@@ -720,776 +1882,5134 @@ static void mpc8560_cpm_cp_write(void* opaque, hwaddr addr, uint64_t value, unsi
 }
 
 /**
- * @fn static void mpc8560_cpm_set_irq(void* opaque)
- * @brief Interrupt Request Masking
+ * @fn static inline void mpc8560_cpm_lat_raise(CPMIrqLatency* l)
+ * @brief Stamps the first raise of an event line, further events until the guest clears it do not count
  *
  */
-static void mpc8560_cpm_set_irq(void* opaque)
+static inline void mpc8560_cpm_lat_raise(CPMIrqLatency* l)
 {
-	CPMState* s = (CPMState*)opaque;
-	uint16_t scce_masked;
-	/* (SCCE & SCCM) -> | INPUT -> (SIPNR & SIMR) -> Request to the core */
-	/* FIXME : process pending interrupts according to priority. currently only SCC1 */
-	s->sccm1 = s->sccm1 | (SCCE_TX_MASK | SCCE_RX_MASK); /* FIXME : temp. not initialized from USER */
-	/* Masking SCCE with SCCM */
-	scce_masked = s->scce1 & s->sccm1;
-	if ((scce_masked & SCCE_TX_MASK) || (scce_masked & SCCE_RX_MASK))
-		s->sipnr_l = s->sipnr_l | 0x00800000;
-	else { /* QAC */ }
-	if (!((s->sipnr_l & s->simr_l) & 0x00800000)) {
-		DPRINTF("TX or RX interrupts not allowed. SCCE %x SCCM %x sipnr_l %x simr_l %x", 
-				s->scce1, s->sccm1, s->sipnr_l, s->simr_l);
-		/* FIXME : clear SCCE[TX] ? */
-		return ;
+	if (!l->pending) {
+		l->pending = 1;
+		l->vm_raised = qemu_get_clock_ns(vm_clock);
+		l->host_raised = qemu_get_clock_ns(host_clock);
 	} else { /* QAC */ }
-	
-	/* TODO : Setting SCC1's Interrupt Vector here ? */
-	s->sivec = 0xa0000000; // 0x0b101000;
 
-	DPRINTF("IRQ RAISE~~~~~~");	
-	qemu_irq_raise(s->irq);
-	
 	return ;
 }
 
+static inline int mpc8560_cpm_lat_bucket(int64_t ns)
+{
+	if (ns < 2)
+		return 0;
+	else { /* QAC */ }
+
+	return MIN(63 - clz64(ns), CPM_LAT_BUCKETS - 1);
+}
+
 /**
- * @fn static void mpc8560_cpm_frame_tx_cb(void* opaque, TPYE_PRAM_PAGE page)
- * @brief handler for TX Ready	
- * @opaque - 
- * @page - 
+ * @fn static inline void mpc8560_cpm_lat_ack(CPMIrqLatency* l)
+ * @brief The guest cleared the last unmasked event, counts the time since the raise
+ *
  */
-static void mpc8560_cpm_frame_tx_cb(void* opaque, TYPE_PRAM_PAGE page)
+static inline void mpc8560_cpm_lat_ack(CPMIrqLatency* l)
 {
-	CPMState* s = (CPMState*)opaque;
+	if (l->pending) {
+		l->pending = 0;
+		l->vm_hist[mpc8560_cpm_lat_bucket(qemu_get_clock_ns(vm_clock) - l->vm_raised)]++;
+		l->host_hist[mpc8560_cpm_lat_bucket(qemu_get_clock_ns(host_clock) - l->host_raised)]++;
+	} else { /* QAC */ }
 
-	/* Copies buffer length from current TxBD to t_cnt, and
-	   copies starting address to t_ptr.
-	 */
-	hwaddr scc_tbptr = MPC8560_CCSRBAR_BASE + page + SR_TBPTR;
-	hwaddr txbd = MPC8560_CCSRBAR_BASE +  CPM_BASE_DPRAM1 + lduw_phys( scc_tbptr );
-	int32_t t_cnt = lduw_phys( txbd + 0x2 );
-	hwaddr t_ptr = ldl_phys( txbd + 0x4 );
-	uint32_t ch;
-	
-	DPRINTF("txbd = %lx, t_cnt = %d, t_ptr = %lx", txbd, t_cnt, t_ptr);
-	while (t_cnt > 0) {
-		ch = ldub_phys( t_ptr );
-		DPRINTF("Read ch = %c(0x%x) from addr = %lx, t_cnt = %d", (uint8_t)ch, (uint8_t)ch, t_ptr, t_cnt);
-		write( 1, &ch, 1 );
-		
-		/* Decrements t_cnt and increments t_ptr */
-		t_cnt--;
-		t_ptr++;
-	}
-	
-	/* Clears R bit after using TxBD */
-	s->bd_status = s->bd_status & ~(0x8000);
-
-	/* Set SCCE[TX] if I bit enabled */
-	if (s->bd_status & 0x1000) {
-	//	s->bd_status = s->bd_status & ~(0x1000); // temp inthandlr should do this
-
-		switch( page ) {
-		case PG_SCC_1:
-			s->scce1 = s->scce1 | SCCE_TX_MASK;
-			/* TODO : SIVEC should be touched after this modification */
-			mpc8560_cpm_set_irq(opaque);
-			break;
-		default:
-			fprintf( stderr, "%s:%d] Unkown page.\n", __func__, __LINE__ );
-		}
-	}
-	
 	return ;
 }
 
 /**
- * @fn static void mpc8560_cpm_frame_rx_cb(void* opaque, TPYE_PRAM_PAGE page)
- * @brief handler for RX Ready	
- * @opaque - 
- * @page - 
+ * @fn static void mpc8560_cpm_scc_set_irq(CPMScc* c)
+ * @brief Interrupt Request Masking
+ *
  */
-static void mpc8560_cpm_frame_rx_cb(void* opaque, TYPE_PRAM_PAGE page)
+static void mpc8560_cpm_scc_set_irq(CPMScc* c)
 {
-	CPMState* s = (CPMState*)opaque;
-	
-	hwaddr scc_rbptr = MPC8560_CCSRBAR_BASE + page + SR_RBPTR;
-	//hwaddr rxbd = MPC8560_CCSRBAR_BASE +  CPM_BASE_DPRAM1 + lduw_phys( scc_rbptr );
-	hwaddr rxbd = s->cur_rxbd_addr;
-	uint16_t rxbd_status = lduw_phys(rxbd);
-	//int32_t r_cnt = lduw_phys(rxbd + 0x2);
-	const uint16_t mrblr = lduw_phys(MPC8560_CCSRBAR_BASE + page + SR_MRBLR); /* maximum receive buffer length */
-	int32_t r_cnt;
-	hwaddr r_ptr;
-	uint8_t ch;
-	
-	/* CPM does not use this BD while E = 0 */
-	while (!(rxbd_status & 0x8000)) {
-		if (rxbd_status & 0x2000) {
-			/* TODO : init rxbd with first RxBD and check E bit */
-			s->cur_rxbd_addr = MPC8560_CCSRBAR_BASE +  CPM_BASE_DPRAM1 + lduw_phys( scc_rbptr ); // temp
-			return ; /* no more available BD in Dual port ram */
-		} else { /* QAC */ }
-		rxbd = rxbd + 0x8;
-		s->cur_rxbd_addr = rxbd;
-		rxbd_status = lduw_phys( rxbd );
-	}
-
-	/* Copies buffer length to R_CNT, and copies starting address to R_PTR */
-	//r_cnt = s->recv_fifo_scc1.num;
-	r_cnt = 0;
-	r_ptr = ldl_phys( rxbd + 0x4 );
-	
-	/* Decrements R_CNT and increments R_PTR */
-	while (s->recv_fifo_scc1.num > 0) {
-		ch = fifo8_pop( &(s->recv_fifo_scc1) );
-		stb_phys( r_ptr, (uint32_t)ch );
-
-		r_cnt++;
-		r_ptr++;
-		stw_phys( rxbd + 0x2, r_cnt );
-		
-		if (r_cnt == mrblr) /* MRBLR = N bytes for this SCC */
-		{
-			if( s->recv_fifo_scc1.num > 0 ) // more data 
-			{
-				/* no more available BD */
-				if(rxbd_status & 0x2000) {
-					/* TODO : init rxbd with first RxBD and check E bit  */
-					/* FIXME : timer here or scce rx clear time? */
-					qemu_mod_timer( s->scc_status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 50 ); // temp
-					break;
-				} else { /* QAC */ }
-				rxbd_status = rxbd_status & ~(0x8000);
-				stw_phys( rxbd, rxbd_status );
-				/* TODO : should check I bit for current BD or last BD only? */
-				/* get next bd and fill */
-				rxbd = rxbd + 0x8;
-				s->cur_rxbd_addr = rxbd;
-				rxbd_status = lduw_phys( rxbd );
-				r_cnt = 0;
-				r_ptr = ldl_phys( rxbd + 0x4 );
-				continue;
-			} 	else { /* QAC */ }
-		} 	else { /* QAC */ }
+	uint16_t scce_masked;
+	/* (SCCE & SCCM) -> | INPUT -> (SIPNR & SIMR) -> Request to the core */
+	/* FIXME : temp. not initialized from USER, the console driver on SCC1 never writes SCCM */
+	if (c->idx == 0)
+		c->sccm = c->sccm | (SCCE_TX_MASK | SCCE_RX_MASK);
+	else { /* QAC */ }
+	/* Masking SCCE with SCCM */
+	scce_masked = c->scce & c->sccm;
+	if (scce_masked) {
+		mpc8560_cpm_lat_raise(&(c->irq_lat));
+		if (mpc8560_cpm_raise_int(c->s, IC_SCC_1 + c->idx))
+			c->stats.irqs++;
+		else { /* QAC */ }
+	} else {
+		/* nothing left unmasked, a pending stamp would never be served */
+		mpc8560_cpm_lat_ack(&(c->irq_lat));
 	}
 	
-	if (rxbd_status & 0x1000) {
-		switch( page ) {
-		case PG_SCC_1:
-			s->scce1 = s->scce1 | SCCE_RX_MASK;
-			mpc8560_cpm_set_irq(opaque);
-			break;
-		default:
-			fprintf( stderr, "%s:%d] Unkown page.\n", __func__, __LINE__ );
-		}
-	}	else { /* QAC */ }
-
-	rxbd_status = rxbd_status & ~(0x8000);
-	stw_phys(rxbd, rxbd_status);
+	return ;
+}
 
-	if (rxbd_status & 0x2000)
-		s->cur_rxbd_addr = MPC8560_CCSRBAR_BASE +  CPM_BASE_DPRAM1 + lduw_phys( scc_rbptr ); // temp
-	else
-		s->cur_rxbd_addr += 0x8; // temp
+static inline void mpc8560_cpm_scc_tap(CPMScc* c, int tx, const uint8_t* buf, int32_t n)
+{
+	mpc8560_cpm_tap_put( c->s, TAP_SCC_1 + c->idx, 0, tx, buf, n );
 
 	return ;
 }
 
-static inline void scc_update_status_rxbd(CPMState* s)
+/**
+ * @fn static void mpc8560_cpm_scc_overrun(CPMScc* c)
+ * @brief Received data did not fit the ring, the RxBD holding what came before closes with OV
+ *
+ */
+static void mpc8560_cpm_scc_overrun(CPMScc* c)
 {
-	if (!fifo8_is_empty(&(s->recv_fifo_scc1)))
-		mpc8560_cpm_frame_rx_cb( s, PG_SCC_1 ); 
-	
+	c->stats.overruns++;
+	if (!c->rx_ov_pending) {
+		c->rx_ov_at = c->rx_ring.head;
+		c->rx_ov_pending = 1;
+	} else { /* QAC */ }
+
 	return ;
 }
 
-static int scc_can_receive(void* opaque)
+/**
+ * @fn static void mpc8560_cpm_scc_loopback(CPMScc* c, const uint8_t* buf, int32_t n)
+ * @brief DIAG loopback, transmitted data goes straight into the receiver of the same SCC
+ *
+ * The receive ring is drained into the RxBDs after every burst so a TxBD
+ * longer than the ring is not lost while RxBDs are available.
+ */
+static void mpc8560_cpm_scc_loopback(CPMScc* c, const uint8_t* buf, int32_t n)
 {
-//	CPMState* s = (CPMState*)opaque;
-	int ret = 0;
-	DPRINTF("HIT"); // etjotest
-//	if (s->recv_fifo_scc1.num < SCC_TXRX_FIFO_LEN)
-//		ret = s->recv_fifo_itl_scc1 - s->recv_fifo_scc1.num; 
+	mpc8560_cpm_scc_tap( c, 0, buf, n );
+	if (cpm_ring_push( &(c->rx_ring), buf, n ) < (uint32_t)n)
+		mpc8560_cpm_scc_overrun( c );
 	else { /* QAC */ }
-	ret = 1; // temp
-	return ret;
+	mpc8560_cpm_frame_rx_cb( c );
+
+	return ;
 }
 
-static void scc_update_timer_cb(CPMState* s)
+/**
+ * @fn static void mpc8560_cpm_pram_put(CPMState* s, TYPE_PRAM_PAGE page, uint32_t off, uint16_t value)
+ * @brief Updates a parameter RAM word on the CP side without it reading as a guest table change
+ *
+ */
+static void mpc8560_cpm_pram_put(CPMState* s, TYPE_PRAM_PAGE page, uint32_t off, uint16_t value)
 {
-	DPRINTF("HIT");	// etjotest
-	qemu_del_timer( s->scc_status_poll );
-
-	/* TODO : check poll mode and set poll flag */
+	mpc8560_cpm_pram_sync( s );
+	stw_phys( MPC8560_CCSRBAR_BASE + page + off, value );
+	memory_region_reset_dirty( &(s->dpram2), PRAM_LOG_BASE, PRAM_LOG_LEN, DIRTY_MEMORY_VGA );
 
-	/* TODO : write code here */
+	return ;
+}
+
+/* BD rings live in guest memory, the ring engine reaches them through these */
+static uint16_t mpc8560_cpm_bd_ld16(void* opaque, cpm_bd_addr_t addr)
+{
+	return lduw_phys( addr );
+}
+
+static uint32_t mpc8560_cpm_bd_ld32(void* opaque, cpm_bd_addr_t addr)
+{
+	return ldl_phys( addr );
+}
+
+static void mpc8560_cpm_bd_st16(void* opaque, cpm_bd_addr_t addr, uint16_t value)
+{
+	stw_phys( addr, value );
 
-	/* RxBD Empty */
-	scc_update_status_rxbd( s );
-	/* FIXME : setup response latency with proper value */
-	//if( polling_enabled )
-	if (0)
-	qemu_mod_timer( s->scc_status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 100 ); /* 10ms */
-	
 	return ;
 }
 
-static void scc_fifo_timeout_int(CPMState* s)
+static const CPMBdMem mpc8560_cpm_bd_mem =
+{
+	.ld16 = mpc8560_cpm_bd_ld16,
+	.ld32 = mpc8560_cpm_bd_ld32,
+	.st16 = mpc8560_cpm_bd_st16,
+	.opaque = NULL,
+};
+
+static gboolean mpc8560_cpm_scc_tx_watch_cb(GIOChannel* chan, GIOCondition cond, void* opaque);
+
+/**
+ * @fn static void mpc8560_cpm_scc_echo_flush(CPMScc* c)
+ * @brief Writes queued DIAG echo data as far as the backend takes it, a watch picks up the rest
+ *
+ */
+static void mpc8560_cpm_scc_echo_flush(CPMScc* c)
 {
+	uint8_t buf[256];
+	uint32_t n;
+	int ret;
+
+	while ((n = cpm_ring_peek( &(c->echo_ring), buf, sizeof(buf) )) > 0) {
+		ret = qemu_chr_fe_write( c->chr, buf, n );
+		if ((ret < 0) && (errno != EAGAIN)) {
+			/* a broken backend loses the echo, like a cut line */
+			cpm_ring_drop( &(c->echo_ring), cpm_ring_used( &(c->echo_ring) ) );
+			break;
+		} else if (ret <= 0) {
+			break;
+		} else { /* QAC */ }
+		cpm_ring_drop( &(c->echo_ring), ret );
+		if ((uint32_t)ret < n)
+			break;
+		else { /* QAC */ }
+	}
+
+	if (cpm_ring_used( &(c->echo_ring) ) && !c->tx_watch)
+		c->tx_watch = qemu_chr_fe_add_watch( c->chr, G_IO_OUT, mpc8560_cpm_scc_tx_watch_cb, c );
+	else { /* QAC */ }
+
 	return ;
 }
 
-static void scc_receive(void* opaque, const uint8_t* buf, int size)
+/**
+ * @fn static void mpc8560_cpm_scc_echo(CPMScc* c, const uint8_t* buf, int32_t n)
+ * @brief DIAG echo, the line data goes back out without holding up the receive path
+ *
+ * What does not fit behind a slow backend is lost, as an echo on a real
+ * line would be.
+ */
+static void mpc8560_cpm_scc_echo(CPMScc* c, const uint8_t* buf, int32_t n)
 {
-	CPMState* s = (CPMState*)opaque;
+	cpm_ring_push( &(c->echo_ring), buf, n );
+	mpc8560_cpm_scc_echo_flush( c );
+
+	return ;
+}
+
+static gboolean mpc8560_cpm_scc_tx_watch_cb(GIOChannel* chan, GIOCondition cond, void* opaque)
+{
+	CPMScc* c = (CPMScc*)opaque;
+
+	c->tx_watch = 0;
+	/* the echo was queued first, it goes out ahead of the TxBDs */
+	if (cpm_ring_used( &(c->echo_ring) ))
+		mpc8560_cpm_scc_echo_flush( c );
+	else { /* QAC */ }
+	mpc8560_cpm_cp_kick( c->s, CP_WORK_SCC_TX(c->idx) );
+
+	return FALSE;
+}
+
+/**
+ * @fn static int32_t mpc8560_cpm_scc_tx_put(CPMScc* c, const uint8_t* buf, int32_t n)
+ * @brief Puts TxBD data on the line and returns how much of it the line took
+ *
+ * A backend that is full gets a watch instead of a blocking write, the
+ * TxBD keeps R set until the watch fires and the rest goes out.
+ */
+static int32_t mpc8560_cpm_scc_tx_put(CPMScc* c, const uint8_t* buf, int32_t n)
+{
+	int ret;
+
+	switch (GSMR_L_DIAG(c->gsmr_l)) {
+	case SCC_DIAG_LOOPBACK:
+	case SCC_DIAG_LOOP_ECHO:
+		mpc8560_cpm_scc_loopback( c, buf, n );
+		return n;
+	case SCC_DIAG_ECHO:
+		/* TXD carries the echoed receive data, the transmitter is cut off */
+		return n;
+	default:
+		break;
+	}
+
+	if (!c->chr)
+		return n; /* TXD is not connected anywhere */
+	else { /* QAC */ }
+
+	ret = qemu_chr_fe_write( c->chr, buf, n );
+	if ((ret < 0) && (errno != EAGAIN))
+		return n; /* a broken backend loses the data, like a cut line */
+	else if (ret >= n)
+		return n;
+	else { /* QAC */ }
+
+	c->tx_blocked = 1;
+	if (!c->tx_watch)
+		c->tx_watch = qemu_chr_fe_add_watch( c->chr, G_IO_OUT, mpc8560_cpm_scc_tx_watch_cb, c );
+	else { /* QAC */ }
+
+	return MAX(ret, 0);
+}
+
+/* BISYNC CRC-16, x^16 + x^15 + x^2 + 1 sent LSB first, filled in by class_init */
+static uint16_t mpc8560_cpm_crc16_tab[256];
+
+static void mpc8560_cpm_crc16_init(void)
+{
+	uint16_t crc;
+	int v;
 	int i;
-	DPRINTF("buf (%x) size %d", buf[0], size ); // etjotest
-	for( i = 0; i < size; i++ ) {
-		if( !fifo8_is_full(&(s->recv_fifo_scc1)) )
-			fifo8_push(&(s->recv_fifo_scc1), buf[i]);
-		else
-			do { /* TODO: indicate overrun error */ } while(0);
+
+	for (v = 0; v < 256; v++) {
+		crc = v;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+		mpc8560_cpm_crc16_tab[v] = crc;
 	}
-	
-	/* Set Empty bit of RxBD */
-	qemu_mod_timer( s->scc_status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 100 ); /* 10ms */
-	
+
 	return ;
 }
 
-static void scc_event(void* opaque, int event)
+/**
+ * @fn static uint16_t mpc8560_cpm_bsc_crc(CPMScc* c, uint16_t crc, const uint8_t* buf, int32_t n)
+ * @brief Runs a burst through the BCS PSMR selects, CRC-16 or LRC
+ *
+ */
+static uint16_t mpc8560_cpm_bsc_crc(CPMScc* c, uint16_t crc, const uint8_t* buf, int32_t n)
 {
-//	CPMState* s = (CPMState*)opaque;
+	int32_t i;
+
+	if (PSMR_BSC_CRC(c->psmr) >= BSC_BCS_LRC_EVEN) {
+		for (i = 0; i < n; i++)
+			crc = crc ^ buf[i];
+		return crc & 0xff;
+	} else { /* QAC */ }
+
+	for (i = 0; i < n; i++)
+		crc = (crc >> 8) ^ mpc8560_cpm_crc16_tab[(crc ^ buf[i]) & 0xff];
+
+	return crc;
+}
+
+/* what goes on the line for a block check, low byte first */
+static inline uint16_t mpc8560_cpm_bsc_bcs(CPMScc* c, uint16_t crc)
+{
+	return (PSMR_BSC_CRC(c->psmr) == BSC_BCS_LRC_ODD) ? (~crc & 0xff) : crc;
+}
+
+static inline int mpc8560_cpm_bsc_bcs_len(CPMScc* c)
+{
+	return (PSMR_BSC_CRC(c->psmr) >= BSC_BCS_LRC_EVEN) ? 1 : 2;
+}
+
+/**
+ * @fn static void mpc8560_cpm_bsc_reset_bcs(CPMScc* c)
+ * @brief RESET BCS, both directions start over from PRCRC and PTCRC
+ *
+ */
+static void mpc8560_cpm_bsc_reset_bcs(CPMScc* c)
+{
+	const hwaddr pram = SCC_PAGE(c->idx);
+
+	c->bsc_rx_crc = lduw_phys( pram + BS_PRCRC );
+	c->bsc_tx_crc = lduw_phys( pram + BS_PTCRC );
+
+	return ;
+}
+
+/* a stuffed DLE and the BCS after it are the most the tail ever holds */
+static inline void mpc8560_cpm_bsc_tx_tail_push(CPMScc* c, uint8_t v)
+{
+	assert( c->bsc_tx_tail_len < sizeof(c->bsc_tx_tail) );
+	c->bsc_tx_tail[c->bsc_tx_tail_len++] = v;
 
-	DPRINTF("event %x", event);
-#if 0	
-	/* push null byte into the fifo */
-	if( event == CHR_EVENT_BREAK )
-	{
-		if( !fifo8_is_full(&(s->recv_fifo_scc1)) )
-			fifo8_push( &(s->recv_fifo_scc1), '\0' );
-		else
-			do { /* TODO : indicate overrun error */ } while(0);
-	}
-#endif
 	return ;
 }
 
 /**
+ * @fn static int mpc8560_cpm_bsc_tx_flush(CPMScc* c)
+ * @brief Puts out what the transmitter added to the data, returns 1 once nothing is left
  *
+ */
+static int mpc8560_cpm_bsc_tx_flush(CPMScc* c)
+{
+	int32_t taken;
+
+	if (!c->bsc_tx_tail_len)
+		return 1;
+	else { /* QAC */ }
+
+	taken = mpc8560_cpm_scc_tx_put( c, c->bsc_tx_tail, c->bsc_tx_tail_len );
+	c->bsc_tx_tail_len -= taken;
+	memmove( c->bsc_tx_tail, c->bsc_tx_tail + taken, c->bsc_tx_tail_len );
+
+	return !c->bsc_tx_tail_len;
+}
+
+/**
+ * @fn static int32_t mpc8560_cpm_bsc_tx_put(CPMScc* c, const uint8_t* buf, int32_t n, uint16_t status)
+ * @brief BISYNC transmitter, returns how much of the TxBD data the line took
  *
+ * A block starts with SYN1 SYN2 from DSR. Transparent TxBDs go out in runs
+ * between DLEs, each DLE followed by its stuffed copy.
+ */
+static int32_t mpc8560_cpm_bsc_tx_put(CPMScc* c, const uint8_t* buf, int32_t n, uint16_t status)
+{
+	const uint8_t* dle;
+	int32_t done = 0;
+	int32_t run;
+	int32_t taken;
+
+	if (!mpc8560_cpm_bsc_tx_flush( c ))
+		return 0;
+	else { /* QAC */ }
+	if (!c->bsc_tx_open) {
+		mpc8560_cpm_bsc_tx_tail_push( c, c->dsr >> 8 );
+		mpc8560_cpm_bsc_tx_tail_push( c, c->dsr & 0xff );
+		c->bsc_tx_open = 1;
+		if (!mpc8560_cpm_bsc_tx_flush( c ))
+			return 0;
+		else { /* QAC */ }
+	} else { /* QAC */ }
+
+	while (done < n) {
+		run = n - done;
+		dle = NULL;
+		if ((status & BSC_TXBD_TR) && (c->bsc_dle >= 0)) {
+			dle = memchr( buf + done, c->bsc_dle, run );
+			if (dle)
+				run = dle - (buf + done) + 1;
+			else { /* QAC */ }
+		} else { /* QAC */ }
+
+		taken = mpc8560_cpm_scc_tx_put( c, buf + done, run );
+		c->bsc_tx_crc = mpc8560_cpm_bsc_crc( c, c->bsc_tx_crc, buf + done, taken );
+		done += taken;
+		if (taken < run)
+			break; /* backpressure */
+		else { /* QAC */ }
+		if (dle) {
+			mpc8560_cpm_bsc_tx_tail_push( c, c->bsc_dle );
+			if (!mpc8560_cpm_bsc_tx_flush( c ))
+				break;
+			else { /* QAC */ }
+		} else { /* QAC */ }
+	}
+
+	return done;
+}
+
+/**
+ * @fn static void mpc8560_cpm_bsc_tx_end(CPMScc* c, uint16_t status)
+ * @brief A TxBD is through, L ends the block and TB sends the BCS after it
  *
  */
-static uint64_t mpc8560_cpm_sccx_read(void* opaque, hwaddr addr, unsigned size)
+static void mpc8560_cpm_bsc_tx_end(CPMScc* c, uint16_t status)
 {
-	uint32_t ret = 0;
-	CPMState* s = (CPMState*)opaque;
+	uint16_t bcs;
+
+	if (!(status & CPM_BD_L))
+		return ;
+	else { /* QAC */ }
+
+	if (status & BSC_TXBD_TB) {
+		bcs = mpc8560_cpm_bsc_bcs( c, c->bsc_tx_crc );
+		mpc8560_cpm_bsc_tx_tail_push( c, bcs & 0xff );
+		if (mpc8560_cpm_bsc_bcs_len( c ) > 1)
+			mpc8560_cpm_bsc_tx_tail_push( c, bcs >> 8 );
+		else { /* QAC */ }
+		mpc8560_cpm_bsc_tx_flush( c );
+	} else { /* QAC */ }
+	c->bsc_tx_crc = lduw_phys( SCC_PAGE(c->idx) + BS_PTCRC );
+	c->bsc_tx_open = 0;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_tx_error(CPMScc* c, CPMBdRing* bds, const CPMBd* bd, int bsc)
+ * @brief Closes the TxBD in progress with an error status, UN in BISYNC and CT in UART
+ *
+ */
+static void mpc8560_cpm_scc_tx_error(CPMScc* c, CPMBdRing* bds, const CPMBd* bd, int bsc)
+{
+	const hwaddr dpram = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1;
+	uint16_t status;
+
+	c->tx_done = 0;
+	status = cpm_bd_close( bds, bd, 0, bsc ? SCC_TXBD_UN : SCC_TXBD_CT );
+	mpc8560_cpm_pram_put( c->s, SCC_PG(c->idx), SR_TBPTR, bds->cur - dpram );
+	c->stats.tx_bds++;
+
+	if (bsc)
+		c->scce = c->scce | SCCE_TXE_MASK;
+	else if (status & CPM_BD_I)
+		c->scce = c->scce | SCCE_TX_MASK;
+	else { /* QAC */ }
+	mpc8560_cpm_scc_set_irq( c );
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_frame_tx_cb(CPMScc* c)
+ * @brief handler for TX Ready, sends every TxBD with R set from TBPTR on
+ * @c - SCC whose TxBD ring is walked
+ *
+ * Returns the number of TxBDs handed back to the core. A BD the backend
+ * only took part of stays ready, tx_done remembers how far it got.
+ */
+static int mpc8560_cpm_frame_tx_cb(CPMScc* c)
+{
+	CPMState* s = c->s;
+	const hwaddr dpram = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1;
+	const hwaddr pram = SCC_PAGE(c->idx);
+	CPMBdRing bds;
+	CPMBd bd;
+	uint16_t status;
+	int32_t t_cnt;
+	hwaddr t_ptr;
+	uint8_t buf[CPM_SDMA_BURST];
+	int32_t n;
+	int32_t taken;
+	int sent;
+	const int bsc = (GSMR_L_MODE(c->gsmr_l) == GSMR_MODE_BISYNC);
+
+	c->tx_blocked = 0;
+	if (bsc && !mpc8560_cpm_bsc_tx_flush( c ))
+		return 0;
+	else { /* QAC */ }
+	cpm_bd_ring_init( &bds, &mpc8560_cpm_bd_mem, dpram + lduw_phys( pram + SR_TBASE ), dpram + lduw_phys( pram + SR_TBPTR ) );
+	for (sent = 0; sent < CP_BUDGET_SCC_TX; sent++) {
+		/* Copies buffer length from current TxBD to t_cnt, and
+		   copies starting address to t_ptr.
+		 */
+		if (!cpm_bd_fetch( &bds, &bd ))
+			break; /* not ready, the CP looks again on TODR or the next poll */
+		else { /* QAC */ }
+		t_cnt = bd.len - MIN(c->tx_done, bd.len);
+		t_ptr = bd.ptr + c->tx_done;
+		if (bsc && !c->tx_done && (bd.status & BSC_TXBD_BR))
+			c->bsc_tx_crc = lduw_phys( pram + BS_PTCRC );
+		else { /* QAC */ }
 	
+		DPRINTF("txbd = %lx, t_cnt = %d, t_ptr = %lx", bd.addr, t_cnt, t_ptr);
+		while (t_cnt > 0) {
+			n = MIN(t_cnt, sizeof(buf));
+			if (mpc8560_cpm_sdma_read( s, t_ptr, buf, n ) < 0) {
+				/* reported through SMEVR, the BD closes in error and the transmitter stops */
+				mpc8560_cpm_scc_tx_error( c, &bds, &bd, bsc );
+				return sent;
+			} else { /* QAC */ }
+			if (bsc)
+				taken = mpc8560_cpm_bsc_tx_put( c, buf, n, bd.status );
+			else
+				taken = mpc8560_cpm_scc_tx_put( c, buf, n );
+			if (taken > 0) {
+				mpc8560_cpm_scc_tap( c, 1, buf, taken );
+				c->stats.tx_bytes += taken;
+			} else { /* QAC */ }
+		
+			/* Decrements t_cnt and increments t_ptr */
+			t_cnt -= taken;
+			t_ptr += taken;
+			c->tx_done += taken;
+			if (taken < n)
+				return sent; /* backpressure, R stays set */
+			else { /* QAC */ }
+		}
+		c->tx_done = 0;
+		if (bsc)
+			mpc8560_cpm_bsc_tx_end( c, bd.status );
+		else { /* QAC */ }
 	
-	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
+		/* Clears R bit after using TxBD, W takes TBPTR back to TBASE */
+		status = cpm_bd_close( &bds, &bd, 0, 0 );
+		mpc8560_cpm_pram_put( s, SCC_PG(c->idx), SR_TBPTR, bds.cur - dpram );
+		c->stats.tx_bds++;
+		c->stats.tx_frames++;
 
-	switch( addr ) {
-	/* SCC1 */
-	case BCTS(CPM_REG_GSMR_L1): case BCTS(CPM_REG_GSMR_L1) + 0x1:
-	case BCTS(CPM_REG_GSMR_L1) + 0x2: case BCTS(CPM_REG_GSMR_L1) + 0x3:
-		PARTIAL_READ(BCTS(CPM_REG_GSMR_L1), s->gsmr_l1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_GSMR_H1): case BCTS(CPM_REG_GSMR_H1) + 0x1:
-	case BCTS(CPM_REG_GSMR_H1) + 0x2: case BCTS(CPM_REG_GSMR_H1) + 0x3:
-		PARTIAL_READ(BCTS(CPM_REG_GSMR_H1), s->gsmr_h1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_PSMR1):
-	case BCTS(CPM_REG_PSMR1) + 0x1:
-		PARTIAL_READ(BCTS(CPM_REG_PSMR1), s->psmr1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_TODR1):
-		PARTIAL_READ(BCTS(CPM_REG_TODR1), s->todr1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_DSR1):
-		ret = s->dsr1;
-		break;
-	case BCTS(CPM_REG_SCCE1):
-	case BCTS(CPM_REG_SCCE1) + 0x1:
-		PARTIAL_READ(BCTS(CPM_REG_SCCE1), s->scce1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_RESV1):
-	case (BCTS(CPM_REG_RESV1) + 0x1):
-		PARTIAL_READ(BCTS(CPM_REG_RESV1), s->scc_resv1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_SCCM1):
-	case BCTS(CPM_REG_SCCM1) + 0x1:
-		PARTIAL_READ(BCTS(CPM_REG_SCCM1), s->sccm1, addr, size, ret);
-		break;
-	case BCTS(CPM_REG_SCCS1):
-		ret = s->sccs1;
-		break;
-		/* SCC2 */
-	case BCTS(CPM_REG_GSMR_L2):
-		ret = s->gsmr_l2;
-		break;
-	case BCTS(CPM_REG_GSMR_H2):
-		ret = s->gsmr_h2;
-		break;
-	case BCTS(CPM_REG_PSMR2):
-		ret = s->psmr2;
-		break;
-	case BCTS(CPM_REG_TODR2):
-		ret = s->todr2;
-		break;
-	case BCTS(CPM_REG_DSR2):
-		ret = s->dsr2;
-		break;
-	case BCTS(CPM_REG_SCCE2):
-		ret = s->scce2;
-		break;
-	case BCTS(CPM_REG_SCCM2):
-		ret = s->sccm2;
-		break;
-	case BCTS(CPM_REG_SCCS2):
-		ret = s->sccs2;
-		break;
-#if 0
-	/* SCC3 */
-	case BCTS(CPM_REG_GSMR_L3):
-		break;
-	case BCTS(CPM_REG_GSMR_H3):
-		break;
-	case BCTS(CPM_REG_PSMR3):
-		break;
-	case BCTS(CPM_REG_TODR3):
-		break;
-	case BCTS(CPM_REG_DSR3):
-		break;
-	case BCTS(CPM_REG_SCCE3):
-		break;
-	case BCTS(CPM_REG_SCCM3):
-		break;
-	case BCTS(CPM_REG_SCCS3):
-		break;
-		/* SCC4 */	
-	case BCTS(CPM_REG_GSMR_L4):
-		break;
-	case BCTS(CPM_REG_GSMR_H4):
-		break;
-	case BCTS(CPM_REG_PSMR4):
-		break;
-	case BCTS(CPM_REG_TODR4):
-		break;
-	case BCTS(CPM_REG_DSR4):
-		break;
-	case BCTS(CPM_REG_SCCE4):
-		break;
-	case BCTS(CPM_REG_SCCM4):
-		break;
-	case BCTS(CPM_REG_SCCS4):
-		break;
-#endif /* Not implemented yet */
-		
-	default : /* should never reach here */
-		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
-					__func__, __LINE__, (int)addr);
+		/* Set SCCE[TX] if I bit enabled */
+		if (status & CPM_BD_I) {
+			c->scce = c->scce | SCCE_TX_MASK;
+			mpc8560_cpm_scc_set_irq( c );
+		} else { /* QAC */ }
 	}
+	
+	return sent;
+}
 
-	DPRINTF("opaque=%p, addr=%x, size=%x ret=%x", opaque, (uint32_t)addr, size, ret);
-	return ret;
+/* the transmitter is enabled, or the enabled receiver waits for an RxBD */
+static inline int mpc8560_cpm_scc_bd_poll_wanted(CPMScc* c)
+{
+	return (c->gsmr_l & GSMR_L_ENT)
+		|| ((c->gsmr_l & GSMR_L_ENR) && c->rx_stalled);
 }
 
 /**
+ * @fn static void mpc8560_cpm_scc_bd_poll_cb(void* opaque)
+ * @brief Stands in for the CP polling the TxBD R bit and, while receive is stalled, the RxBD E bit
  *
+ * DPRAM1 is dirty logged, so a tick where the guest left the watched BDs
+ * alone costs one bitmap test. The interval doubles on every idle tick,
+ * except while the receiver waits for an RxBD.
+ *
+ * The log is kept per target page, and the RxBD and TxBD usually share
+ * one, so both are tested before either is cleared.
+ */
+static void mpc8560_cpm_scc_bd_poll_cb(void* opaque)
+{
+	CPMScc* c = (CPMScc*)opaque;
+	CPMState* s = c->s;
+	const hwaddr txbd = lduw_phys( SCC_PAGE(c->idx) + SR_TBPTR );
+	const hwaddr rxbd = c->rxbd - (MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1);
+	const int rx_on = c->rx_stalled && (c->gsmr_l & GSMR_L_ENR);
+	const int tx_on = (c->gsmr_l & GSMR_L_ENT) != 0;
+	int rx_dirty = 0;
+	int tx_dirty = 0;
+	int sent = 0;
+
+	/* under KVM the log lives in the kernel until it is pulled */
+	memory_region_sync_dirty_bitmap( &(s->dpram1) );
+
+	if (rx_on)
+		rx_dirty = (rxbd >= CPM_SIZE_DPRAM) || memory_region_get_dirty( &(s->dpram1), rxbd, 0x8, DIRTY_MEMORY_VGA );
+	else { /* QAC */ }
+	/* no dirty bit to watch, or a backend without watches, is always a walk */
+	if (tx_on)
+		tx_dirty = (txbd >= CPM_SIZE_DPRAM) || (c->tx_blocked && !c->tx_watch)
+			|| memory_region_get_dirty( &(s->dpram1), txbd, 0x8, DIRTY_MEMORY_VGA );
+	else { /* QAC */ }
+
+	/* cleared before the BDs are read, a write racing the walk shows up next tick */
+	if (rx_dirty && (rxbd < CPM_SIZE_DPRAM))
+		memory_region_reset_dirty( &(s->dpram1), rxbd, 0x8, DIRTY_MEMORY_VGA );
+	else { /* QAC */ }
+	if (tx_dirty && (txbd < CPM_SIZE_DPRAM))
+		memory_region_reset_dirty( &(s->dpram1), txbd, 0x8, DIRTY_MEMORY_VGA );
+	else { /* QAC */ }
+
+	if (rx_dirty && (lduw_phys( c->rxbd ) & CPM_BD_OWN))
+		mpc8560_cpm_frame_rx_cb( c );
+	else { /* QAC */ }
+	if (tx_dirty)
+		sent = mpc8560_cpm_frame_tx_cb( c );
+	else { /* QAC */ }
+
+	if (sent >= CP_BUDGET_SCC_TX)
+		mpc8560_cpm_cp_kick( s, CP_WORK_SCC_TX(c->idx) );
+	else { /* QAC */ }
+	if (sent || c->rx_stalled)
+		c->bd_poll_ns = SCC_BD_POLL_MIN_NS;
+	else
+		c->bd_poll_ns = MIN(c->bd_poll_ns * 2, SCC_BD_POLL_MAX_NS);
+	if (mpc8560_cpm_scc_bd_poll_wanted( c ))
+		qemu_mod_timer( c->bd_poll, qemu_get_clock_ns(vm_clock) + c->bd_poll_ns );
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_bd_poll_arm(CPMScc* c)
+ * @brief Starts the BD poll from its shortest interval, or stops it once nothing is left to watch
  *
+ * An SCC that is left out has no poll, for it this does nothing.
+ */
+static void mpc8560_cpm_scc_bd_poll_arm(CPMScc* c)
+{
+	if (!c->bd_poll)
+		return ;
+	else { /* QAC */ }
+
+	c->bd_poll_ns = SCC_BD_POLL_MIN_NS;
+	if (mpc8560_cpm_scc_bd_poll_wanted( c ))
+		qemu_mod_timer( c->bd_poll, qemu_get_clock_ns(vm_clock) + c->bd_poll_ns );
+	else
+		qemu_del_timer( c->bd_poll );
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_bsc_compile(CPMScc* c)
+ * @brief BISYNC side of mpc8560_cpm_uart_compile(), SYNC, DLE and the control characters
  *
+ * Outside transparent mode SYNC and the control characters are flagged. In
+ * transparent mode only DLE (and SYNC, for hunting) is, what follows a DLE
+ * goes through the slow path on its own.
  */
-static void mpc8560_cpm_sccx_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+static void mpc8560_cpm_bsc_compile(CPMScc* c)
 {
-	CPMState* s = (CPMState*)opaque;
-	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
+	const hwaddr pram = SCC_PAGE(c->idx);
+	uint16_t chr[8];
+	uint16_t rccm;
+	uint16_t v;
+	int nchr;
+	int k;
 
-	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
-	/* TODO : scale 'value' according to size?? */	
-	switch( addr )
-	{
-		/* SCC1 */
-		case BCTS(CPM_REG_GSMR_L1):	case BCTS(CPM_REG_GSMR_L1) + 0x1:
-		case BCTS(CPM_REG_GSMR_L1) + 0x2: case BCTS(CPM_REG_GSMR_L1) + 0x3:
-			PARTIAL_WRITE(BCTS(CPM_REG_GSMR_L1), s->gsmr_l1, addr, size, value);
-			DPRINTF("gsmr_l1 -> %x", s->gsmr_l1);
+	bitmap_zero( c->bsc_cc_bcs, 256 );
+	bitmap_zero( c->bsc_cc_hunt, 256 );
+
+	v = lduw_phys( pram + BS_BSYNC );
+	c->bsc_sync = (v & BSC_CHAR_V) ? (v & 0xff) : -1;
+	v = lduw_phys( pram + BS_BDLE );
+	c->bsc_dle = (v & BSC_CHAR_V) ? (v & 0xff) : -1;
+
+	rccm = lduw_phys( pram + BS_RCCM );
+	for (nchr = 0; nchr < 8; nchr++) {
+		chr[nchr] = lduw_phys( pram + BS_CHARACTER1 + (nchr * 2) );
+		if (chr[nchr] & UART_CHAR_E)
 			break;
-		case BCTS(CPM_REG_GSMR_H1): case BCTS(CPM_REG_GSMR_H1) + 0x1:
+		else { /* QAC */ }
+	}
+
+	for (v = 0; v < 256; v++) {
+		/* the first matching entry decides */
+		for (k = 0; k < nchr; k++) {
+			if (((v ^ chr[k]) & rccm & 0xff) == 0) {
+				set_bit( v, c->uart_cc );
+				if (chr[k] & UART_CHAR_R)
+					set_bit( v, c->uart_cc_rej );
+				else { /* QAC */ }
+				if (chr[k] & BSC_CHAR_B)
+					set_bit( v, c->bsc_cc_bcs );
+				else { /* QAC */ }
+				if (chr[k] & BSC_CHAR_H)
+					set_bit( v, c->bsc_cc_hunt );
+				else { /* QAC */ }
+				break;
+			} else { /* QAC */ }
+		}
+	}
+
+	if (c->psmr & PSMR_BSC_RTR) {
+		if (c->bsc_dle >= 0)
+			set_bit( c->bsc_dle, c->uart_special );
+		else { /* QAC */ }
+	} else
+		bitmap_copy( c->uart_special, c->uart_cc, 256 );
+	if (c->bsc_sync >= 0)
+		set_bit( c->bsc_sync, c->uart_special );
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_uart_compile(CPMScc* c)
+ * @brief Folds PSMR and the control character table into per-character bitmaps
+ *
+ * Runs only when the guest changes either, so the receive path decides a
+ * character with one bit test instead of walking CHARACTER1-8.
+ */
+static void mpc8560_cpm_uart_compile(CPMScc* c)
+{
+	const hwaddr pram = SCC_PAGE(c->idx);
+	const int bits = 5 + PSMR_CL(c->psmr);
+	uint16_t chr[8];
+	uint16_t rccm;
+	int parity;
+
+	/* the parameter page of a left out SCC is plain DPRAM */
+	if (!CPM_HAS(c->s, BLK_SCC_1 + c->idx))
+		return ;
+	else { /* QAC */ }
+	int nchr;
+	int v;
+	int k;
+
+	bitmap_zero( c->uart_special, 256 );
+	bitmap_zero( c->uart_cc, 256 );
+	bitmap_zero( c->uart_cc_rej, 256 );
+	c->uart_data_mask = 0xff;
+	c->uart_xbit = 0;
+	c->uart_md = PSMR_UM_NORMAL;
+	if (GSMR_L_MODE(c->gsmr_l) == GSMR_MODE_BISYNC) {
+		mpc8560_cpm_bsc_compile( c );
+		return ;
+	} else if (GSMR_L_MODE(c->gsmr_l) != GSMR_MODE_UART)
+		return ;
+	else { /* QAC */ }
+
+	/* the backend has no ninth bit, parity and address ride above short characters */
+	c->uart_data_mask = (1 << bits) - 1;
+	c->uart_xbit = (bits < 8) ? (1 << bits) : 0;
+	c->uart_md = PSMR_UM(c->psmr);
+	c->uart_uaddr[0] = lduw_phys( pram + UR_UADDR1 ) & 0xff;
+	c->uart_uaddr[1] = lduw_phys( pram + UR_UADDR2 ) & 0xff;
+	rccm = lduw_phys( pram + UR_RCCM );
+	nchr = 0;
+	if ((rccm & UART_RCCM_VALID) == UART_RCCM_VALID) {
+		for (nchr = 0; nchr < 8; nchr++) {
+			chr[nchr] = lduw_phys( pram + UR_CHARACTER1 + (nchr * 2) );
+			if (chr[nchr] & UART_CHAR_E)
+				break;
+			else { /* QAC */ }
+		}
+	} else { /* QAC */ }
+
+	for (v = 0; v < 256; v++) {
+		if (c->uart_md && (v & c->uart_xbit)) {
+			/* address character */
+			set_bit( v, c->uart_special );
+			continue;
+		} else if (!c->uart_md && c->uart_xbit && (c->psmr & PSMR_PEN)) {
+			parity = ctpop8( v & c->uart_data_mask ) & 1;
+			switch (PSMR_RPM(c->psmr)) {
+			case UART_RPM_ODD:
+				parity = !parity;
+				break;
+			case UART_RPM_LOW:
+				parity = 0;
+				break;
+			case UART_RPM_EVEN:
+				break;
+			default:
+				parity = 1;
+			}
+			if (!!(v & c->uart_xbit) != parity) {
+				/* flagged but in neither table, the slow path takes it as a parity error */
+				set_bit( v, c->uart_special );
+				continue;
+			} else { /* QAC */ }
+		} else { /* QAC */ }
+
+		/* the first matching entry decides */
+		for (k = 0; k < nchr; k++) {
+			if ((((v & c->uart_data_mask) ^ chr[k]) & rccm & 0xff) == 0) {
+				set_bit( v, c->uart_special );
+				set_bit( v, c->uart_cc );
+				if (chr[k] & UART_CHAR_R)
+					set_bit( v, c->uart_cc_rej );
+				else { /* QAC */ }
+				break;
+			} else { /* QAC */ }
+		}
+	}
+
+	return ;
+}
+
+static void mpc8560_cpm_uart_count(CPMScc* c, TYPE_UART_PRAM_OFFSET counter)
+{
+	mpc8560_cpm_pram_put( c->s, SCC_PG(c->idx), counter, lduw_phys( SCC_PAGE(c->idx) + counter ) + 1 );
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_uart_rx_char(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+ * @brief Slow path for a character flagged in uart_special, returns UART_RX_*
+ *
+ */
+static int mpc8560_cpm_uart_rx_char(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+{
+	*c = raw & p->uart_data_mask;
+	*status = 0;
+
+	if (p->uart_md && (raw & p->uart_xbit)) {
+		if (p->uart_md != PSMR_UM_AUTO)
+			*status = UART_RXBD_A;
+		else if (*c == p->uart_uaddr[0])
+			*status = UART_RXBD_A | UART_RXBD_AM;
+		else if (*c == p->uart_uaddr[1])
+			*status = UART_RXBD_A;
+		else {
+			/* another station is addressed, skip up to the next address */
+			p->uart_hunt = 1;
+			return 0;
+		}
+		p->uart_hunt = 0;
+		return UART_RX_OPEN | UART_RX_STORE;
+	} else if (p->uart_hunt) {
+		return 0;
+	} else if (!test_bit( raw, p->uart_cc )) {
+		mpc8560_cpm_uart_count( p, UR_PAREC );
+		*status = UART_RXBD_PR;
+		return UART_RX_STORE | UART_RX_CLOSE;
+	} else if (test_bit( raw, p->uart_cc_rej )) {
+		mpc8560_cpm_pram_put( p->s, SCC_PG(p->idx), UR_RCCR, *c );
+		p->scce = p->scce | SCCE_CCR_MASK;
+		mpc8560_cpm_scc_set_irq( p );
+		return 0;
+	} else {
+		*status = UART_RXBD_C;
+		return UART_RX_STORE | UART_RX_CLOSE;
+	}
+}
+
+/**
+ * @fn static int mpc8560_cpm_bsc_rx_cc(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+ * @brief A control character ends the block, now or after its BCS
+ *
+ */
+static int mpc8560_cpm_bsc_rx_cc(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+{
+	if (test_bit( raw, p->uart_cc_rej )) {
+		mpc8560_cpm_pram_put( p->s, SCC_PG(p->idx), UR_RCCR, raw );
+		p->scce = p->scce | SCCE_CCR_MASK;
+		mpc8560_cpm_scc_set_irq( p );
+		return 0;
+	} else { /* QAC */ }
+
+	*c = raw;
+	if (p->psmr & PSMR_BSC_RBCS)
+		p->bsc_rx_crc = mpc8560_cpm_bsc_crc( p, p->bsc_rx_crc, c, 1 );
+	else { /* QAC */ }
+	p->bsc_rx_hunt_after = test_bit( raw, p->bsc_cc_hunt );
+	if (test_bit( raw, p->bsc_cc_bcs )) {
+		p->bsc_rx_bcs = mpc8560_cpm_bsc_bcs_len( p );
+		p->bsc_rx_bcs_in = 0;
+		return UART_RX_STORE;
+	} else { /* QAC */ }
+
+	*status = BSC_RXBD_L;
+	p->uart_hunt = p->bsc_rx_hunt_after;
+	return UART_RX_STORE | UART_RX_CLOSE;
+}
+
+/**
+ * @fn static int mpc8560_cpm_bsc_rx_char(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+ * @brief Slow path for a BISYNC character, returns UART_RX_* like the UART one
+ *
+ */
+static int mpc8560_cpm_bsc_rx_char(CPMScc* p, uint8_t raw, uint8_t* c, uint16_t* status)
+{
+	const int len = mpc8560_cpm_bsc_bcs_len( p );
+
+	*c = raw;
+	*status = 0;
+
+	if (p->bsc_rx_bcs) {
+		/* low byte first */
+		p->bsc_rx_bcs_in = p->bsc_rx_bcs_in | (raw << (8 * (len - p->bsc_rx_bcs)));
+		if (--p->bsc_rx_bcs)
+			return 0;
+		else { /* QAC */ }
+		*status = BSC_RXBD_L;
+		if ((p->psmr & PSMR_BSC_RBCS) && (p->bsc_rx_bcs_in != mpc8560_cpm_bsc_bcs( p, p->bsc_rx_crc ))) {
+			*status = *status | BSC_RXBD_CR;
+			p->stats.crc_errors++;
+		} else { /* QAC */ }
+		p->bsc_rx_crc = lduw_phys( SCC_PAGE(p->idx) + BS_PRCRC );
+		p->uart_hunt = p->bsc_rx_hunt_after;
+		return UART_RX_CLOSE;
+	} else if (p->uart_hunt) {
+		/* SYNC brings the receiver back */
+		if (raw == p->bsc_sync)
+			p->uart_hunt = 0;
+		else { /* QAC */ }
+		return 0;
+	} else if (p->bsc_rx_dle) {
+		p->bsc_rx_dle = 0;
+		if (raw == p->bsc_sync)
+			return 0; /* DLE SYNC is idle fill */
+		else if (test_bit( raw, p->uart_cc ))
+			return mpc8560_cpm_bsc_rx_cc( p, raw, c, status );
+		else { /* QAC */ }
+		/* DLE DLE is one DLE of data, any other pair keeps the second character */
+	} else if (p->psmr & PSMR_BSC_RTR) {
+		if (raw == p->bsc_dle) {
+			p->bsc_rx_dle = 1;
+			return 0;
+		} else { /* QAC */ }
+		/* a SYNC without DLE is data */
+	} else if (raw == p->bsc_sync) {
+		return 0;
+	} else if (test_bit( raw, p->uart_cc )) {
+		return mpc8560_cpm_bsc_rx_cc( p, raw, c, status );
+	} else { /* QAC */ }
+
+	if (p->psmr & PSMR_BSC_RBCS)
+		p->bsc_rx_crc = mpc8560_cpm_bsc_crc( p, p->bsc_rx_crc, c, 1 );
+	else { /* QAC */ }
+
+	return UART_RX_STORE;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_rx_ring(CPMScc* c, CPMBdRing* bds)
+ * @brief RxBD ring as the receiver sees it, W goes back to RBPTR
+ *
+ */
+static void mpc8560_cpm_scc_rx_ring(CPMScc* c, CPMBdRing* bds)
+{
+	const hwaddr dpram = MPC8560_CCSRBAR_BASE + CPM_BASE_DPRAM1;
+
+	cpm_bd_ring_init( bds, &mpc8560_cpm_bd_mem, dpram + lduw_phys( SCC_PAGE(c->idx) + SR_RBPTR ), c->rxbd );
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_rx_close(CPMScc* c, CPMBdRing* bds, const CPMBd* bd, uint16_t status)
+ * @brief Hands the current RxBD back to the core and moves on to the next one
+ *
+ */
+static void mpc8560_cpm_scc_rx_close(CPMScc* c, CPMBdRing* bds, const CPMBd* bd, uint16_t status)
+{
+	uint16_t rxbd_status;
+
+	rxbd_status = cpm_bd_close( bds, bd, UART_RXBD_STATUS | BSC_RXBD_STATUS | SCC_RXBD_OV, status );
+	c->rxbd = bds->cur;
+	c->stats.rx_bds++;
+	c->stats.rx_frames++;	/* a UART buffer is its own message */
+
+	if (rxbd_status & CPM_BD_I) {
+		c->scce = c->scce | SCCE_RX_MASK;
+		mpc8560_cpm_scc_set_irq( c );
+	}	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_rx_stall(CPMScc* c)
+ * @brief Received data is waiting and no RxBD is empty, the backlog stays in the ring
+ *
+ * Draining resumes as soon as the guest acknowledges SCCE[RX] or the BD poll
+ * sees the E bit come back, whichever is first.
+ */
+static void mpc8560_cpm_scc_rx_stall(CPMScc* c)
+{
+	if (!c->rx_stalled) {
+		c->rx_stalled = 1;
+		c->rx_stall_start = qemu_get_clock_ns(vm_clock);
+		c->stats.stalls++;
+	} else { /* QAC */ }
+	mpc8560_cpm_scc_bd_poll_arm( c );
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_frame_rx_cb(CPMScc* c)
+ * @brief handler for RX Ready	
+ * @c - SCC whose receive ring is drained
+ *
+ * Plain characters are copied in bursts. A character flagged in the UART
+ * bitmaps (control character, address, parity error) ends the burst and
+ * may close the buffer early.
+ */
+static void mpc8560_cpm_frame_rx_cb(CPMScc* c)
+{
+	CPMState* s = c->s;
+	CPMRing* ring = &(c->rx_ring);
+	CPMBdRing bds;
+	CPMBd bd;
+	const uint16_t mrblr = lduw_phys(SCC_PAGE(c->idx) + SR_MRBLR); /* maximum receive buffer length */
+	int32_t r_cnt;
+	hwaddr r_ptr;
+	uint8_t buf[CPM_SDMA_BURST];
+	uint16_t status = 0;	/* UART status bits the buffer closes with */
+	uint16_t cstatus;
+	uint8_t ch;
+	int32_t n;
+	int32_t i;
+	int act;
+	const int bsc = (GSMR_L_MODE(c->gsmr_l) == GSMR_MODE_BISYNC);
+	
+	/* CPM does not use this BD while E = 0 */
+	mpc8560_cpm_scc_rx_ring( c, &bds );
+	while (!cpm_bd_fetch( &bds, &bd )) {
+		cpm_bd_next( &bds, bd.status );
+		c->rxbd = bds.cur;
+		if (bd.status & CPM_BD_W) {
+			/* wrapped without an empty RxBD, the poll checks E again from the first one */
+			mpc8560_cpm_scc_rx_stall( c );
+			return ; /* no more available BD in Dual port ram */
+		} else { /* QAC */ }
+	}
+	if (c->rx_stalled) {
+		c->rx_stalled = 0;
+		c->rx_stall_ns += qemu_get_clock_ns(vm_clock) - c->rx_stall_start;
+	} else { /* QAC */ }
+
+	/* control character table or PSMR may have changed since the last burst */
+	mpc8560_cpm_pram_sync( s );
+
+	/* Copies buffer length to R_CNT, and copies starting address to R_PTR */
+	r_cnt = 0;
+	r_ptr = bd.ptr;
+	
+	/* Decrements R_CNT and increments R_PTR */
+	while ((cpm_ring_used( ring ) > 0) || c->uart_brk_pending) {
+		act = 0;
+		if (c->rx_ov_pending && (ring->tail == c->rx_ov_at)) {
+			/* what came after this point was lost, the buffer in progress closes with OV */
+			c->rx_ov_pending = 0;
+			status = status | SCC_RXBD_OV;
+			act = (r_cnt > 0) ? UART_RX_CLOSE : 0;
+			n = 0;
+		} else if (c->uart_brk_pending && (ring->tail == c->uart_brk_at)) {
+			/* a break closes the buffer in progress */
+			c->uart_brk_pending = 0;
+			if (r_cnt == 0)
+				continue;
+			else { /* QAC */ }
+			status = status | UART_RXBD_BR;
+			act = UART_RX_CLOSE;
+			n = 0;
+		} else {
+			n = sizeof(buf);
+			if (mrblr)
+				n = MIN(n, mrblr - r_cnt);
+			else { /* QAC */ }
+			if (c->uart_brk_pending)
+				n = MIN(n, c->uart_brk_at - ring->tail);
+			else { /* QAC */ }
+			if (c->rx_ov_pending)
+				n = MIN(n, c->rx_ov_at - ring->tail);
+			else { /* QAC */ }
+			n = cpm_ring_peek( ring, buf, n );
+
+			/* one bit test per character, the burst stops at the first flagged one;
+			   after a BISYNC DLE or control character the next one is taken alone */
+			i = 0;
+			if (!c->bsc_rx_dle && !c->bsc_rx_bcs) {
+				for (; (i < n) && !test_bit( buf[i], c->uart_special ); i++)
+					;
+			} else { /* QAC */ }
+			if (i > 0) {
+				cpm_ring_drop( ring, i );
+				n = c->uart_hunt ? 0 : i;
+				if (c->uart_data_mask != 0xff) {
+					for (i = 0; i < n; i++)
+						buf[i] = buf[i] & c->uart_data_mask;
+				} else { /* QAC */ }
+				if (bsc && (c->psmr & PSMR_BSC_RBCS))
+					c->bsc_rx_crc = mpc8560_cpm_bsc_crc( c, c->bsc_rx_crc, buf, n );
+				else { /* QAC */ }
+			} else if (n > 0) {
+				if (bsc)
+					act = mpc8560_cpm_bsc_rx_char( c, buf[0], &ch, &cstatus );
+				else
+					act = mpc8560_cpm_uart_rx_char( c, buf[0], &ch, &cstatus );
+				if ((act & UART_RX_OPEN) && (r_cnt > 0)) {
+					/* the address is taken again once its own buffer is open */
+					act = UART_RX_CLOSE;
+					n = 0;
+				} else {
+					cpm_ring_drop( ring, 1 );
+					status = status | cstatus;
+					buf[0] = ch;
+					n = (act & UART_RX_STORE) ? 1 : 0;
+				}
+			} else { /* QAC */ }
+		}
+
+		if (n > 0) {
+			if (mpc8560_cpm_sdma_write( s, r_ptr, buf, n ) < 0) {
+				/* reported through SMEVR, the buffer closes on what it already holds */
+				mpc8560_cpm_scc_rx_close( c, &bds, &bd, status | SCC_RXBD_OV );
+				return ;
+			} else { /* QAC */ }
+			r_cnt += n;
+			r_ptr += n;
+			cpm_bd_set_len( &bds, &bd, r_cnt );
+			c->stats.rx_bytes += n;
+		} else { /* QAC */ }
+
+		if (mrblr && (r_cnt == mrblr)) /* MRBLR = N bytes for this SCC */
+			act = act | UART_RX_CLOSE;
+		else { /* QAC */ }
+		if (act & UART_RX_CLOSE) {
+			mpc8560_cpm_scc_rx_close( c, &bds, &bd, status );
+			status = 0;
+			r_cnt = 0;
+			if (!cpm_bd_fetch( &bds, &bd )) {
+				/* no more available BD, the rest stays in the ring */
+				if ((cpm_ring_used( ring ) > 0) || c->uart_brk_pending)
+					mpc8560_cpm_scc_rx_stall( c );
+				else { /* QAC */ }
+				return ;
+			} else { /* QAC */ }
+			r_ptr = bd.ptr;
+		} else { /* QAC */ }
+	}
+	
+	if (c->rx_ov_pending && (ring->tail == c->rx_ov_at) && (r_cnt > 0)) {
+		c->rx_ov_pending = 0;
+		status = status | SCC_RXBD_OV;
+	} else { /* QAC */ }
+	if (r_cnt > 0)
+		mpc8560_cpm_scc_rx_close( c, &bds, &bd, status );
+	else { /* QAC */ }
+
+	return ;
+}
+
+static inline void scc_update_status_rxbd(CPMScc* c)
+{
+	if ((cpm_ring_used( &(c->rx_ring) ) > 0) || c->uart_brk_pending)
+		mpc8560_cpm_frame_rx_cb( c );
+	
+	return ;
+}
+
+static int scc_can_receive(void* opaque)
+{
+	CPMScc* c = (CPMScc*)opaque;
+
+	/* the backend is held off instead of dropping, until the RxBDs catch up */
+	return cpm_ring_free( &(c->rx_ring) );
+}
+
+static void scc_update_timer_cb(CPMScc* c)
+{
+	DPRINTF("HIT");	// etjotest
+	qemu_del_timer( c->status_poll );
+
+	/* TODO : check poll mode and set poll flag */
+
+	/* TODO : write code here */
+
+	/* RxBD Empty */
+	scc_update_status_rxbd( c );
+	/* FIXME : setup response latency with proper value */
+	//if( polling_enabled )
+	if (0)
+	qemu_mod_timer( c->status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 100 ); /* 10ms */
+	
+	return ;
+}
+
+static void scc_fifo_timeout_int(CPMScc* c)
+{
+	return ;
+}
+
+static void scc_receive(void* opaque, const uint8_t* buf, int size)
+{
+	CPMScc* c = (CPMScc*)opaque;
+	DPRINTF("scc%d buf (%x) size %d", c->idx + 1, buf[0], size ); // etjotest
+
+	/* DIAG echo: the line data is retransmitted as it arrives */
+	if (GSMR_L_DIAG(c->gsmr_l) & SCC_DIAG_ECHO)
+		mpc8560_cpm_scc_echo( c, buf, size );
+	else { /* QAC */ }
+	/* DIAG loopback: the receiver only listens to our own transmitter */
+	if (GSMR_L_DIAG(c->gsmr_l) & SCC_DIAG_LOOPBACK)
+		return ;
+	else { /* QAC */ }
+	mpc8560_cpm_scc_tap( c, 0, buf, size );
+
+	if( cpm_ring_push( &(c->rx_ring), buf, size ) < (uint32_t)size )
+		mpc8560_cpm_scc_overrun( c );
+	else { /* QAC */ }
+	
+	/* Set Empty bit of RxBD */
+	qemu_mod_timer( c->status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 100 ); /* 10ms */
+	
+	return ;
+}
+
+static void scc_event(void* opaque, int event)
+{
+	CPMScc* c = (CPMScc*)opaque;
+
+	DPRINTF("scc%d event %x", c->idx + 1, event);
+	if ((event == CHR_EVENT_BREAK) && (GSMR_L_MODE(c->gsmr_l) == GSMR_MODE_UART)) {
+		mpc8560_cpm_uart_count( c, UR_BRKEC );
+		/* the buffer closes once the characters received ahead of the break are in */
+		if (!c->uart_brk_pending) {
+			c->uart_brk_at = c->rx_ring.head;
+			c->uart_brk_pending = 1;
+		} else { /* QAC */ }
+		c->scce = c->scce | SCCE_BRKS_MASK | SCCE_BRKE_MASK;
+		mpc8560_cpm_scc_set_irq( c );
+		qemu_mod_timer( c->status_poll, qemu_get_clock_ns(vm_clock) + get_ticks_per_sec() / 100 ); /* 10ms */
+	} else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static uint64_t mpc8560_cpm_sccx_read(void* opaque, hwaddr addr, unsigned size)
+ * @brief SCC1 ~ 4 share one register layout, 0x20 apart
+ *
+ */
+static uint64_t mpc8560_cpm_sccx_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	CPMState* s = (CPMState*)opaque;
+	const int n = addr / CPM_SCC_STRIDE;
+	CPMScc* c = &(s->scc[n]);
+	hwaddr r = addr & (CPM_SCC_STRIDE - 1);
+
+	if (!CPM_HAS(s, BLK_SCC_1 + n))
+		return 0;
+	else { /* QAC */ }
+
+	switch( r ) {
+	case BCTS(CPM_REG_GSMR_L1): case BCTS(CPM_REG_GSMR_L1) + 0x1:
+	case BCTS(CPM_REG_GSMR_L1) + 0x2: case BCTS(CPM_REG_GSMR_L1) + 0x3:
+		PARTIAL_READ(BCTS(CPM_REG_GSMR_L1), c->gsmr_l, r, size, ret);
+		break;
+	case BCTS(CPM_REG_GSMR_H1): case BCTS(CPM_REG_GSMR_H1) + 0x1:
+	case BCTS(CPM_REG_GSMR_H1) + 0x2: case BCTS(CPM_REG_GSMR_H1) + 0x3:
+		PARTIAL_READ(BCTS(CPM_REG_GSMR_H1), c->gsmr_h, r, size, ret);
+		break;
+	case BCTS(CPM_REG_PSMR1):
+	case BCTS(CPM_REG_PSMR1) + 0x1:
+		PARTIAL_READ(BCTS(CPM_REG_PSMR1), c->psmr, r, size, ret);
+		break;
+	case BCTS(CPM_REG_TODR1):
+		PARTIAL_READ(BCTS(CPM_REG_TODR1), c->todr, r, size, ret);
+		break;
+	case BCTS(CPM_REG_DSR1):
+		ret = c->dsr;
+		break;
+	case BCTS(CPM_REG_SCCE1):
+	case BCTS(CPM_REG_SCCE1) + 0x1:
+		PARTIAL_READ(BCTS(CPM_REG_SCCE1), c->scce, r, size, ret);
+		break;
+	case BCTS(CPM_REG_RESV1):
+	case (BCTS(CPM_REG_RESV1) + 0x1):
+		PARTIAL_READ(BCTS(CPM_REG_RESV1), c->resv, r, size, ret);
+		break;
+	case BCTS(CPM_REG_SCCM1):
+	case BCTS(CPM_REG_SCCM1) + 0x1:
+		PARTIAL_READ(BCTS(CPM_REG_SCCM1), c->sccm, r, size, ret);
+		break;
+	case BCTS(CPM_REG_SCCS1):
+		ret = c->sccs;
+		break;
+
+	default : /* should never reach here */
+		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
+					__func__, __LINE__, (int)addr);
+	}
+
+	DPRINTF("opaque=%p, addr=%x, size=%x ret=%x", opaque, (uint32_t)addr, size, ret);
+	return ret;
+}
+
+/**
+ * @fn static void mpc8560_cpm_sccx_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+ * @brief SCC1 ~ 4 share one register layout, 0x20 apart
+ *
+ */
+static void mpc8560_cpm_sccx_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMState* s = (CPMState*)opaque;
+	int n = addr / CPM_SCC_STRIDE;
+	CPMScc* c = &(s->scc[n]);
+	hwaddr r = addr & (CPM_SCC_STRIDE - 1);
+
+	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
+	if (!CPM_HAS(s, BLK_SCC_1 + n))
+		return ;
+	else { /* QAC */ }
+	/* TODO : scale 'value' according to size?? */	
+	switch( r )
+	{
+		case BCTS(CPM_REG_GSMR_L1):	case BCTS(CPM_REG_GSMR_L1) + 0x1:
+		case BCTS(CPM_REG_GSMR_L1) + 0x2: case BCTS(CPM_REG_GSMR_L1) + 0x3:
+			PARTIAL_WRITE(BCTS(CPM_REG_GSMR_L1), c->gsmr_l, r, size, value);
+			DPRINTF("gsmr_l%d -> %x", n + 1, c->gsmr_l);
+			mpc8560_cpm_uart_compile(c);
+			mpc8560_cpm_scc_bd_poll_arm(c);
+			break;
+		case BCTS(CPM_REG_GSMR_H1): case BCTS(CPM_REG_GSMR_H1) + 0x1:
 		case BCTS(CPM_REG_GSMR_H1) + 0x2: case BCTS(CPM_REG_GSMR_H1) + 0x3:
-			PARTIAL_WRITE(BCTS(CPM_REG_GSMR_H1), s->gsmr_h1, addr, size, value);
-			DPRINTF("gsmr_h1 -> %x", s->gsmr_h1);
+			PARTIAL_WRITE(BCTS(CPM_REG_GSMR_H1), c->gsmr_h, r, size, value);
+			DPRINTF("gsmr_h%d -> %x", n + 1, c->gsmr_h);
 			break;
 		case BCTS(CPM_REG_PSMR1):
 		case BCTS(CPM_REG_PSMR1) + 0x1:
-			PARTIAL_WRITE(BCTS(CPM_REG_PSMR1), s->psmr1, addr, size, value);
-			DPRINTF("psmr1 -> %x", s->psmr1);
+			PARTIAL_WRITE(BCTS(CPM_REG_PSMR1), c->psmr, r, size, value);
+			DPRINTF("psmr%d -> %x", n + 1, c->psmr);
+			mpc8560_cpm_uart_compile(c);
 			break;
 		case BCTS(CPM_REG_TODR1):
-			PARTIAL_WRITE(BCTS(CPM_REG_TODR1), s->todr1, addr, size, value);
-			DPRINTF("todr1 -> %x", s->todr1);
+			PARTIAL_WRITE(BCTS(CPM_REG_TODR1), c->todr, r, size, value);
+			DPRINTF("todr%d -> %x", n + 1, c->todr);
+			if (c->todr & TODR_TOD)
+				mpc8560_cpm_cp_kick(s, CP_WORK_SCC_TX(n));
+			else { /* QAC */ }
 			break;
 		case BCTS(CPM_REG_DSR1):
 			value = value & 0xffff;
-			s->dsr1 = value;
-			DPRINTF("dsr1 -> %x", s->dsr1);
+			c->dsr = value;
+			DPRINTF("dsr%d -> %x", n + 1, c->dsr);
 			break;
 		case BCTS(CPM_REG_SCCE1):
 		case BCTS(CPM_REG_SCCE1) + 0x1:
 			{
-				uint32_t old_scce = s->scce1;
+				uint32_t old_scce = c->scce;
 				value = value & 0xffff;
 				/* SCCE bits are cleared by writing ones; writing zeros has no effect */
-				PARTIAL_WRITE_REVERSE(BCTS(CPM_REG_SCCE1), s->scce1, addr, size, value);
-				//PARTIAL_WRITE(BCTS(CPM_REG_SCCE1), s->scce1, addr, size, value);
+				PARTIAL_WRITE_REVERSE(BCTS(CPM_REG_SCCE1), c->scce, r, size, value);
+				DPRINTF("scce%d -> %x", n + 1, c->scce);
 				/* When a pending interrupt is handled, the user clears the corresponding SIPNR bit.
 				   If an event register exists, the unmasked event register bits should be cleared instead,
 				   causing the SIPNR bit to be cleared.
 				 */
-				if( value & 0x0003 ) /* TX or RX */
-				{
-					s->sipnr_l = s->sipnr_l & ~(0x800000);
-
-					if( old_scce )
-					{
-						DPRINTF("IRQ LOWER~~~~~~value (%d) scce(%d)", value, s->scce1);
-						qemu_irq_lower(s->irq); // test
-					}
-				}
-				DPRINTF("scce1 -> %x", s->scce1);
+				if (old_scce && !(c->scce & c->sccm)) {
+					DPRINTF("IRQ LOWER~~~~~~value (%d) scce(%d)", value, c->scce);
+					mpc8560_cpm_lat_ack(&(c->irq_lat));
+					mpc8560_cpm_clear_int(s, IC_SCC_1 + n);
+				} else { /* QAC */ }
+				/* the RX handler has run, RxBDs are most likely back */
+				if ((value & SCCE_RX_MASK) && c->rx_stalled)
+					mpc8560_cpm_cp_kick(s, CP_WORK_SCC_RX(n));
+				else { /* QAC */ }
 			}
 			break;
 		case BCTS(CPM_REG_RESV1): /* FIXME : behavior of reserved area is not defined */
 		case (BCTS(CPM_REG_RESV1) + 1):
-		//	s->scce1 = s->scce1 | value;
-		//	s->sccm1 = s->sccm1 | value;
-			PARTIAL_WRITE(BCTS(CPM_REG_RESV1), s->scc_resv1, addr, size, value);
-			DPRINTF("scc_resv1 -> %x", s->scc_resv1);
+			PARTIAL_WRITE(BCTS(CPM_REG_RESV1), c->resv, r, size, value);
+			DPRINTF("scc_resv%d -> %x", n + 1, c->resv);
 			/* test start*/
-			s->sccm1 = s->scc_resv1;
-		//	if( s->sccm1 & SCCE_TX_MASK )
-		//		mpc8560_cpm_set_irq(opaque);
+			c->sccm = c->resv;
 			/* test end */
+			if (!(c->scce & c->sccm))
+				mpc8560_cpm_lat_ack(&(c->irq_lat));
+			else { /* QAC */ }
 			break;
 		case BCTS(CPM_REG_SCCM1):
 		case BCTS(CPM_REG_SCCM1) + 0x1:
 			value = value & 0xffff;
-			PARTIAL_WRITE(BCTS(CPM_REG_SCCM1), s->sccm1, addr, size, value);
-			DPRINTF("sccm1 -> %x", s->sccm1);
+			PARTIAL_WRITE(BCTS(CPM_REG_SCCM1), c->sccm, r, size, value);
+			DPRINTF("sccm%d -> %x", n + 1, c->sccm);
+			/* masking the pending events serves the interrupt as far as the histogram goes, as FCCM does */
+			if (!(c->scce & c->sccm))
+				mpc8560_cpm_lat_ack(&(c->irq_lat));
+			else { /* QAC */ }
 			break;
 		case BCTS(CPM_REG_SCCS1):
 			value = value & 0xff;
-			s->sccs1 = value;
-			DPRINTF("sccs1 -> %x", s->sccs1);
+			c->sccs = value;
+			DPRINTF("sccs%d -> %x", n + 1, c->sccs);
 			break;
 
-		/* SCC2 */
-		case BCTS(CPM_REG_GSMR_L2):
-			s->gsmr_l2 = value;
-			DPRINTF("gsmr_l2 -> %x", s->gsmr_l2);
-			break;
-		case BCTS(CPM_REG_GSMR_H2):
-			s->gsmr_h2 = value;
-			DPRINTF("gsmr_h2 -> %x", s->gsmr_h2);
-			break;
-		case BCTS(CPM_REG_PSMR2):
-			value = value & 0xffff;
-			s->psmr2 = value;
-			DPRINTF("psmr2 -> %x", s->psmr2);
-			break;
-		case BCTS(CPM_REG_TODR2):
-			value = value & 0xffff;
-			s->todr2 = value;
-			DPRINTF("todr2 -> %x", s->todr2);
-			break;
-		case BCTS(CPM_REG_DSR2):
-			value = value & 0xffff;
-			s->dsr2 = value;
-			DPRINTF("dsr2 -> %x", s->dsr2);
-			break;
-		case BCTS(CPM_REG_SCCE2):
-			value = value & 0xffff;
-			s->scce2 = value;
-			DPRINTF("scce2 -> %x", s->scce2);
-			break;
-		case BCTS(CPM_REG_SCCM2):
-			value = value & 0xffff;
-			s->sccm2 = value;
-			DPRINTF("sccm2 -> %x", s->sccm2);
-			break;
-		case BCTS(CPM_REG_SCCS2):
-			value = value & 0xff;
-			s->sccs2 = value;
-			DPRINTF("sccs2 -> %x", s->sccs2);
-			break;
-#if 0
-		/* SCC3 */
-		case BCTS(CPM_REG_GSMR_L3):
-			break;
-		case BCTS(CPM_REG_GSMR_H3):
-			break;
-		case BCTS(CPM_REG_PSMR3):
-			break;
-		case BCTS(CPM_REG_TODR3):
-			break;
-		case BCTS(CPM_REG_DSR3):
-			break;
-		case BCTS(CPM_REG_SCCE3):
+		default :
+			fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
+					__func__, __LINE__, (int)addr, (unsigned)value);
+	}
+	return ;
+}
+
+/**
+ * @fn static inline uint32_t mpc8560_cpm_hdlc_crc(uint32_t crc, uint8_t ch, int wide)
+ * @brief CRC-16 CCITT (reflected) or CRC-32 update over one byte
+ *
+ */
+static inline uint32_t mpc8560_cpm_hdlc_crc(uint32_t crc, uint8_t ch, int wide)
+{
+	int i;
+
+	if (wide)
+		return crc32(crc, &ch, 1);
+	else { /* QAC */ }
+
+	crc = crc ^ ch;
+	for (i = 0; i < 8; i++)
+		crc = (crc & 0x1) ? ((crc >> 1) ^ 0x8408) : (crc >> 1);
+
+	return crc;
+}
+
+static inline uint32_t mpc8560_cpm_hdlc_crc_init(int wide)
+{
+	return wide ? crc32(0L, Z_NULL, 0) : 0xffff;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_update_irq(CPMState* s, int m)
+ * @brief (MCCE & MCCM) -> SIPNR
+ *
+ */
+static void mpc8560_cpm_mcc_update_irq(CPMState* s, int m)
+{
+	if (s->mcc[m].mcce & s->mcc[m].mccm) {
+		mpc8560_cpm_lat_raise(&(s->mcc[m].irq_lat));
+		mpc8560_cpm_raise_int(s, IC_MCC_1 + m);
+	} else {
+		mpc8560_cpm_lat_ack(&(s->mcc[m].irq_lat));
+		mpc8560_cpm_clear_int(s, IC_MCC_1 + m);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_event(CPMState* s, int ch, uint16_t ev, int tx)
+ * @brief Posts a channel event into the TX or RX interrupt circular table
+ *
+ */
+static void mpc8560_cpm_mcc_event(CPMState* s, int ch, uint16_t ev, int tx)
+{
+	int m = ch / CPM_MCC_PER_MCC;
+	const hwaddr page = MCC_PAGE(m);
+	hwaddr base;
+	hwaddr ptr;
+	uint32_t ent;
+
+	if (!(lduw_phys(MCC_CH_PARAM(ch) + MC_INTMSK) & ev))
+		return ;
+	else { /* QAC */ }
+
+	base = ldl_phys(page + (tx ? MR_TINTBASE : MR_RINTBASE0));
+	ptr = ldl_phys(page + (tx ? MR_TINTPTR : MR_RINTPTR0));
+	ent = ldl_phys(ptr);
+	if (ent & MCC_INT_V) {
+		/* the guest has not consumed this entry yet */
+		s->mcc[m].mcce = s->mcc[m].mcce | MCCE_IQOV;
+	} else {
+		stl_phys(ptr, (ent & MCC_INT_W) | MCC_INT_V
+				| ((ch % CPM_MCC_PER_MCC) << MCC_INT_CHNUM_SHIFT) | ev);
+		ptr = (ent & MCC_INT_W) ? base : (ptr + 4);
+		stl_phys(page + (tx ? MR_TINTPTR : MR_RINTPTR0), ptr);
+		s->mcc[m].mcce = s->mcc[m].mcce | (tx ? MCCE_TINT : MCCE_RINT0);
+		s->mcc_ch[ch].stats.irqs++;
+	}
+	mpc8560_cpm_mcc_update_irq(s, m);
+
+	return ;
+}
+
+static inline hwaddr mpc8560_cpm_mcc_xtra(int ch)
+{
+	return DPRAM_ADDR(lduw_phys(MCC_PAGE(ch / CPM_MCC_PER_MCC) + MR_XTRABASE)
+			+ ((ch % CPM_MCC_PER_MCC) * MX_SIZE));
+}
+
+static inline hwaddr mpc8560_cpm_mcc_bd(int ch, TYPE_MCC_XTRA_OFFSET ptr)
+{
+	return ldl_phys(MCC_PAGE(ch / CPM_MCC_PER_MCC) + MR_MCCBASE)
+		+ lduw_phys(mpc8560_cpm_mcc_xtra(ch) + ptr);
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_bd_advance(int ch, uint16_t status, TYPE_MCC_XTRA_OFFSET ptr, TYPE_MCC_XTRA_OFFSET base)
+ * @brief Moves TBPTR/RBPTR to the next BD, or back to the base on W
+ *
+ */
+static void mpc8560_cpm_mcc_bd_advance(int ch, uint16_t status, TYPE_MCC_XTRA_OFFSET ptr, TYPE_MCC_XTRA_OFFSET base)
+{
+	hwaddr x = mpc8560_cpm_mcc_xtra(ch);
+
+	if (status & MCC_BD_W)
+		stw_phys(x + ptr, lduw_phys(x + base));
+	else
+		stw_phys(x + ptr, lduw_phys(x + ptr) + 0x8);
+
+	return ;
+}
+
+/**
+ * @fn static inline void mpc8560_cpm_mcc_tx_put(CPMMccChannel* c, uint8_t byte, int stuff)
+ * @brief Queues one byte as serial bits, HDLC goes LSB first with zero insertion
+ *
+ */
+static inline void mpc8560_cpm_mcc_tx_put(CPMMccChannel* c, uint8_t byte, int stuff)
+{
+	uint32_t bit;
+	int i;
+
+	if (!c->hdlc) {
+		for (i = 7; i >= 0; i--)
+			c->tx_q = c->tx_q | (((byte >> i) & 0x1) << (c->tx_qlen++));
+
+		return ;
+	} else { /* QAC */ }
+
+	for (i = 0; i < 8; i++) {
+		bit = (byte >> i) & 0x1;
+		c->tx_q = c->tx_q | (bit << (c->tx_qlen++));
+		if (!stuff)
+			continue;
+		else if (!bit)
+			c->tx_ones = 0;
+		else if (++(c->tx_ones) == 5) {
+			c->tx_qlen++; /* inserted zero */
+			c->tx_ones = 0;
+		} else { /* QAC */ }
+	}
+	if (!stuff)
+		c->tx_ones = 0;
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_tap_add(CPMState* s, int ch, GByteArray** a, uint32_t* flen, const uint8_t* buf, uint32_t len)
+ * @brief Gathers channel data into the frame the capture gets once it is complete
+ *
+ */
+static void mpc8560_cpm_mcc_tap_add(CPMState* s, int ch, GByteArray** a, uint32_t* flen,
+		const uint8_t* buf, uint32_t len)
+{
+	if (!s->tap[TAP_MCC_1 + (ch / CPM_MCC_PER_MCC)].on)
+		return ;
+	else { /* QAC */ }
+
+	if (!*a)
+		*a = g_byte_array_new();
+	else { /* QAC */ }
+	if (*flen < CPM_TAP_SNAPLEN)
+		g_byte_array_append(*a, buf, MIN(len, CPM_TAP_SNAPLEN - *flen));
+	else { /* QAC */ }
+	*flen += len;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_tap_frame(CPMState* s, int ch, int tx, GByteArray* a, uint32_t* flen)
+ * @brief Captures the gathered frame, if any, and starts the next one, drop just starts over
+ *
+ */
+static inline void mpc8560_cpm_mcc_tap_drop(GByteArray* a, uint32_t* flen)
+{
+	if (a)
+		g_byte_array_set_size(a, 0);
+	else { /* QAC */ }
+	*flen = 0;
+
+	return ;
+}
+
+static void mpc8560_cpm_mcc_tap_frame(CPMState* s, int ch, int tx, GByteArray* a, uint32_t* flen)
+{
+	if (a && *flen)
+		mpc8560_cpm_tap_put(s, TAP_MCC_1 + (ch / CPM_MCC_PER_MCC), ch % CPM_MCC_PER_MCC, tx, a->data, *flen);
+	else { /* QAC */ }
+	mpc8560_cpm_mcc_tap_drop(a, flen);
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_mcc_tx_fetch(CPMState* s, int ch)
+ * @brief Opens the TxBD at TBPTR, returns 0 if it is not ready
+ *
+ */
+static int mpc8560_cpm_mcc_tx_fetch(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+
+	c->tx_bd = mpc8560_cpm_mcc_bd(ch, MX_TBPTR);
+	if (!(lduw_phys(c->tx_bd) & MCC_TXBD_R))
+		return 0;
+	else { /* QAC */ }
+
+	c->tx_len = lduw_phys(c->tx_bd + 0x2);
+	c->tx_ptr = ldl_phys(c->tx_bd + 0x4);
+	c->tx_off = 0;
+	c->tx_pf_pos = 0;
+	c->tx_pf_len = 0;
+
+	return 1;
+}
+
+/**
+ * @fn static uint16_t mpc8560_cpm_mcc_tx_close(CPMState* s, int ch)
+ * @brief Hands the current TxBD back to the guest
+ *
+ */
+static uint16_t mpc8560_cpm_mcc_tx_close(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint16_t status = lduw_phys(c->tx_bd);
+
+	stw_phys(c->tx_bd, status & ~(MCC_TXBD_R));
+	mpc8560_cpm_mcc_bd_advance(ch, status, MX_TBPTR, MX_TBASE);
+	c->stats.tx_bds++;
+	if (status & MCC_TXBD_L)
+		c->stats.tx_frames++;
+	else { /* QAC */ }
+	if (status & MCC_BD_I)
+		mpc8560_cpm_mcc_event(s, ch, MCC_EV_TXB, 1);
+	else { /* QAC */ }
+
+	return status;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_tx_fill(CPMState* s, int ch)
+ * @brief Queues at least one more byte worth of serial bits
+ *
+ */
+static void mpc8560_cpm_mcc_tx_fill(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint16_t status;
+	uint32_t fcs;
+	uint8_t byte;
+
+	switch( c->tx_state ) {
+	case MCC_TX_IDLE:
+		if (!c->tx_on || !mpc8560_cpm_mcc_tx_fetch(s, ch)) {
+			/* flags between HDLC frames, all ones on a transparent channel */
+			mpc8560_cpm_mcc_tx_put(c, c->hdlc ? HDLC_FLAG : 0xff, 0);
 			break;
-		case BCTS(CPM_REG_SCCM3):
+		} else { /* QAC */ }
+
+		c->tx_state = MCC_TX_DATA;
+		c->tx_crc = mpc8560_cpm_hdlc_crc_init(c->crc32);
+		if (c->hdlc) {
+			mpc8560_cpm_mcc_tx_put(c, HDLC_FLAG, 0); /* opening flag */
 			break;
-		case BCTS(CPM_REG_SCCS3):
+		} else { /* QAC */ }
+		/* fall through */
+	case MCC_TX_DATA:
+		if (c->tx_off < c->tx_len) {
+			if (c->tx_pf_pos == c->tx_pf_len) {
+				c->tx_pf_pos = 0;
+				c->tx_pf_len = MIN(CPM_SDMA_BURST, c->tx_len - c->tx_off);
+				if (mpc8560_cpm_sdma_read(s, c->tx_ptr + c->tx_off, c->tx_pf, c->tx_pf_len) < 0) {
+					/* the channel halts on a bus error */
+					mpc8560_cpm_mcc_tap_drop(c->tx_tap, &(c->tx_tap_len));
+					c->tx_pf_len = 0;
+					c->tx_on = 0;
+					c->tx_state = MCC_TX_IDLE;
+					mpc8560_cpm_mcc_tx_put(c, c->hdlc ? HDLC_FLAG : 0xff, 0);
+					break;
+				} else { /* QAC */ }
+				mpc8560_cpm_mcc_tap_add(s, ch, &(c->tx_tap), &(c->tx_tap_len), c->tx_pf, c->tx_pf_len);
+				c->stats.tx_bytes += c->tx_pf_len;
+			} else { /* QAC */ }
+			byte = c->tx_pf[c->tx_pf_pos++];
+			c->tx_off++;
+			c->tx_crc = mpc8560_cpm_hdlc_crc(c->tx_crc, byte, c->crc32);
+			mpc8560_cpm_mcc_tx_put(c, byte, 1);
+		} else { /* QAC */ }
+		if (c->tx_off < c->tx_len)
 			break;
+		else { /* QAC */ }
+
+		status = mpc8560_cpm_mcc_tx_close(s, ch);
+		/* a transparent channel has no frames, the capture takes each BD */
+		if (!c->hdlc || (status & MCC_TXBD_L))
+			mpc8560_cpm_mcc_tap_frame(s, ch, 1, c->tx_tap, &(c->tx_tap_len));
+		else { /* QAC */ }
+		if (status & MCC_TXBD_L) {
+			c->tx_state = c->hdlc ? MCC_TX_FCS : MCC_TX_IDLE;
+			c->tx_fcs_idx = 0;
+		} else if (!mpc8560_cpm_mcc_tx_fetch(s, ch)) {
+			/* underrun in the middle of a frame, abort it with ones, the capture keeps what went out */
+			mpc8560_cpm_mcc_tap_frame(s, ch, 1, c->tx_tap, &(c->tx_tap_len));
+			c->tx_q = c->tx_q | (0xff << c->tx_qlen);
+			c->tx_qlen += 8;
+			c->tx_ones = 0;
+			c->tx_state = MCC_TX_IDLE;
+			mpc8560_cpm_mcc_event(s, ch, MCC_EV_UN, 1);
+		} else { /* QAC */ }
+		break;
+	case MCC_TX_FCS:
+		fcs = c->crc32 ? c->tx_crc : (~(c->tx_crc) & 0xffff);
+		mpc8560_cpm_mcc_tx_put(c, (fcs >> (8 * c->tx_fcs_idx)) & 0xff, 1);
+		if (++(c->tx_fcs_idx) == (c->crc32 ? 4 : 2))
+			c->tx_state = MCC_TX_CLOSE;
+		else { /* QAC */ }
+		break;
+	case MCC_TX_CLOSE:
+	default :
+		mpc8560_cpm_mcc_tx_put(c, HDLC_FLAG, 0);
+		c->tx_state = MCC_TX_IDLE;
+	}
+
+	return ;
+}
+
+/**
+ * @fn static uint32_t mpc8560_cpm_mcc_tx_pull(CPMState* s, int ch, int nbits)
+ * @brief Takes up to 8 serial bits, the first one ends up in the MSB
+ *
+ */
+static uint32_t mpc8560_cpm_mcc_tx_pull(CPMState* s, int ch, int nbits)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint32_t out = 0;
+	int i;
+
+	while (c->tx_qlen < nbits)
+		mpc8560_cpm_mcc_tx_fill(s, ch);
+
+	for (i = 0; i < nbits; i++) {
+		out = (out << 1) | (c->tx_q & 0x1);
+		c->tx_q = c->tx_q >> 1;
+	}
+	c->tx_qlen -= nbits;
+
+	return out;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_rx_flush(CPMState* s, int ch)
+ * @brief Writes the gathered bytes at the tail of the open RxBD
+ *
+ */
+static void mpc8560_cpm_mcc_rx_flush(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+
+	if (!c->rx_pf_len)
+		return ;
+	else { /* QAC */ }
+
+	mpc8560_cpm_mcc_tap_add(s, ch, &(c->rx_tap), &(c->rx_tap_len), c->rx_pf, c->rx_pf_len);
+	if (mpc8560_cpm_sdma_write(s, c->rx_ptr + c->rx_cnt - c->rx_pf_len, c->rx_pf, c->rx_pf_len) < 0) {
+		/* the channel halts on a bus error */
+		c->rx_on = 0;
+	} else { /* QAC */ }
+	c->rx_pf_len = 0;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_rx_close(CPMState* s, int ch, uint16_t flags, uint16_t len, uint16_t ev)
+ * @brief Hands the open RxBD back to the guest
+ *
+ */
+static void mpc8560_cpm_mcc_rx_close(CPMState* s, int ch, uint16_t flags, uint16_t len, uint16_t ev)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint16_t status = lduw_phys(c->rx_bd);
+
+	mpc8560_cpm_mcc_rx_flush(s, ch);
+	if (c->rx_first)
+		flags = flags | MCC_RXBD_F;
+	else { /* QAC */ }
+	c->rx_first = !!(flags & MCC_RXBD_L);
+
+	stw_phys(c->rx_bd + 0x2, len);
+	stw_phys(c->rx_bd, (status & ~(MCC_RXBD_E | MCC_RXBD_STATUS)) | flags);
+	if (!c->hdlc || (flags & MCC_RXBD_L))
+		mpc8560_cpm_mcc_tap_frame(s, ch, 0, c->rx_tap, &(c->rx_tap_len));
+	else { /* QAC */ }
+	mpc8560_cpm_mcc_bd_advance(ch, status, MX_RBPTR, MX_RBASE);
+	c->rx_bd = 0;
+	c->stats.rx_bds++;
+	if (flags & MCC_RXBD_L)
+		c->stats.rx_frames++;
+	else { /* QAC */ }
+	if (flags & MCC_RXBD_CR)
+		c->stats.crc_errors++;
+	else { /* QAC */ }
+	if (status & MCC_BD_I)
+		mpc8560_cpm_mcc_event(s, ch, ev, 0);
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_rx_byte(CPMState* s, int ch, uint8_t byte)
+ * @brief
+ *
+ */
+static void mpc8560_cpm_mcc_rx_byte(CPMState* s, int ch, uint8_t byte)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	hwaddr bd;
+
+	/* HDLC keeps a full BD open until the next byte, so the closing flag can still mark it L */
+	if (c->rx_bd && (c->rx_cnt >= c->rx_max))
+		mpc8560_cpm_mcc_rx_close(s, ch, 0, c->rx_cnt, MCC_EV_RXB);
+	else { /* QAC */ }
+
+	if (!c->rx_bd) {
+		bd = mpc8560_cpm_mcc_bd(ch, MX_RBPTR);
+		if (!(lduw_phys(bd) & MCC_RXBD_E)) {
+			/* no buffer, the rest of the frame is lost */
+			c->stats.overruns++;
+			mpc8560_cpm_mcc_event(s, ch, MCC_EV_BSY, 0);
+			c->rx_hunt = c->hdlc;
+			return ;
+		} else { /* QAC */ }
+		c->rx_bd = bd;
+		c->rx_ptr = ldl_phys(bd + 0x4);
+		c->rx_max = lduw_phys(MCC_PAGE(ch / CPM_MCC_PER_MCC) + MR_MRBLR);
+		c->rx_cnt = 0;
+	} else { /* QAC */ }
+
+	c->rx_pf[c->rx_pf_len++] = byte;
+	c->rx_cnt++;
+	c->stats.rx_bytes++;
+	if (c->rx_pf_len == CPM_SDMA_BURST)
+		mpc8560_cpm_mcc_rx_flush(s, ch);
+	else { /* QAC */ }
+	c->rx_flen++;
+	if (c->hdlc)
+		c->rx_crc = mpc8560_cpm_hdlc_crc(c->rx_crc, byte, c->crc32);
+	else if (c->rx_cnt >= c->rx_max)
+		mpc8560_cpm_mcc_rx_close(s, ch, 0, c->rx_cnt, MCC_EV_RXB);
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_rx_end(CPMState* s, int ch, uint16_t flags)
+ * @brief Frame boundary (flag or abort), restarts the receiver on a fresh frame
+ *
+ */
+static void mpc8560_cpm_mcc_rx_end(CPMState* s, int ch, uint16_t flags)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint32_t fcs_len = c->crc32 ? 4 : 2;
+
+	if (!c->rx_hunt && (c->rx_flen > 0)) {
+		if (!(flags & MCC_RXBD_AB)) {
+			if (c->rx_nacc != 7) /* 7 bits of the flag itself */
+				flags = flags | MCC_RXBD_NO;
+			else { /* QAC */ }
+			if (c->rx_crc != (c->crc32 ? HDLC_CRC32_RESIDUE : HDLC_CRC16_RESIDUE))
+				flags = flags | MCC_RXBD_CR;
+			else { /* QAC */ }
+		} else { /* QAC */ }
+
+		if ((c->rx_flen <= fcs_len) && c->rx_first) {
+			c->rx_cnt = 0; /* runt, the open BD is reused */
+			c->rx_pf_len = 0;
+		} else if (c->rx_bd) {
+			if (c->rx_flen > lduw_phys(MCC_CH_PARAM(ch) + MC_MFLR))
+				flags = flags | MCC_RXBD_LG;
+			else { /* QAC */ }
+			mpc8560_cpm_mcc_rx_close(s, ch, MCC_RXBD_L | flags, c->rx_flen, MCC_EV_RXF);
+		} else { /* QAC */ }
+	} else { /* QAC */ }
+
+	/* a runt or a frame lost to a busy ring never reaches the capture */
+	mpc8560_cpm_mcc_tap_drop(c->rx_tap, &(c->rx_tap_len));
+	c->rx_hunt = !!(flags & MCC_RXBD_AB);
+	c->rx_acc = 0;
+	c->rx_nacc = 0;
+	c->rx_flen = 0;
+	c->rx_crc = mpc8560_cpm_hdlc_crc_init(c->crc32);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_rx_push(CPMState* s, int ch, uint32_t bits, int nbits)
+ * @brief Feeds up to 8 serial bits, the first one in the MSB
+ *
+ */
+static void mpc8560_cpm_mcc_rx_push(CPMState* s, int ch, uint32_t bits, int nbits)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	uint32_t bit;
+	int i;
+
+	if (!c->rx_on)
+		return ;
+	else { /* QAC */ }
+
+	for (i = nbits - 1; i >= 0; i--) {
+		bit = (bits >> i) & 0x1;
+		if (!c->hdlc) {
+			c->rx_acc = (c->rx_acc << 1) | bit;
+			if (++(c->rx_nacc) == 8) {
+				mpc8560_cpm_mcc_rx_byte(s, ch, c->rx_acc & 0xff);
+				c->rx_nacc = 0;
+			} else { /* QAC */ }
+			continue;
+		} else { /* QAC */ }
+
+		if (bit) {
+			if (c->rx_ones < 7)
+				c->rx_ones++;
+			else { /* QAC */ }
+			if (c->rx_ones == 7) {
+				if (!c->rx_hunt)
+					mpc8560_cpm_mcc_rx_end(s, ch, MCC_RXBD_AB);
+				else { /* QAC */ }
+				c->rx_hunt = 1;
+				continue;
+			} else { /* QAC */ }
+		} else if (c->rx_ones == 6) {
+			c->rx_ones = 0;
+			mpc8560_cpm_mcc_rx_end(s, ch, 0);
+			continue;
+		} else if (c->rx_ones == 5) {
+			c->rx_ones = 0; /* inserted zero */
+			continue;
+		} else {
+			c->rx_ones = 0;
+		}
+
+		if (c->rx_hunt)
+			continue;
+		else { /* QAC */ }
+
+		/* 7 bits of look-behind so that a flag never reaches the buffer */
+		c->rx_acc = c->rx_acc | (bit << (c->rx_nacc));
+		if (++(c->rx_nacc) == 15) {
+			mpc8560_cpm_mcc_rx_byte(s, ch, c->rx_acc & 0xff);
+			c->rx_acc = c->rx_acc >> 8;
+			c->rx_nacc -= 8;
+		} else { /* QAC */ }
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_init_tx(CPMState* s, int ch)
+ * @brief Copies TBASE to TBPTR and starts the transmitter
+ *
+ */
+static void mpc8560_cpm_mcc_init_tx(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	hwaddr x = mpc8560_cpm_mcc_xtra(ch);
+	uint16_t chamr = lduw_phys(MCC_CH_PARAM(ch) + MC_CHAMR);
+
+	stw_phys(x + MX_TBPTR, lduw_phys(x + MX_TBASE));
+	c->hdlc = !!(chamr & CHAMR_MODE);
+	c->crc32 = !!(chamr & CHAMR_CRC);
+	c->tx_state = MCC_TX_IDLE;
+	c->tx_q = 0;
+	c->tx_qlen = 0;
+	c->tx_ones = 0;
+	mpc8560_cpm_mcc_tap_drop(c->tx_tap, &(c->tx_tap_len));
+	c->tx_on = 1;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_mcc_init_rx(CPMState* s, int ch)
+ * @brief Copies RBASE to RBPTR and starts the receiver in hunt mode
+ *
+ */
+static void mpc8560_cpm_mcc_init_rx(CPMState* s, int ch)
+{
+	CPMMccChannel* c = &(s->mcc_ch[ch]);
+	hwaddr x = mpc8560_cpm_mcc_xtra(ch);
+	uint16_t chamr = lduw_phys(MCC_CH_PARAM(ch) + MC_CHAMR);
+
+	stw_phys(x + MX_RBPTR, lduw_phys(x + MX_RBASE));
+	c->hdlc = !!(chamr & CHAMR_MODE);
+	c->crc32 = !!(chamr & CHAMR_CRC);
+	c->rx_hunt = c->hdlc;
+	c->rx_ones = 0;
+	c->rx_acc = 0;
+	c->rx_nacc = 0;
+	c->rx_flen = 0;
+	c->rx_first = 1;
+	c->rx_bd = 0;
+	c->rx_pf_len = 0;
+	mpc8560_cpm_mcc_tap_drop(c->rx_tap, &(c->rx_tap_len));
+	c->rx_crc = mpc8560_cpm_hdlc_crc_init(c->crc32);
+	c->rx_on = 1;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_cp_cpcr_mcc_op(void* opaque)
+ * @brief MCC commands, CPCR[MCN] selects the channel
+ *
+ */
+static void mpc8560_cpm_cp_cpcr_mcc_op(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	TYPE_CP_CMD_MCC op = s->cpcr & CPCR_OPCODE_MASK;
+	int m = ((s->cpcr & CPCR_SBC_MASK) >> CPCR_SBC_SHIFT) - SC_MCC_1;
+	int ch = (s->cpcr & CPCR_MCN_MASK) >> CPCR_MCN_SHIFT;
+
+	/* MCN is global, MCC1 owns 0~127 and MCC2 owns 128~255 */
+	if ((ch / CPM_MCC_PER_MCC) != m) {
+		fprintf(stderr, "%s:%d] MCN %d is not a channel of MCC%d, command ignored.\n",
+				__func__, __LINE__, ch, m + 1);
+		return ;
+	} else { /* QAC */ }
+
+	s->mcc_ch[ch].stats.commands++;
+	switch( op ) {
+	case OP_MCC_INIT_RX_TX_PARAMS:
+		mpc8560_cpm_mcc_init_tx(s, ch);
+		mpc8560_cpm_mcc_init_rx(s, ch);
+		break;
+	case OP_MCC_INIT_RX_PARAMS:
+		mpc8560_cpm_mcc_init_rx(s, ch);
+		break;
+	case OP_MCC_INIT_TX_PARAMS:
+		mpc8560_cpm_mcc_init_tx(s, ch);
+		break;
+	case OP_MCC_STOP_TX:
+		s->mcc_ch[ch].tx_on = 0;
+		break;
+	case OP_MCC_STOP_RX:
+		s->mcc_ch[ch].rx_on = 0;
+		break;
+	default:
+		fprintf(stderr, "%s:%d] Unkown OPCODE.\n", __func__, __LINE__ );
+	}
+	DPRINTF("MCC op %x channel %d", op, ch);
+
+	return ;
+}
+
+static inline void mpc8560_cpm_si_put_bits(uint8_t* buf, uint32_t pos, uint32_t val, int n)
+{
+	int i;
+
+	for (i = n - 1; i >= 0; i--, pos++) {
+		if ((val >> i) & 0x1)
+			buf[pos >> 3] = buf[pos >> 3] | (0x80 >> (pos & 0x7));
+		else
+			buf[pos >> 3] = buf[pos >> 3] & ~(0x80 >> (pos & 0x7));
+	}
+
+	return ;
+}
+
+static inline uint32_t mpc8560_cpm_si_get_bits(const uint8_t* buf, uint32_t pos, int n)
+{
+	uint32_t val = 0;
+	int i;
+
+	for (i = 0; i < n; i++, pos++)
+		val = (val << 1) | ((buf[pos >> 3] >> (7 - (pos & 0x7))) & 0x1);
+
+	return val;
+}
+
+/**
+ * @fn static void mpc8560_cpm_si_compile(const uint16_t* ram, int start, CPMSiPlan* plan)
+ * @brief Flattens one routing table into MCC segments, unrouted bits are left out
+ *
+ */
+static void mpc8560_cpm_si_compile(const uint16_t* ram, int start, CPMSiPlan* plan)
+{
+	CPMSiSeg* seg;
+	uint32_t pos = 0;
+	uint16_t e;
+	int i;
+	int n;
+	int chunk;
+
+	plan->nseg = 0;
+	for (i = start; i < CPM_SI_RAM_ENTRIES; i++) {
+		e = ram[i];
+		for (n = SIRAM_BITS(e); n > 0; n -= chunk, pos += chunk) {
+			chunk = MIN(n, 8);
+			if (!(e & SIRAM_MCC))
+				continue;
+			else { /* QAC */ }
+			seg = &(plan->seg[plan->nseg++]);
+			seg->pos = pos;
+			seg->nbits = chunk;
+			seg->ch = SIRAM_MCSEL(e) % CPM_MCC_PER_MCC;
+		}
+		if (e & SIRAM_LST)
+			break;
+		else { /* QAC */ }
+	}
+	plan->bytes = (pos + 7) / 8;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_si_sync(CPMState* s, int si, int t)
+ * @brief Frame boundary: takes a requested shadow switch and recompiles a stale plan
+ *
+ */
+static void mpc8560_cpm_si_sync(CPMState* s, int si, int t)
+{
+	CPMSi* p = &(s->si[si]);
+	const uint8_t req = p->cmdr & (SI_CMDR_CSRR(t) | SI_CMDR_CSRT(t));
+	const uint16_t* rxram;
+	int start;
+
+	if (req) {
+		/* CSRx are cleared once the switch is done */
+		p->str = p->str ^ req;
+		p->cmdr = p->cmdr & ~req;
+		p->plan_dirty = p->plan_dirty | SI_GMR_EN(t);
+	} else { /* QAC */ }
+
+	if (!(p->plan_dirty & SI_GMR_EN(t)))
+		return ;
+	else { /* QAC */ }
+
+	start = ((p->str & SI_STR_CRORT(t)) ? SI_RSR_SSAD(p->rsr, t) : SI_MR_SAD(p->mr[t])) * CPM_SI_BANK_ENTRIES;
+	mpc8560_cpm_si_compile(p->txram, start, &(p->plan[t][0]));
+
+	rxram = (p->mr[t] & SI_MR_CRT) ? p->txram : p->rxram;
+	start = ((p->str & SI_STR_CRORR(t)) ? SI_RSR_SSAD(p->rsr, t) : SI_MR_SAD(p->mr[t])) * CPM_SI_BANK_ENTRIES;
+	mpc8560_cpm_si_compile(rxram, start, &(p->plan[t][1]));
+
+	p->plan_dirty = p->plan_dirty & ~SI_GMR_EN(t);
+	DPRINTF("SI%d TDM%c plan: tx %u segs / %u bytes, rx %u segs / %u bytes", si + 1, 'a' + t,
+			p->plan[t][0].nseg, p->plan[t][0].bytes, p->plan[t][1].nseg, p->plan[t][1].bytes);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_si_frame(CPMState* s, int si, int t, uint8_t* txf, const uint8_t* rxf)
+ * @brief Gathers one TDM frame from the MCC channels and scatters one back
+ *
+ */
+static void mpc8560_cpm_si_frame(CPMState* s, int si, int t, uint8_t* txf, const uint8_t* rxf)
+{
+	const CPMSiPlan* tx = &(s->si[si].plan[t][0]);
+	const CPMSiPlan* rx = &(s->si[si].plan[t][1]);
+	const int base = si * CPM_MCC_PER_MCC;
+	const CPMSiSeg* seg;
+	uint32_t i;
+
+	for (i = 0; i < tx->nseg; i++) {
+		seg = &(tx->seg[i]);
+		mpc8560_cpm_si_put_bits(txf, seg->pos,
+				mpc8560_cpm_mcc_tx_pull(s, base + seg->ch, seg->nbits), seg->nbits);
+	}
+
+	for (i = 0; i < rx->nseg; i++) {
+		seg = &(rx->seg[i]);
+		mpc8560_cpm_mcc_rx_push(s, base + seg->ch,
+				mpc8560_cpm_si_get_bits(rxf, seg->pos, seg->nbits), seg->nbits);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_tdm_flush(CPMSiTdm* tdm)
+ * @brief Hands the queued frames to the backend, what it does not take stays at the head of tx_batch
+ *
+ */
+static void mpc8560_cpm_tdm_flush(CPMSiTdm* tdm)
+{
+	int ret;
+
+	if (!tdm->tx_pending)
+		return ;
+	else { /* QAC */ }
+
+	ret = qemu_chr_fe_write(tdm->chr, tdm->tx_batch, tdm->tx_pending);
+	if ((ret < 0) && (errno != EAGAIN))
+		ret = tdm->tx_pending; /* a broken backend loses the data, like a cut line */
+	else if (ret < 0)
+		ret = 0;
+	else { /* QAC */ }
+	tdm->tx_pending -= ret;
+	memmove(tdm->tx_batch, tdm->tx_batch + ret, tdm->tx_pending);
+
+	if (tdm->tx_pending && !tdm->tx_watch)
+		tdm->tx_watch = qemu_chr_fe_add_watch(tdm->chr, G_IO_OUT, mpc8560_cpm_tdm_tx_watch_cb, tdm);
+	else { /* QAC */ }
+
+	return ;
+}
+
+static gboolean mpc8560_cpm_tdm_tx_watch_cb(GIOChannel* chan, GIOCondition cond, void* opaque)
+{
+	CPMSiTdm* tdm = (CPMSiTdm*)opaque;
+
+	tdm->tx_watch = 0;
+	mpc8560_cpm_tdm_flush(tdm);
+
+	return FALSE;
+}
+
+/**
+ * @fn static void mpc8560_cpm_tdm_timer_cb(void* opaque)
+ * @brief Runs CPM_TDM_BATCH_FRAMES frames on every enabled TDM and exchanges them with the backends
+ *
+ */
+static void mpc8560_cpm_tdm_timer_cb(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	CPMSi* p;
+	CPMSiTdm* tdm;
+	uint8_t rxf[CPM_TDM_MAX_FRAME];
+	uint8_t slip[CPM_TDM_MAX_FRAME];
+	uint8_t* txf;
+	uint32_t tx_len;
+	uint32_t rx_len;
+	uint32_t off;
+	int active = 0;
+	int si;
+	int t;
+	int f;
+	int i;
+
+	for (si = 0; si < CPM_NUM_SI; si++) {
+		p = &(s->si[si]);
+		for (t = 0; t < CPM_SI_TDMS; t++) {
+			if (!(p->gmr & SI_GMR_EN(t)))
+				continue;
+			else { /* QAC */ }
+			active = 1;
+			tdm = &(p->tdm[t]);
+			if (!tdm->tx_batch)
+				tdm->tx_batch = g_malloc(CPM_TDM_TX_QUEUE);
+			else { /* QAC */ }
+
+			/* frames go in behind what the backend still holds back */
+			off = tdm->tx_pending;
+			for (f = 0; f < CPM_TDM_BATCH_FRAMES; f++) {
+				mpc8560_cpm_si_sync(s, si, t);
+				tx_len = p->plan[t][0].bytes;
+				rx_len = p->plan[t][1].bytes;
+
+				if (tdm->chr && (tdm->rx_fifo.num >= rx_len)) {
+					for (i = 0; i < rx_len; i++)
+						rxf[i] = fifo8_pop(&(tdm->rx_fifo));
+				} else {
+					memset(rxf, 0xff, rx_len); /* line idle */
+				}
+				/* a backend that is a whole batch behind slips whole frames, the stream stays framed */
+				txf = ((off + tx_len) <= CPM_TDM_TX_QUEUE) ? (tdm->tx_batch + off) : slip;
+				memset(txf, 0xff, tx_len);
+				mpc8560_cpm_si_frame(s, si, t, txf, rxf);
+				if (txf != slip)
+					off += tx_len;
+				else { /* QAC */ }
+			}
+
+			if (tdm->chr) {
+				tdm->tx_pending = off;
+				mpc8560_cpm_tdm_flush(tdm);
+			} else { /* QAC */ }
+		}
+	}
+
+	if (active)
+		qemu_mod_timer(s->tdm_timer, qemu_get_clock_ns(vm_clock)
+				+ (CPM_TDM_BATCH_FRAMES * CPM_TDM_FRAME_NS));
+	else { /* QAC */ }
+
+	return ;
+}
+
+static int mpc8560_cpm_tdm_can_receive(void* opaque)
+{
+	CPMSiTdm* tdm = (CPMSiTdm*)opaque;
+
+	return tdm->rx_fifo.capacity - tdm->rx_fifo.num;
+}
+
+static void mpc8560_cpm_tdm_receive(void* opaque, const uint8_t* buf, int size)
+{
+	CPMSiTdm* tdm = (CPMSiTdm*)opaque;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		if (!fifo8_is_full(&(tdm->rx_fifo)))
+			fifo8_push(&(tdm->rx_fifo), buf[i]);
+		else
+			break; /* slip */
+	}
+
+	return ;
+}
+
+/**
+ * @fn static uint64_t mpc8560_cpm_siram_read(void* opaque, hwaddr addr, unsigned size)
+ * @brief SIxTxRAM (0x000) and SIxRxRAM (0x400), opaque is the CPMSi
+ *
+ */
+static uint64_t mpc8560_cpm_siram_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	uint16_t val;
+	CPMSi* p = (CPMSi*)opaque;
+	uint16_t* ram = (addr & SI_RAM_RX) ? p->rxram : p->txram;
+	hwaddr base = addr & ~0x1;
+
+	if ((base & ~SI_RAM_RX) >= (CPM_SI_RAM_ENTRIES * 2))
+		return ret;
+	else { /* QAC */ }
+
+	val = ram[(base & ~SI_RAM_RX) / 2];
+	PARTIAL_READ(base, val, addr, size, ret);
+
+	return ret;
+}
+
+/**
+ * @fn static void mpc8560_cpm_siram_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+ * @brief Any table write invalidates the compiled plans of that SI
+ *
+ */
+static void mpc8560_cpm_siram_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMSi* p = (CPMSi*)opaque;
+	uint16_t* ram = (addr & SI_RAM_RX) ? p->rxram : p->txram;
+	hwaddr base = addr & ~0x1;
+	uint16_t val;
+
+	if ((base & ~SI_RAM_RX) >= (CPM_SI_RAM_ENTRIES * 2))
+		return ;
+	else { /* QAC */ }
+
+	val = ram[(base & ~SI_RAM_RX) / 2];
+	PARTIAL_WRITE(base, val, addr, size, value);
+	ram[(base & ~SI_RAM_RX) / 2] = val;
+	p->plan_dirty = 0xf;
+
+	return ;
+}
+
+/**
+ *
+ *
+ *
+ */
+static uint64_t mpc8560_cpm_si_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	CPMState* s = (CPMState*)opaque;
+	const int si = (addr >> 5) & 0x1;
+	CPMSi* p = &(s->si[si]);
+
+	if (!CPM_HAS(s, BLK_MCC_1 + si))
+		return 0;
+	else { /* QAC */ }
+
+	switch( addr & 0x1f ) {
+	case BCTSI(CPM_REG_SI1AMR):
+	case BCTSI(CPM_REG_SI1BMR):
+	case BCTSI(CPM_REG_SI1CMR):
+	case BCTSI(CPM_REG_SI1DMR):
+		ret = p->mr[(addr & 0x1f) / 2];
+		break;
+	case BCTSI(CPM_REG_SI1GMR):
+		ret = p->gmr;
+		break;
+	case BCTSI(CPM_REG_SI1CMDR):
+		ret = p->cmdr;
+		break;
+	case BCTSI(CPM_REG_SI1STR):
+		ret = p->str;
+		break;
+	case BCTSI(CPM_REG_SI1RSR):
+		ret = p->rsr;
+		break;
+	case BCTSI(CPM_REG_MCCE1):
+		ret = s->mcc[si].mcce;
+		break;
+	case BCTSI(CPM_REG_MCCM1):
+		ret = s->mcc[si].mccm;
+		break;
+	case BCTSI(CPM_REG_MCCF1):
+		ret = s->mcc[si].mccf;
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
+				__func__, __LINE__, (int)addr);
+	}
+
+	DPRINTF("opaque= %p, addr= %x, size= %x ret=%x", opaque, (uint32_t)addr, size, ret);
+	return ret;
+}
+
+/**
+ *
+ *
+ *
+ */
+static void mpc8560_cpm_si_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMState* s = (CPMState*)opaque;
+	const int si = (addr >> 5) & 0x1;
+	CPMSi* p = &(s->si[si]);
+	int t;
+
+	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
+	if (!CPM_HAS(s, BLK_MCC_1 + si))
+		return ;
+	else { /* QAC */ }
+	switch( addr & 0x1f ) {
+	case BCTSI(CPM_REG_SI1AMR):
+	case BCTSI(CPM_REG_SI1BMR):
+	case BCTSI(CPM_REG_SI1CMR):
+	case BCTSI(CPM_REG_SI1DMR):
+		p->mr[(addr & 0x1f) / 2] = value & 0xffff;
+		p->plan_dirty = p->plan_dirty | SI_GMR_EN((addr & 0x1f) / 2);
+		break;
+	case BCTSI(CPM_REG_SI1GMR):
+		p->gmr = value & 0xff;
+		if (p->gmr && !qemu_timer_pending(s->tdm_timer))
+			qemu_mod_timer(s->tdm_timer, qemu_get_clock_ns(vm_clock) + CPM_TDM_FRAME_NS);
+		else { /* QAC */ }
+		break;
+	case BCTSI(CPM_REG_SI1CMDR):
+		/* switch requests are taken at the next frame boundary of an enabled TDM */
+		p->cmdr = p->cmdr | (value & 0xff);
+		for (t = 0; t < CPM_SI_TDMS; t++) {
+			if (!(p->gmr & SI_GMR_EN(t)))
+				mpc8560_cpm_si_sync(s, si, t);
+			else { /* QAC */ }
+		}
+		break;
+	case BCTSI(CPM_REG_SI1STR):
+		p->str = value & 0xff;
+		break;
+	case BCTSI(CPM_REG_SI1RSR):
+		p->rsr = value & 0xffff;
+		p->plan_dirty = 0xf;
+		break;
+	case BCTSI(CPM_REG_MCCE1): /* cleared by writing ones */
+		s->mcc[si].mcce = s->mcc[si].mcce & ~(value);
+		mpc8560_cpm_mcc_update_irq(s, si);
+		break;
+	case BCTSI(CPM_REG_MCCM1):
+		s->mcc[si].mccm = value & 0xffff;
+		mpc8560_cpm_mcc_update_irq(s, si);
+		break;
+	case BCTSI(CPM_REG_MCCF1):
+		s->mcc[si].mccf = value & 0xff;
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
+				__func__, __LINE__, (int)addr, (unsigned)value);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static uint32_t mpc8560_cpm_aal5_crc(uint32_t crc, const uint8_t* buf, int len)
+ * @brief CRC-32 of AAL5, MSB first (zlib's is reflected)
+ *
+ */
+static uint32_t mpc8560_cpm_aal5_crc(uint32_t crc, const uint8_t* buf, int len)
+{
+	int i;
+
+	while (len--) {
+		crc = crc ^ ((uint32_t)*(buf++) << 24);
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x80000000) ? ((crc << 1) ^ AAL5_CRC_POLY) : (crc << 1);
+	}
+
+	return crc;
+}
+
+/**
+ * @fn static uint8_t mpc8560_cpm_atm_hec(uint32_t hdr)
+ * @brief CRC-8 over the 4 header octets, coset 0x55 added
+ *
+ */
+static uint8_t mpc8560_cpm_atm_hec(uint32_t hdr)
+{
+	uint8_t crc = 0;
+	int i;
+
+	for (i = 31; i >= 0; i--)
+		crc = (((crc >> 7) ^ (hdr >> i)) & 0x1) ? ((crc << 1) ^ ATM_HEC_POLY) : (crc << 1);
+
+	return crc ^ ATM_HEC_COSET;
+}
+
+static inline hwaddr mpc8560_cpm_atm_ct(int f, TYPE_ATM_PRAM_OFFSET table, int ch)
+{
+	return DPRAM_ADDR(lduw_phys(FCC_PAGE(f) + table) + (ch * CT_SIZE));
+}
+
+static inline hwaddr mpc8560_cpm_atm_bd(int f, hwaddr ct)
+{
+	return ldl_phys(FCC_PAGE(f) + AP_BD_BASE_EXT) + lduw_phys(ct + CT_BD_PTR);
+}
+
+/**
+ * @fn static void mpc8560_cpm_fcc_update_irq(CPMState* s, int f)
+ * @brief (FCCE & FCCM) -> SIPNR
+ *
+ */
+static void mpc8560_cpm_fcc_update_irq(CPMState* s, int f)
+{
+	if (s->fcc[f].fcce & s->fcc[f].fccm) {
+		mpc8560_cpm_lat_raise(&(s->fcc[f].irq_lat));
+		if (mpc8560_cpm_raise_int(s, IC_FCC_1 + f))
+			s->fcc[f].stats.irqs++;
+		else { /* QAC */ }
+	} else {
+		mpc8560_cpm_lat_ack(&(s->fcc[f].irq_lat));
+		mpc8560_cpm_clear_int(s, IC_FCC_1 + f);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_event(CPMState* s, int f, int ch, hwaddr ct, uint16_t ev)
+ * @brief Posts a channel event into interrupt queue 0
+ *
+ */
+static void mpc8560_cpm_atm_event(CPMState* s, int f, int ch, hwaddr ct, uint16_t ev)
+{
+	const hwaddr intt = DPRAM_ADDR(lduw_phys(FCC_PAGE(f) + AP_INTT_BASE));
+	hwaddr ptr;
+	uint32_t ent;
+
+	if (!(lduw_phys(ct + CT_INTMSK) & ev))
+		return ;
+	else { /* QAC */ }
+
+	ptr = ldl_phys(intt + INTQ_PTR);
+	ent = ldl_phys(ptr);
+	if (ent & ATM_INT_V) {
+		s->fcc[f].fcce = s->fcc[f].fcce | FCCE_ATM_IQOV0;
+	} else {
+		stl_phys(ptr, (ent & ATM_INT_W) | ATM_INT_V | (ev << ATM_INT_EV_SHIFT) | ch);
+		stl_phys(intt + INTQ_PTR, (ent & ATM_INT_W) ? ldl_phys(intt + INTQ_BASE) : (ptr + 4));
+		s->fcc[f].fcce = s->fcc[f].fcce | FCCE_ATM_GINT0;
+	}
+	mpc8560_cpm_fcc_update_irq(s, f);
+
+	return ;
+}
+
+/**
+ * @fn static uint16_t mpc8560_cpm_atm_bd_close(hwaddr ct, hwaddr bd, uint16_t clear, uint16_t set)
+ * @brief Updates the status of a BD and moves BD_PTR on, back to BD_BASE on W. Returns the old status
+ *
+ */
+static uint16_t mpc8560_cpm_atm_bd_close(hwaddr ct, hwaddr bd, uint16_t clear, uint16_t set)
+{
+	uint16_t status = lduw_phys(bd);
+
+	stw_phys(bd, (status & ~clear) | set);
+	if (status & ATM_BD_W)
+		stw_phys(ct + CT_BD_PTR, lduw_phys(ct + CT_BD_BASE));
+	else
+		stw_phys(ct + CT_BD_PTR, lduw_phys(ct + CT_BD_PTR) + 0x8);
+
+	return status;
+}
+
+/**
+ * @fn static int mpc8560_cpm_atm_tx_cell(CPMState* s, int f, int ch, uint8_t* cell)
+ * @brief Segments the next 48 octets of a channel, returns 0 when it has nothing to send
+ *
+ */
+static int mpc8560_cpm_atm_tx_cell(CPMState* s, int f, int ch, uint8_t* cell)
+{
+	CPMAtmChannel* c = &(s->fcc[f].atm_ch[ch]);
+	const hwaddr ct = mpc8560_cpm_atm_ct(f, AP_INT_TCT_BASE, ch);
+	uint8_t* pl = cell + 5;
+	uint32_t hdr;
+	uint32_t n = 0;
+	uint32_t chunk;
+	uint16_t status;
+	int last = 0;
+
+	if (!c->tx_bd && !c->tx_pad) {
+		/* between CPCS-PDUs, only start on a ready TxBD */
+		c->tx_bd = mpc8560_cpm_atm_bd(f, ct);
+		if (!(lduw_phys(c->tx_bd) & ATM_TXBD_R)) {
+			c->tx_bd = 0;
+			c->tx_on = 0; /* rescheduled by ATM TRANSMIT */
+			return 0;
+		} else { /* QAC */ }
+		c->tx_len = lduw_phys(c->tx_bd + 0x2);
+		c->tx_off = 0;
+		c->tx_flen = 0;
+		c->tx_crc = 0xffffffff;
+	} else { /* QAC */ }
+
+	while (c->tx_bd && (n < CPM_ATM_PAYLOAD)) {
+		chunk = MIN(CPM_ATM_PAYLOAD - n, c->tx_len - c->tx_off);
+		if (mpc8560_cpm_sdma_read(s, ldl_phys(c->tx_bd + 0x4) + c->tx_off, pl + n, chunk) < 0) {
+			/* the channel halts on a bus error */
+			c->tx_on = 0;
+			c->tx_bd = 0;
+			c->tx_pad = 0;
+			return 0;
+		} else { /* QAC */ }
+		c->tx_off += chunk;
+		c->tx_flen += chunk;
+		n += chunk;
+		s->fcc[f].stats.tx_bytes += chunk;
+		if (c->tx_off < c->tx_len)
+			break;
+		else { /* QAC */ }
+
+		status = mpc8560_cpm_atm_bd_close(ct, c->tx_bd, ATM_TXBD_R, 0);
+		if (status & ATM_BD_I)
+			mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_TXB);
+		else { /* QAC */ }
+		c->tx_bd = 0;
+		s->fcc[f].stats.tx_bds++;
+		if (status & ATM_BD_L) {
+			s->fcc[f].stats.tx_frames++;
+			c->tx_pad = 1;
+			break;
+		} else { /* QAC */ }
+
+		c->tx_bd = mpc8560_cpm_atm_bd(f, ct);
+		if (!(lduw_phys(c->tx_bd) & ATM_TXBD_R)) {
+			/* underrun inside a CPCS-PDU, abort it with a zero length */
+			c->tx_bd = 0;
+			c->tx_pad = 1;
+			c->tx_flen = 0;
+			mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_UN);
+			break;
+		} else { /* QAC */ }
+		c->tx_len = lduw_phys(c->tx_bd + 0x2);
+		c->tx_off = 0;
+	}
+
+	memset(pl + n, 0, CPM_ATM_PAYLOAD - n);
+	if (c->tx_pad && ((CPM_ATM_PAYLOAD - n) >= AAL5_TRAILER)) {
+		/* CPCS-UU, CPI, Length, CRC-32 */
+		stw_be_p(pl + CPM_ATM_PAYLOAD - 6, c->tx_flen);
+		c->tx_crc = mpc8560_cpm_aal5_crc(c->tx_crc, pl, CPM_ATM_PAYLOAD - 4);
+		stl_be_p(pl + CPM_ATM_PAYLOAD - 4, ~(c->tx_crc));
+		c->tx_pad = 0;
+		last = 1;
+	} else {
+		c->tx_crc = mpc8560_cpm_aal5_crc(c->tx_crc, pl, CPM_ATM_PAYLOAD);
+	}
+
+	hdr = ldl_phys(ct + CT_CELL_HDR) & ~ATM_HDR_PTI_AUU;
+	hdr = hdr | (last ? ATM_HDR_PTI_AUU : 0);
+	stl_be_p(cell, hdr);
+	cell[4] = mpc8560_cpm_atm_hec(hdr);
+
+	return 1;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_timer_cb(void* opaque)
+ * @brief Segments up to CPM_ATM_BATCH_CELLS cells per FCC, round robin over the channels
+ *
+ */
+static void mpc8560_cpm_atm_timer_cb(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	CPMFcc* p;
+	uint32_t cells;
+	uint32_t idle;
+	uint32_t i;
+	int active = 0;
+	int f;
+
+	for (f = 0; f < CPM_NUM_ATM_FCC; f++) {
+		p = &(s->fcc[f]);
+		if (!p->atm_ch || !FCC_IS_ATM(p) || !(p->gfmr & GFMR_ENT))
+			continue;
+		else { /* QAC */ }
+
+		for (cells = 0, idle = 0; (cells < CPM_ATM_BATCH_CELLS) && (idle < CPM_ATM_CHANNELS); ) {
+			if (p->atm_ch[p->tx_rr].tx_on
+					&& mpc8560_cpm_atm_tx_cell(s, f, p->tx_rr, p->tx_batch + (cells * CPM_ATM_CELL))) {
+				cells++;
+				idle = 0;
+			} else {
+				idle++;
+			}
+			p->tx_rr = (p->tx_rr + 1) % CPM_ATM_CHANNELS;
+		}
+		s->tc[f].tcc += cells;
+		active |= (cells != 0);
+
+		for (i = 0; i < cells; i++)
+			mpc8560_cpm_tap_put(s, TAP_FCC_1 + f, 0, 1, p->tx_batch + (i * CPM_ATM_CELL), CPM_ATM_CELL);
+
+		/* A busy backend drops the batch, like cells lost on the line */
+		if (p->chr && cells)
+			qemu_chr_fe_write(p->chr, p->tx_batch, cells * CPM_ATM_CELL);
+		else { /* QAC */ }
+	}
+
+	if (active)
+		qemu_mod_timer(s->atm_timer, qemu_get_clock_ns(vm_clock) + CPM_ATM_TICK_NS);
+	else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_rx_payload(CPMState* s, int f, int ch, const uint8_t* pl, int last)
+ * @brief AAL5 reassembly of one cell payload
+ *
+ */
+static void mpc8560_cpm_atm_rx_payload(CPMState* s, int f, int ch, const uint8_t* pl, int last)
+{
+	CPMAtmChannel* c = &(s->fcc[f].atm_ch[ch]);
+	const hwaddr ct = mpc8560_cpm_atm_ct(f, AP_INT_RCT_BASE, ch);
+	uint16_t flags = 0;
+	uint32_t len;
+	uint32_t n;
+	uint32_t chunk;
+
+	c->rx_crc = mpc8560_cpm_aal5_crc(c->rx_crc, pl, CPM_ATM_PAYLOAD);
+	for (n = 0; (n < CPM_ATM_PAYLOAD) && !c->rx_discard; n += chunk) {
+		if (!c->rx_bd) {
+			c->rx_bd = mpc8560_cpm_atm_bd(f, ct);
+			if (!(lduw_phys(c->rx_bd) & ATM_RXBD_E)) {
+				c->rx_bd = 0;
+				c->rx_discard = 1;
+				s->fcc[f].stats.overruns++;
+				mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_BSY);
+				break;
+			} else { /* QAC */ }
+			c->rx_max = lduw_phys(ct + CT_MRBLR);
+			if (!c->rx_max) {
+				/* a setup error, the BD stays empty and the PDU is dropped instead of closing
+				   empty BDs round the ring; MRBLR is read again for the next one */
+				c->rx_bd = 0;
+				c->rx_discard = 1;
+				s->fcc[f].stats.overruns++;
+				mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_BSY);
+				break;
+			} else { /* QAC */ }
+			c->rx_cnt = 0;
+		} else { /* QAC */ }
+
+		chunk = MIN(CPM_ATM_PAYLOAD - n, c->rx_max - c->rx_cnt);
+		if (mpc8560_cpm_sdma_write(s, ldl_phys(c->rx_bd + 0x4) + c->rx_cnt, pl + n, chunk) < 0) {
+			/* the BD is closed as an aborted frame, the rest is dropped up to the last cell */
+			stw_phys(c->rx_bd + 0x2, c->rx_cnt);
+			s->fcc[f].stats.rx_bds++;
+			if (mpc8560_cpm_atm_bd_close(ct, c->rx_bd, ATM_RXBD_E | ATM_RXBD_STATUS,
+						ATM_BD_L | ATM_RXBD_ABT | (c->rx_first ? ATM_RXBD_F : 0)) & ATM_BD_I)
+				mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_RXF);
+			else { /* QAC */ }
+			c->rx_bd = 0;
+			c->rx_discard = 1;
+			break;
+		} else { /* QAC */ }
+		c->rx_cnt += chunk;
+		s->fcc[f].stats.rx_bytes += chunk;
+		if ((c->rx_cnt >= c->rx_max) && !(last && ((n + chunk) == CPM_ATM_PAYLOAD))) {
+			stw_phys(c->rx_bd + 0x2, c->rx_cnt);
+			s->fcc[f].stats.rx_bds++;
+			if (mpc8560_cpm_atm_bd_close(ct, c->rx_bd, ATM_RXBD_E | ATM_RXBD_STATUS,
+						c->rx_first ? ATM_RXBD_F : 0) & ATM_BD_I)
+				mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_RXB);
+			else { /* QAC */ }
+			c->rx_first = 0;
+			c->rx_bd = 0;
+		} else { /* QAC */ }
+	}
+	c->rx_flen += CPM_ATM_PAYLOAD;
+
+	if (!last)
+		return ;
+	else { /* QAC */ }
+
+	len = lduw_be_p(pl + CPM_ATM_PAYLOAD - 6);
+	if (!len)
+		flags = flags | ATM_RXBD_ABT;
+	else if ((len > (c->rx_flen - AAL5_TRAILER)) || ((len + AAL5_TRAILER + CPM_ATM_PAYLOAD) <= c->rx_flen)
+			|| (lduw_phys(ct + CT_MAX_LEN) && (len > lduw_phys(ct + CT_MAX_LEN))))
+		flags = flags | ATM_RXBD_LN;
+	else { /* QAC */ }
+	if (c->rx_crc != AAL5_CRC_RESIDUE) {
+		flags = flags | ATM_RXBD_CR;
+		s->fcc[f].stats.crc_errors++;
+	} else { /* QAC */ }
+	s->fcc[f].stats.rx_frames++;
+
+	if (c->rx_bd) {
+		/* the last BD gets the whole CPCS-PDU length, like the FCC Ethernet BDs */
+		stw_phys(c->rx_bd + 0x2, len);
+		s->fcc[f].stats.rx_bds++;
+		if (mpc8560_cpm_atm_bd_close(ct, c->rx_bd, ATM_RXBD_E | ATM_RXBD_STATUS,
+					ATM_BD_L | flags | (c->rx_first ? ATM_RXBD_F : 0)) & ATM_BD_I)
+			mpc8560_cpm_atm_event(s, f, ch, ct, ATM_EV_RXF);
+		else { /* QAC */ }
+	} else { /* QAC */ }
+
+	c->rx_bd = 0;
+	c->rx_first = 1;
+	c->rx_discard = 0;
+	c->rx_flen = 0;
+	c->rx_crc = 0xffffffff;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_rx_cell(CPMState* s, int f, uint8_t* cell)
+ * @brief HEC check/correction, idle cell filtering and connection lookup
+ *
+ */
+static void mpc8560_cpm_atm_rx_cell(CPMState* s, int f, uint8_t* cell)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	CPMTc* tc = &(s->tc[f]);
+	uint32_t hdr = ldl_be_p(cell);
+	gpointer ch;
+	int i;
+
+	if (mpc8560_cpm_atm_hec(hdr) != cell[4]) {
+		/* single bit errors in the header are corrected, the rest is dropped */
+		for (i = 0; i < 32; i++) {
+			if (mpc8560_cpm_atm_hec(hdr ^ (0x1 << i)) == cell[4])
+				break;
+			else { /* QAC */ }
+		}
+		if (i < 32)
+			hdr = hdr ^ (0x1 << i);
+		else if (ctpop8(mpc8560_cpm_atm_hec(hdr) ^ cell[4]) != 1) {
+			tc->ecc++;
+			return ;
+		} else { /* QAC */ }
+		tc->ccc++;
+	} else { /* QAC */ }
+
+	if (!ATM_HDR_VPVC(hdr)) {
+		tc->icc++;
+		return ;
+	} else { /* QAC */ }
+	tc->rcc++;
+
+	ch = g_hash_table_lookup(p->atm_lookup, GUINT_TO_POINTER(ATM_HDR_VPVC(hdr)));
+	if (!ch || !p->atm_ch[GPOINTER_TO_UINT(ch) - 1].rx_on) {
+		tc->fcc++;
+		return ;
+	} else { /* QAC */ }
+
+	mpc8560_cpm_atm_rx_payload(s, f, GPOINTER_TO_UINT(ch) - 1, cell + 5, !!(hdr & ATM_HDR_PTI_AUU));
+
+	return ;
+}
+
+static int mpc8560_cpm_atm_can_receive(void* opaque)
+{
+	return CPM_ATM_CELL * CPM_ATM_BATCH_CELLS;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_receive(void* opaque, const uint8_t* buf, int size)
+ * @brief Cells arrive back to back, a partial cell is kept for the next batch
+ *
+ */
+static void mpc8560_cpm_atm_receive(void* opaque, const uint8_t* buf, int size)
+{
+	CPMFcc* p = (CPMFcc*)opaque;
+	const int enabled = FCC_IS_ATM(p) && (p->gfmr & GFMR_ENR);
+	uint32_t chunk;
+
+	while (size > 0) {
+		chunk = MIN(size, CPM_ATM_CELL - p->rx_cell_len);
+		memcpy(p->rx_cell + p->rx_cell_len, buf, chunk);
+		p->rx_cell_len += chunk;
+		buf += chunk;
+		size -= chunk;
+		if (p->rx_cell_len < CPM_ATM_CELL)
+			break;
+		else { /* QAC */ }
+
+		p->rx_cell_len = 0;
+		if (enabled) {
+			mpc8560_cpm_tap_put(p->s, TAP_FCC_1 + p->idx, 0, 0, p->rx_cell, CPM_ATM_CELL);
+			mpc8560_cpm_atm_rx_cell(p->s, p->idx, p->rx_cell);
+		}
+		else { /* QAC */ }
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_build_lookup(CPMState* s, int f)
+ * @brief VPI/VCI -> channel for every receiving channel of the RCT
+ *
+ */
+static void mpc8560_cpm_atm_build_lookup(CPMState* s, int f)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	hwaddr ct;
+	int ch;
+
+	g_hash_table_remove_all(p->atm_lookup);
+	for (ch = 0; ch < CPM_ATM_CHANNELS; ch++) {
+		if (!p->atm_ch[ch].rx_on)
+			continue;
+		else { /* QAC */ }
+		ct = mpc8560_cpm_atm_ct(f, AP_INT_RCT_BASE, ch);
+		g_hash_table_insert(p->atm_lookup, GUINT_TO_POINTER(ATM_HDR_VPVC(ldl_phys(ct + CT_CELL_HDR))),
+				GUINT_TO_POINTER(ch + 1));
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_init_rx(CPMState* s, int f)
+ * @brief Opens the AAL5 entries of the internal RCT
+ *
+ */
+static void mpc8560_cpm_atm_init_rx(CPMState* s, int f)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	CPMAtmChannel* c;
+	hwaddr ct;
+	int ch;
+
+	for (ch = 0; ch < CPM_ATM_CHANNELS; ch++) {
+		c = &(p->atm_ch[ch]);
+		ct = mpc8560_cpm_atm_ct(f, AP_INT_RCT_BASE, ch);
+		c->rx_bd = 0;
+		c->rx_first = 1;
+		c->rx_discard = 0;
+		c->rx_flen = 0;
+		c->rx_crc = 0xffffffff;
+		c->rx_on = ((ldl_phys(ct + CT_FLAGS) & ATM_CT_AAL) == ATM_CT_AAL5);
+	}
+	mpc8560_cpm_atm_build_lookup(s, f);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_atm_init_tx(CPMState* s, int f)
+ * @brief Stops every transmit channel, ATM TRANSMIT starts them again
+ *
+ */
+static void mpc8560_cpm_atm_init_tx(CPMState* s, int f)
+{
+	CPMAtmChannel* c;
+	int ch;
+
+	for (ch = 0; ch < CPM_ATM_CHANNELS; ch++) {
+		c = &(s->fcc[f].atm_ch[ch]);
+		c->tx_on = 0;
+		c->tx_pad = 0;
+		c->tx_bd = 0;
+	}
+	s->fcc[f].tx_rr = 0;
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_eth_get_addr(hwaddr h, uint8_t* mac)
+ * @brief MAC address from three parameter RAM halfwords, highest bytes first (PADDR/TADDR)
+ *
+ */
+static void mpc8560_cpm_eth_get_addr(hwaddr h, uint8_t* mac)
+{
+	uint16_t w;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		w = lduw_phys(h + (2 * i));
+		mac[5 - (2 * i)] = w >> 8;
+		mac[4 - (2 * i)] = w & 0xff;
+	}
+
+	return ;
+}
+
+/**
+ * @fn static inline int mpc8560_cpm_eth_hash(const uint8_t* mac)
+ * @brief Hash bin of an address, the six high bits of the CRC-32 over it
+ *
+ */
+static inline int mpc8560_cpm_eth_hash(const uint8_t* mac)
+{
+	return (crc32(0, mac, 6) >> 26) & 0x3f;
+}
+
+/**
+ * @fn static void mpc8560_cpm_eth_latch(CPMState* s, int f)
+ * @brief Takes the receive filters out of the parameter RAM
+ *
+ */
+static void mpc8560_cpm_eth_latch(CPMState* s, int f)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	const hwaddr pg = FCC_PAGE(f);
+
+	p->eth_gaddr = ((uint64_t)ldl_phys(pg + FE_GADDRH) << 32) | ldl_phys(pg + FE_GADDRL);
+	p->eth_iaddr = ((uint64_t)ldl_phys(pg + FE_IADDRH) << 32) | ldl_phys(pg + FE_IADDRL);
+	mpc8560_cpm_eth_get_addr(pg + FE_PADDRH, p->eth_paddr);
+	p->eth_mflr = lduw_phys(pg + FE_MFLR);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_pram_sync(CPMState* s)
+ * @brief Compiles the SCC UART tables and latches the FCC filters again, only when their parameter pages were written
+ *
+ * The pages are dirty logged, so a character or a frame costs one bitmap
+ * test while the guest leaves its tables alone.
+ */
+static void mpc8560_cpm_pram_sync(CPMState* s)
+{
+	int n;
+	int f;
+
+	memory_region_sync_dirty_bitmap( &(s->dpram2) );
+	if (!memory_region_get_dirty( &(s->dpram2), PRAM_LOG_BASE, PRAM_LOG_LEN, DIRTY_MEMORY_VGA ))
+		return ;
+	else { /* QAC */ }
+
+	memory_region_reset_dirty( &(s->dpram2), PRAM_LOG_BASE, PRAM_LOG_LEN, DIRTY_MEMORY_VGA );
+	for (n = 0; n < CPM_NUM_SCC; n++)
+		mpc8560_cpm_uart_compile(&(s->scc[n]));
+	for (f = 0; f < CPM_NUM_FCC; f++) {
+		if (s->fcc[f].nic)
+			mpc8560_cpm_eth_latch(s, f);
+		else { /* QAC */ }
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_eth_count(CPMState* s, int f, TYPE_FEN_PRAM_OFFSET counter)
+ * @brief Bumps a parameter RAM error counter without it reading as a filter update
+ *
+ */
+static void mpc8560_cpm_eth_count(CPMState* s, int f, TYPE_FEN_PRAM_OFFSET counter)
+{
+	mpc8560_cpm_pram_sync(s);
+	stl_phys(FCC_PAGE(f) + counter, ldl_phys(FCC_PAGE(f) + counter) + 1);
+	memory_region_reset_dirty( &(s->dpram2), PRAM_LOG_BASE, PRAM_LOG_LEN, DIRTY_MEMORY_VGA );
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_eth_accept(CPMFcc* p, const uint8_t* da, uint16_t* flags)
+ * @brief Address recognition, decided before anything is written to memory
+ *
+ */
+static int mpc8560_cpm_eth_accept(CPMFcc* p, const uint8_t* da, uint16_t* flags)
+{
+	static const uint8_t bcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	int accept;
+
+	if (!(da[0] & 0x1)) {
+		accept = !memcmp(da, p->eth_paddr, 6)
+			|| ((p->eth_iaddr >> mpc8560_cpm_eth_hash(da)) & 0x1);
+	} else if (!memcmp(da, bcast, 6)) {
+		*flags = ETH_RXBD_BC;
+		accept = !(p->fpsmr & FPSMR_BRO);
+	} else {
+		*flags = ETH_RXBD_MC;
+		accept = (p->eth_gaddr >> mpc8560_cpm_eth_hash(da)) & 0x1;
+	}
+
+	if (!accept && (p->fpsmr & FPSMR_PRO)) {
+		*flags = *flags | ETH_RXBD_M;
+		accept = 1;
+	} else { /* QAC */ }
+
+	return accept;
+}
+
+/**
+ * @fn static ssize_t mpc8560_cpm_eth_receive(NetClientState* nc, const uint8_t* buf, size_t size)
+ * @brief Filters a frame, then scatters it with its FCS over the RxBDs of MRBLR bytes each
+ *
+ */
+static ssize_t mpc8560_cpm_eth_receive(NetClientState* nc, const uint8_t* buf, size_t size)
+{
+	CPMFcc* p = qemu_get_nic_opaque(nc);
+	CPMState* s = p->s;
+	const int f = p->idx;
+	const hwaddr pg = FCC_PAGE(f);
+	uint8_t frame[CPM_ETH_MAX_FRAME + ETH_FCS];
+	uint16_t flags = 0;
+	uint16_t status;
+	uint16_t mrblr;
+	uint32_t len;
+	uint32_t off;
+	uint32_t n;
+
+	/* a disabled receiver drops what is on the line */
+	if (!FCC_IS_ETH(p) || !(p->gfmr & GFMR_ENR) || (size < ETH_HLEN))
+		return size;
+	else { /* QAC */ }
+
+	mpc8560_cpm_pram_sync(s);
+	if (!mpc8560_cpm_eth_accept(p, buf, &flags)) {
+		p->eth_rx_filtered++;
+		return size;
+	} else { /* QAC */ }
+	/* the capture holds what the FCC took, not what the filter refused */
+	mpc8560_cpm_tap_put(s, TAP_FCC_1 + f, 0, 0, buf, size);
+
+	len = MIN(size, CPM_ETH_MAX_FRAME);
+	memcpy(frame, buf, len);
+	if (len < ETH_MIN_FRAME) {
+		memset(frame + len, 0, ETH_MIN_FRAME - len);
+		len = ETH_MIN_FRAME;
+	} else { /* QAC */ }
+	stl_le_p(frame + len, crc32(0, frame, len));
+	len += ETH_FCS;
+	if (p->eth_mflr && (len > p->eth_mflr)) {
+		flags = flags | ETH_RXBD_LG;
+		len = p->eth_mflr;
+	} else { /* QAC */ }
+
+	mrblr = lduw_phys(pg + FE_MRBLR);
+	for (off = 0; off < len; off += n) {
+		status = lduw_phys(p->eth_rbd);
+		if (!(status & ETH_BD_E) || !mrblr) {
+			/* busy, or no buffer size set up to fill one with, the rest of the frame is lost */
+			p->eth_rx_discarded++;
+			p->stats.overruns++;
+			mpc8560_cpm_eth_count(s, f, FE_DISFC);
+			p->fcce = p->fcce | FCCE_ETH_BSY;
+			break;
+		} else { /* QAC */ }
+
+		n = MIN(len - off, mrblr);
+		status = (status & ~(ETH_BD_E | ETH_RXBD_STATUS)) | (off ? 0 : ETH_RXBD_F);
+		if (mpc8560_cpm_sdma_write(s, ldl_phys(p->eth_rbd + 0x4), frame + off, n) < 0) {
+			/* reported through SMEVR, the frame still ends here in error with L like the SCC buffers do */
+			stw_phys(p->eth_rbd + 0x2, off);
+			status = status | ETH_BD_L | ETH_RXBD_OV;
+			stw_phys(p->eth_rbd, status);
+			p->eth_rx_discarded++;
+			p->stats.overruns++;
+			p->stats.rx_bds++;
+			p->fcce = p->fcce | ((status & ETH_BD_I) ? FCCE_ETH_RXF : 0);
+			p->eth_rbd = (status & ETH_BD_W) ? ldl_phys(pg + FE_RBASE) : (p->eth_rbd + 0x8);
+			break;
+		} else if ((off + n) == len) {
+			/* the last BD gets the whole frame length */
+			stw_phys(p->eth_rbd + 0x2, len);
+			status = status | ETH_BD_L | flags;
+		} else {
+			stw_phys(p->eth_rbd + 0x2, n);
+		}
+		stw_phys(p->eth_rbd, status);
+		p->stats.rx_bytes += n;
+		p->stats.rx_bds++;
+		if (status & ETH_BD_L)
+			p->stats.rx_frames++;
+		else { /* QAC */ }
+		if (status & ETH_BD_I)
+			p->fcce = p->fcce | (((off + n) == len) ? FCCE_ETH_RXF : FCCE_ETH_RXB);
+		else { /* QAC */ }
+		p->eth_rbd = (status & ETH_BD_W) ? ldl_phys(pg + FE_RBASE) : (p->eth_rbd + 0x8);
+	}
+	mpc8560_cpm_fcc_update_irq(s, f);
+
+	return size;
+}
+
+static void mpc8560_cpm_eth_cleanup(NetClientState* nc)
+{
+	CPMFcc* p = qemu_get_nic_opaque(nc);
+
+	p->nic = NULL;
+
+	return ;
+}
+
+static NetClientInfo net_mpc8560_cpm_fcc_info =
+{
+	.type = NET_CLIENT_OPTIONS_KIND_NIC,
+	.size = sizeof(NICState),
+	.receive = mpc8560_cpm_eth_receive,
+	.cleanup = mpc8560_cpm_eth_cleanup,
+};
+
+/**
+ * @fn static void mpc8560_cpm_eth_tx_abort(CPMState* s, int f, int nbd)
+ * @brief Closes the first nbd TxBDs of a frame that cannot be sent, the last with UN, and raises TXE
+ *
+ */
+static void mpc8560_cpm_eth_tx_abort(CPMState* s, int f, int nbd)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	const hwaddr pg = FCC_PAGE(f);
+	uint16_t status;
+	hwaddr bd;
+
+	for (; nbd > 0; nbd--) {
+		bd = p->eth_tbd;
+		status = lduw_phys(bd);
+		stw_phys(bd, (status & ~(ETH_BD_R | ETH_TXBD_STATUS)) | ((nbd == 1) ? ETH_TXBD_UN : 0));
+		p->stats.tx_bds++;
+		p->eth_tbd = (status & ETH_BD_W) ? ldl_phys(pg + FE_TBASE) : (bd + 0x8);
+	}
+	p->fcce = p->fcce | FCCE_ETH_TXE;
+	mpc8560_cpm_fcc_update_irq(s, f);
+
+	return ;
+}
+
+/**
+ * @fn static int mpc8560_cpm_eth_tx(CPMState* s, int f, int budget)
+ * @brief Sends up to budget complete frames of ready TxBDs, BDs are only closed once their frame went out
+ *
+ * Returns the number of frames sent, budget means there may be more.
+ */
+static int mpc8560_cpm_eth_tx(CPMState* s, int f, int budget)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	const hwaddr pg = FCC_PAGE(f);
+	uint8_t frame[CPM_ETH_MAX_FRAME];
+	hwaddr bd;
+	uint16_t status;
+	uint32_t len;
+	uint32_t n;
+	int nbd;
+	int sent;
+
+	for (sent = 0; (sent < budget) && FCC_IS_ETH(p) && (p->gfmr & GFMR_ENT); sent++) {
+		/* gather, a frame still being built by the guest is left alone */
+		for (bd = p->eth_tbd, len = 0, nbd = 1; ; nbd++) {
+			status = lduw_phys(bd);
+			if (!(status & ETH_BD_R)) {
+				mpc8560_cpm_fcc_update_irq(s, f);
+				return sent;
+			} else { /* QAC */ }
+			n = MIN(lduw_phys(bd + 0x2), CPM_ETH_MAX_FRAME - len);
+			if (mpc8560_cpm_sdma_read(s, ldl_phys(bd + 0x4), frame + len, n) < 0) {
+				p->fcce = p->fcce | FCCE_ETH_TXE;
+				mpc8560_cpm_fcc_update_irq(s, f);
+				return sent;
+			} else { /* QAC */ }
+			len += n;
+			if (status & ETH_BD_L)
+				break;
+			else { /* QAC */ }
+			bd = (status & ETH_BD_W) ? ldl_phys(pg + FE_TBASE) : (bd + 0x8);
+			if ((bd == p->eth_tbd) || (nbd >= ETH_TX_MAX_BDS)) {
+				/* the whole ring is ready and no BD has L, the frame would never end */
+				mpc8560_cpm_eth_tx_abort(s, f, nbd);
+				return sent;
+			} else { /* QAC */ }
+		}
+
+		if ((status & ETH_TXBD_PAD) && (len < ETH_MIN_FRAME)) {
+			memset(frame + len, 0, ETH_MIN_FRAME - len);
+			len = ETH_MIN_FRAME;
+		} else { /* QAC */ }
+		mpc8560_cpm_tap_put(s, TAP_FCC_1 + f, 0, 1, frame, len);
+		if (p->nic)
+			qemu_send_packet(qemu_get_queue(p->nic), frame, len);
+		else { /* QAC */ }
+		p->stats.tx_bytes += len;
+		p->stats.tx_frames++;
+
+		/* close */
+		do {
+			bd = p->eth_tbd;
+			status = lduw_phys(bd);
+			stw_phys(bd, status & ~(ETH_BD_R | ETH_TXBD_STATUS));
+			p->stats.tx_bds++;
+			if (status & ETH_BD_I)
+				p->fcce = p->fcce | FCCE_ETH_TXB;
+			else { /* QAC */ }
+			p->eth_tbd = (status & ETH_BD_W) ? ldl_phys(pg + FE_TBASE) : (bd + 0x8);
+		} while (!(status & ETH_BD_L));
+	}
+	mpc8560_cpm_fcc_update_irq(s, f);
+
+	return sent;
+}
+
+/**
+ * @fn static void mpc8560_cpm_eth_cmd(CPMState* s, int f, TYPE_CP_CMD_FCC op)
+ * @brief FCC Ethernet commands
+ *
+ */
+static void mpc8560_cpm_eth_cmd(CPMState* s, int f, TYPE_CP_CMD_FCC op)
+{
+	CPMFcc* p = &(s->fcc[f]);
+	const hwaddr pg = FCC_PAGE(f);
+	uint8_t mac[6];
+	int bin;
+
+	switch( op ) {
+	case OP_FCC_INIT_RX_TX_PARAMS:
+		p->eth_tbd = ldl_phys(pg + FE_TBASE);
+		/* fall through */
+	case OP_FCC_INIT_RX_PARAMS:
+		p->eth_rbd = ldl_phys(pg + FE_RBASE);
+		mpc8560_cpm_eth_latch(s, f);
+		break;
+	case OP_FCC_INIT_TX_PARAMS:
+		p->eth_tbd = ldl_phys(pg + FE_TBASE);
+		break;
+	case OP_FCC_SET_GROUP_ADDRESS:
+		mpc8560_cpm_eth_get_addr(pg + FE_TADDRH, mac);
+		bin = mpc8560_cpm_eth_hash(mac);
+		if (mac[0] & 0x1)
+			stl_phys(pg + ((bin < 32) ? FE_GADDRL : FE_GADDRH),
+					ldl_phys(pg + ((bin < 32) ? FE_GADDRL : FE_GADDRH)) | (0x1 << (bin % 32)));
+		else
+			stl_phys(pg + ((bin < 32) ? FE_IADDRL : FE_IADDRH),
+					ldl_phys(pg + ((bin < 32) ? FE_IADDRL : FE_IADDRH)) | (0x1 << (bin % 32)));
+		mpc8560_cpm_eth_latch(s, f);
+		break;
+	case OP_FCC_GRACEFUL_STOP_TX:
+		/* frames are sent whole, so the transmitter is always between frames */
+		p->fcce = p->fcce | FCCE_ETH_GRA;
+		mpc8560_cpm_fcc_update_irq(s, f);
+		break;
+	case OP_FCC_STOP_TX:
+		break;
+	case OP_FCC_RESTART_TX:
+		mpc8560_cpm_cp_kick(s, CP_WORK_FCC_TX(f));
+		break;
+	default:
+		fprintf(stderr, "%s:%d] Unkown OPCODE.\n", __func__, __LINE__ );
+	}
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_cp_cpcr_fcc_op(void* opaque)
+ * @brief FCC commands, ATM channel commands take CPCR[MCN]
+ *
+ */
+static void mpc8560_cpm_cp_cpcr_fcc_op(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	TYPE_CP_CMD_FCC op = s->cpcr & CPCR_OPCODE_MASK;
+	const int f = ((s->cpcr & CPCR_SBC_MASK) >> CPCR_SBC_SHIFT) - SC_FCC_1;
+	const int ch = ((s->cpcr & CPCR_MCN_MASK) >> CPCR_MCN_SHIFT) % CPM_ATM_CHANNELS;
+	CPMFcc* p = &(s->fcc[f]);
+
+	p->stats.commands++;
+	if (FCC_IS_ETH(p)) {
+		mpc8560_cpm_eth_cmd(s, f, op);
+		return ;
+	} else if (!p->atm_ch || !FCC_IS_ATM(p)) {
+		fprintf(stderr, "%s:%d] FCC%d mode %x not supported.\n", __func__, __LINE__,
+				f + 1, p->gfmr & GFMR_MODE_MASK);
+		return ;
+	} else { /* QAC */ }
+
+	switch( op ) {
+	case OP_FCC_INIT_RX_TX_PARAMS:
+		mpc8560_cpm_atm_init_tx(s, f);
+		mpc8560_cpm_atm_init_rx(s, f);
+		break;
+	case OP_FCC_INIT_RX_PARAMS:
+		mpc8560_cpm_atm_init_rx(s, f);
+		break;
+	case OP_FCC_INIT_TX_PARAMS:
+		mpc8560_cpm_atm_init_tx(s, f);
+		break;
+	case OP_FCC_ATM_TRANSMIT:
+		p->atm_ch[ch].tx_on = 1;
+		if (!qemu_timer_pending(s->atm_timer))
+			qemu_mod_timer(s->atm_timer, qemu_get_clock_ns(vm_clock));
+		else { /* QAC */ }
+		break;
+	case OP_FCC_STOP_TX:
+		p->atm_ch[ch].tx_on = 0;
+		break;
+	default:
+		fprintf(stderr, "%s:%d] Unkown OPCODE.\n", __func__, __LINE__ );
+	}
+	DPRINTF("FCC%d op %x channel %d", f + 1, op, ch);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_cp_bh(void* opaque)
+ * @brief One CP pass over the channels with work queued, in TYPE_INT_SRC_PRI order
+ *
+ * Each ready channel gets at most its budget per pass, so a busy FCC is
+ * served first but cannot hold off the SCC for more than one pass. A
+ * channel that used its whole budget is queued again for the next pass,
+ * which runs after the main loop had its turn.
+ */
+static void mpc8560_cpm_cp_bh(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	uint32_t work = s->cp_work;
+	uint32_t more = 0;
+	int f;
+	int n;
+
+	s->cp_work = 0;
+	s->cp_passes++;
+
+	/* FCCs first, MCC and ATM cells run from their own timers */
+	for (f = 0; f < CPM_NUM_FCC; f++) {
+		if ((work & CP_WORK_FCC_TX(f)) && (mpc8560_cpm_eth_tx(s, f, CP_BUDGET_FCC_TX) >= CP_BUDGET_FCC_TX))
+			more = more | CP_WORK_FCC_TX(f);
+		else { /* QAC */ }
+	}
+
+	/* SCCs last, receive before transmit so the backend is let in again early */
+	for (n = 0; n < CPM_NUM_SCC; n++) {
+		if (work & CP_WORK_SCC_RX(n))
+			scc_update_status_rxbd(&(s->scc[n]));
+		else { /* QAC */ }
+		if (work & CP_WORK_SCC_TX(n)) {
+			if (mpc8560_cpm_frame_tx_cb(&(s->scc[n])) >= CP_BUDGET_SCC_TX)
+				more = more | CP_WORK_SCC_TX(n);
+			else { /* QAC */ }
+			/* the driver is active, keep polling close behind it */
+			s->scc[n].bd_poll_ns = SCC_BD_POLL_MIN_NS;
+		} else { /* QAC */ }
+	}
+
+	if (more) {
+		s->cp_deferred++;
+		mpc8560_cpm_cp_kick(s, more);
+	} else { /* QAC */ }
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_cp_kick(CPMState* s, uint32_t work)
+ * @brief Queues channel work, the vCPU returns from the access before any BD is walked
+ *
+ */
+static void mpc8560_cpm_cp_kick(CPMState* s, uint32_t work)
+{
+	s->cp_work |= work;
+	qemu_bh_schedule( s->cp_bh );
+
+	return ;
+}
+
+/**
+ *
+ *
+ *
+ */
+static uint64_t mpc8560_cpm_fcc_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	CPMState* s = (CPMState*)opaque;
+	const int f = addr / 0x20;
+	CPMFcc* p = &(s->fcc[f]);
+
+	if (!CPM_HAS(s, BLK_FCC_1 + f))
+		return 0;
+	else { /* QAC */ }
+
+	switch( addr & 0x1f ) {
+	case BCTF(CPM_REG_GFMR1):
+		ret = p->gfmr;
+		break;
+	case BCTF(CPM_REG_FPSMR1):
+		ret = p->fpsmr;
+		break;
+	case BCTF(CPM_REG_FTODR1):
+		ret = p->ftodr;
+		break;
+	case BCTF(CPM_REG_FDSR1):
+		ret = p->fdsr;
+		break;
+	case BCTF(CPM_REG_FCCE1):
+		ret = p->fcce;
+		break;
+	case BCTF(CPM_REG_FCCM1):
+		ret = p->fccm;
+		break;
+	case BCTF(CPM_REG_FCCS1):
+		ret = p->fccs;
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
+				__func__, __LINE__, (int)addr);
+	}
+
+	DPRINTF("opaque= %p, addr= %x, size= %x ret=%x", opaque, (uint32_t)addr, size, ret);
+	return ret;
+}
+
+/**
+ *
+ *
+ *
+ */
+static void mpc8560_cpm_fcc_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMState* s = (CPMState*)opaque;
+	const int f = addr / 0x20;
+	CPMFcc* p = &(s->fcc[f]);
+
+	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
+	if (!CPM_HAS(s, BLK_FCC_1 + f))
+		return ;
+	else { /* QAC */ }
+	switch( addr & 0x1f ) {
+	case BCTF(CPM_REG_GFMR1):
+		if (FCC_IS_ETH(p) && (value & ~(p->gfmr) & GFMR_ENT))
+			mpc8560_cpm_cp_kick(s, CP_WORK_FCC_TX(f));
+		else { /* QAC */ }
+		p->gfmr = value;
+		break;
+	case BCTF(CPM_REG_FPSMR1):
+		p->fpsmr = value;
+		break;
+	case BCTF(CPM_REG_FTODR1):
+		/* transmit on demand, TOD reads back as zero */
+		if (value & FTODR_TOD)
+			mpc8560_cpm_cp_kick(s, CP_WORK_FCC_TX(f));
+		else { /* QAC */ }
+		break;
+	case BCTF(CPM_REG_FDSR1):
+		p->fdsr = value & 0xffff;
+		break;
+	case BCTF(CPM_REG_FCCE1): /* cleared by writing ones */
+		p->fcce = p->fcce & ~(value);
+		mpc8560_cpm_fcc_update_irq(s, f);
+		break;
+	case BCTF(CPM_REG_FCCM1):
+		p->fccm = value;
+		mpc8560_cpm_fcc_update_irq(s, f);
+		break;
+	case BCTF(CPM_REG_FCCS1): /* read only */
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
+				__func__, __LINE__, (int)addr, (unsigned)value);
+	}
+
+	return ;
+}
+
+/**
+ * @fn static uint64_t mpc8560_cpm_tc_read(void* opaque, hwaddr addr, unsigned size)
+ * @brief TC layer, the 16-bit cell counters are taken from the host counters here
+ *
+ */
+static uint64_t mpc8560_cpm_tc_read(void* opaque, hwaddr addr, unsigned size)
+{
+	uint32_t ret = 0;
+	CPMState* s = (CPMState*)opaque;
+	CPMTc* tc = &(s->tc[(addr / 0x20) % CPM_NUM_TC]);
+
+	switch( addr ) {
+	case BCTTC(CPM_REG_TCGSR):
+		return s->tcgsr;
+	case BCTTC(CPM_REG_TCGER):
+		return s->tcger;
+	default :
+		break;
+	}
+
+	switch( addr & 0x1f ) {
+	case BCTTC(CPM_REG_TCMODE1):
+		ret = tc->tcmode;
+		break;
+	case BCTTC(CPM_REG_CDSMR1):
+		ret = tc->cdsmr;
+		break;
+	case BCTTC(CPM_REG_TCER1):
+		ret = tc->tcer;
+		break;
+	case BCTTC(CPM_REG_TCMR1):
+		ret = tc->tcmr;
+		break;
+	case BCTTC(CPM_REG_TC_RCC1):
+		ret = (uint16_t)tc->rcc;
+		break;
+	case BCTTC(CPM_REG_TC_FCC1):
+		ret = (uint16_t)tc->fcc;
+		break;
+	case BCTTC(CPM_REG_TC_CCC1):
+		ret = (uint16_t)tc->ccc;
+		break;
+	case BCTTC(CPM_REG_TC_ICC1):
+		ret = (uint16_t)tc->icc;
+		break;
+	case BCTTC(CPM_REG_TC_TCC1):
+		ret = (uint16_t)tc->tcc;
+		break;
+	case BCTTC(CPM_REG_TC_ECC1):
+		ret = (uint16_t)tc->ecc;
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register read: %x\n",
+				__func__, __LINE__, (int)addr);
+	}
+
+	DPRINTF("opaque= %p, addr= %x, size= %x ret=%x", opaque, (uint32_t)addr, size, ret);
+	return ret;
+}
+
+/**
+ *
+ *
+ *
+ */
+static void mpc8560_cpm_tc_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+{
+	CPMState* s = (CPMState*)opaque;
+	CPMTc* tc = &(s->tc[(addr / 0x20) % CPM_NUM_TC]);
+
+	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
+	switch( addr ) {
+	case BCTTC(CPM_REG_TCGSR):
+		s->tcgsr = value & 0xffff;
+		return ;
+	case BCTTC(CPM_REG_TCGER): /* cleared by writing ones */
+		s->tcger = s->tcger & ~(value);
+		return ;
+	default :
+		break;
+	}
+
+	switch( addr & 0x1f ) {
+	case BCTTC(CPM_REG_TCMODE1):
+		tc->tcmode = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_CDSMR1):
+		tc->cdsmr = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TCER1): /* cleared by writing ones */
+		tc->tcer = tc->tcer & ~(value);
+		break;
+	case BCTTC(CPM_REG_TCMR1):
+		tc->tcmr = value & 0xffff;
+		break;
+	/* counters are preset by the guest, the host keeps counting from there */
+	case BCTTC(CPM_REG_TC_RCC1):
+		tc->rcc = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TC_FCC1):
+		tc->fcc = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TC_CCC1):
+		tc->ccc = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TC_ICC1):
+		tc->icc = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TC_TCC1):
+		tc->tcc = value & 0xffff;
+		break;
+	case BCTTC(CPM_REG_TC_ECC1):
+		tc->ecc = value & 0xffff;
+		break;
+	default :
+		fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
+				__func__, __LINE__, (int)addr, (unsigned)value);
+	}
+
+	return ;
+}
+
+static const MemoryRegionOps mpc8560_cpm_default_ops =
+{
+	.read		= mpc8560_cpm_default_read,
+	.write		= mpc8560_cpm_default_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+//	.impl = {	.min_access_size = 4,
+//				.max_access_size = 4,
+//	},
+};
+
+static const MemoryRegionOps mpc8560_cpm_intctrl_ops = 
+{
+	.read		= mpc8560_cpm_intctrl_read,
+	.write		= mpc8560_cpm_intctrl_write,
+	.endianness = DEVICE_BIG_ENDIAN,
+//	.impl = { 	.min_access_size = 4,
+//				.max_access_size = 4,
+//	},
+};
+
+static const MemoryRegionOps mpc8560_cpm_cp_ops =
+{
+	.read		= mpc8560_cpm_cp_read,
+	.write		= mpc8560_cpm_cp_write,
+	.endianness = DEVICE_BIG_ENDIAN,
+//	.impl = {	.min_access_size = 4,
+//				.max_access_size = 4,
+//	},
+};
+
+static const MemoryRegionOps mpc8560_cpm_sccx_ops =
+{
+	.read		= mpc8560_cpm_sccx_read,
+	.write		= mpc8560_cpm_sccx_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+//	.impl = {	.min_access_size = 4,
+//				.max_access_size = 4,
+//	},
+};
+
+static const MemoryRegionOps mpc8560_cpm_ioport_ops =
+{
+	.read		= mpc8560_cpm_ioport_read,
+	.write		= mpc8560_cpm_ioport_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+};
+
+static const MemoryRegionOps mpc8560_cpm_siram_ops =
+{
+	.read		= mpc8560_cpm_siram_read,
+	.write		= mpc8560_cpm_siram_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+	.valid		= {
+		.max_access_size = 2,
+	},
+};
+
+static const MemoryRegionOps mpc8560_cpm_si_ops =
+{
+	.read		= mpc8560_cpm_si_read,
+	.write		= mpc8560_cpm_si_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+};
+
+static const MemoryRegionOps mpc8560_cpm_fcc_ops =
+{
+	.read		= mpc8560_cpm_fcc_read,
+	.write		= mpc8560_cpm_fcc_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+};
+
+static const MemoryRegionOps mpc8560_cpm_tc_ops =
+{
+	.read		= mpc8560_cpm_tc_read,
+	.write		= mpc8560_cpm_tc_write,
+	.endianness	= DEVICE_BIG_ENDIAN,
+};
+
+/**
+ * @fn static void mpc8560_cpm_get_counter(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+ * @brief Read-only view of a host side uint64_t counter
+ *
+ */
+static void mpc8560_cpm_get_counter(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	uint64_t value = *(uint64_t*)opaque;
+
+	visit_type_uint64(v, &value, name, errp);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_get_atomic_counter(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+ * @brief Same as mpc8560_cpm_get_counter for counters another thread updates
+ *
+ */
+static void mpc8560_cpm_get_atomic_counter(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	uint64_t value = atomic_read((uint64_t*)opaque);
+
+	visit_type_uint64(v, &value, name, errp);
+
+	return ;
+}
+
+static const struct {
+	const char* name;
+	size_t off;
+} mpc8560_cpm_stats_fields[] = {
+	{ "rx-bytes",	offsetof(CPMChanStats, rx_bytes) },
+	{ "tx-bytes",	offsetof(CPMChanStats, tx_bytes) },
+	{ "rx-frames",	offsetof(CPMChanStats, rx_frames) },
+	{ "tx-frames",	offsetof(CPMChanStats, tx_frames) },
+	{ "rx-bds",		offsetof(CPMChanStats, rx_bds) },
+	{ "tx-bds",		offsetof(CPMChanStats, tx_bds) },
+	{ "stalls",		offsetof(CPMChanStats, stalls) },
+	{ "overruns",	offsetof(CPMChanStats, overruns) },
+	{ "crc-errors",	offsetof(CPMChanStats, crc_errors) },
+	{ "irqs",		offsetof(CPMChanStats, irqs) },
+	{ "commands",	offsetof(CPMChanStats, commands) },
+};
+
+/**
+ * @fn static void mpc8560_cpm_visit_stats(Visitor* v, CPMChanStats* st, const char* name, Error** errp)
+ * @brief Outputs one channel's counters as a dict
+ *
+ */
+static void mpc8560_cpm_visit_stats(Visitor* v, CPMChanStats* st, const char* name, Error** errp)
+{
+	Error* local_err = NULL;
+	uint64_t value;
+	int i;
+
+	visit_start_struct(v, NULL, "CPMChanStats", name, 0, &local_err);
+	if (!local_err) {
+		for (i = 0; (i < ARRAY_SIZE(mpc8560_cpm_stats_fields)) && !local_err; i++) {
+			value = *(uint64_t*)((uint8_t*)st + mpc8560_cpm_stats_fields[i].off);
+			visit_type_uint64(v, &value, mpc8560_cpm_stats_fields[i].name, &local_err);
+		}
+		error_propagate(errp, local_err);
+		local_err = NULL;
+		/* always paired with a successful start */
+		visit_end_struct(v, &local_err);
+	} else { /* QAC */ }
+	error_propagate(errp, local_err);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_visit_mcc_stats(Visitor* v, CPMState* s, int m, const char* name, Error** errp)
+ * @brief Outputs the counters of every MCC channel that has seen any activity, keyed "chN"
+ *
+ */
+static void mpc8560_cpm_visit_mcc_stats(Visitor* v, CPMState* s, int m, const char* name, Error** errp)
+{
+	static const CPMChanStats idle;
+	CPMChanStats* st;
+	Error* local_err = NULL;
+	char ch_name[8];
+	int ch;
+
+	visit_start_struct(v, NULL, "CPMMccStats", name, 0, &local_err);
+	if (!local_err) {
+		/* nothing to report for an MCC pair left out */
+		for (ch = 0; s->mcc_ch && (ch < CPM_MCC_PER_MCC) && !local_err; ch++) {
+			st = &(s->mcc_ch[(m * CPM_MCC_PER_MCC) + ch].stats);
+			if (!memcmp(st, &idle, sizeof(idle)))
+				continue;
+			else { /* QAC */ }
+			snprintf(ch_name, sizeof(ch_name), "ch%d", ch);
+			mpc8560_cpm_visit_stats(v, st, ch_name, &local_err);
+		}
+		error_propagate(errp, local_err);
+		local_err = NULL;
+		visit_end_struct(v, &local_err);
+	} else { /* QAC */ }
+	error_propagate(errp, local_err);
+
+	return ;
+}
+
+static void mpc8560_cpm_get_stats(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	mpc8560_cpm_visit_stats(v, (CPMChanStats*)opaque, name, errp);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_visit_lat_hist(Visitor* v, uint64_t* hist, const char* name, Error** errp)
+ * @brief Outputs the non-empty buckets, keyed by their lower bound in ns
+ *
+ */
+static void mpc8560_cpm_visit_lat_hist(Visitor* v, uint64_t* hist, const char* name, Error** errp)
+{
+	Error* local_err = NULL;
+	char key[24];
+	int i;
+
+	visit_start_struct(v, NULL, "CPMLatHist", name, 0, &local_err);
+	if (!local_err) {
+		for (i = 0; (i < CPM_LAT_BUCKETS) && !local_err; i++) {
+			if (!hist[i])
+				continue;
+			else { /* QAC */ }
+			snprintf(key, sizeof(key), "%" PRIu64, (uint64_t)1 << i);
+			visit_type_uint64(v, &(hist[i]), key, &local_err);
+		}
+		error_propagate(errp, local_err);
+		local_err = NULL;
+		visit_end_struct(v, &local_err);
+	} else { /* QAC */ }
+	error_propagate(errp, local_err);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_get_irq_latency(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+ * @brief One channel's interrupt service times, in vm_clock and host_clock
+ *
+ */
+static void mpc8560_cpm_get_irq_latency(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	CPMIrqLatency* l = (CPMIrqLatency*)opaque;
+	Error* local_err = NULL;
+
+	visit_start_struct(v, NULL, "CPMIrqLatency", name, 0, &local_err);
+	if (!local_err) {
+		mpc8560_cpm_visit_lat_hist(v, l->vm_hist, "vm-ns", &local_err);
+		if (!local_err)
+			mpc8560_cpm_visit_lat_hist(v, l->host_hist, "host-ns", &local_err);
+		else { /* QAC */ }
+		error_propagate(errp, local_err);
+		local_err = NULL;
+		visit_end_struct(v, &local_err);
+	} else { /* QAC */ }
+	error_propagate(errp, local_err);
+
+	return ;
+}
+
+static void mpc8560_cpm_get_mcc_stats(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	CPMState* s = MPC8560_CPM(obj);
+
+	mpc8560_cpm_visit_mcc_stats(v, s, (CPMMcc*)opaque - s->mcc, name, errp);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_get_all_stats(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+ * @brief Every channel block in one reply, qom-get on "stats"
+ *
+ */
+static void mpc8560_cpm_get_all_stats(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	CPMState* s = MPC8560_CPM(obj);
+	Error* local_err = NULL;
+	char blk_name[8];
+	int i;
+
+	visit_start_struct(v, NULL, "CPMStats", name, 0, &local_err);
+	if (!local_err) {
+		for (i = 0; (i < CPM_NUM_SCC) && !local_err; i++) {
+			snprintf(blk_name, sizeof(blk_name), "scc%d", i + 1);
+			mpc8560_cpm_visit_stats(v, &(s->scc[i].stats), blk_name, &local_err);
+		}
+		for (i = 0; (i < CPM_NUM_FCC) && !local_err; i++) {
+			snprintf(blk_name, sizeof(blk_name), "fcc%d", i + 1);
+			mpc8560_cpm_visit_stats(v, &(s->fcc[i].stats), blk_name, &local_err);
+		}
+		for (i = 0; (i < CPM_NUM_MCC) && !local_err; i++) {
+			snprintf(blk_name, sizeof(blk_name), "mcc%d", i + 1);
+			mpc8560_cpm_visit_mcc_stats(v, s, i, blk_name, &local_err);
+		}
+		error_propagate(errp, local_err);
+		local_err = NULL;
+		visit_end_struct(v, &local_err);
+	} else { /* QAC */ }
+	error_propagate(errp, local_err);
+
+	return ;
+}
+
+static void mpc8560_cpm_get_capture(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	CPMTap* t = (CPMTap*)opaque;
+	char* path = t->path ? t->path : (char*)"";
+
+	visit_type_str(v, &path, name, errp);
+
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_set_capture(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+ * @brief Starts capturing into the named file, or stops on an empty name. Settable at any time (qom-set)
+ *
+ */
+static void mpc8560_cpm_set_capture(Object* obj, Visitor* v, void* opaque, const char* name, Error** errp)
+{
+	CPMState* s = MPC8560_CPM(obj);
+	CPMTap* t = (CPMTap*)opaque;
+	const TYPE_CPM_TAP tap = t - s->tap;
+	Error* local_err = NULL;
+	char* path = NULL;
+	int ret;
+
+	visit_type_str(v, &path, name, &local_err);
+	if (local_err) {
+		error_propagate(errp, local_err);
+		return ;
+	} else { /* QAC */ }
+
+	mpc8560_cpm_tap_stop(s, tap);
+	g_free(t->path);
+	t->path = NULL;
+	if (*path) {
+		ret = mpc8560_cpm_tap_start(s, tap, path);
+		if (ret < 0)
+			error_setg_errno(errp, -ret, "cannot capture to %s", path);
+		else {
+			t->path = path;
+			path = NULL;
+		}
+	} else { /* QAC */ }
+	g_free(path);
+
+	return ;
+}
+
+static void mpc8560_cpm_initfn(Object* obj)
+{
+//	SysBusDevice* d = SYS_BUS_DEVICE(obj);
+	static const char* const tap_names[CPM_NUM_TAPS] = { "scc1", "scc2", "scc3", "scc4",
+		"fcc1", "fcc2", "fcc3", "mcc1", "mcc2" };
+	CPMState* s = MPC8560_CPM(obj);
+	char* name;
+	int i;
+
+	DPRINTF("HIT");	
+
+	/* Creating a CPM memory address space and will be attached as a subregion of ccsr_space */
+	memory_region_init(&(s->cpm_space), obj, "mpc8560-cpm", 0x40000);
+
+	/* Port A ~ D pins, numbered (port * 32) + pin */
+	qdev_init_gpio_in(DEVICE(obj), mpc8560_cpm_ioport_set_pin, CPM_IOPORT_GPIOS);
+	qdev_init_gpio_out(DEVICE(obj), s->ioport_out, CPM_IOPORT_GPIOS);
+
+	/* pcapng capture per channel block */
+	for (i = 0; i < CPM_NUM_TAPS; i++) {
+		s->tap[i].fd = -1;
+		name = g_strdup_printf("%s-capture", tap_names[i]);
+		object_property_add(obj, name, "string", mpc8560_cpm_get_capture,
+				mpc8560_cpm_set_capture, NULL, &(s->tap[i]), NULL);
+		g_free(name);
+		name = g_strdup_printf("%s-capture-dropped", tap_names[i]);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_counter,
+				NULL, NULL, &(s->tap[i].dropped), NULL);
+		g_free(name);
+		name = g_strdup_printf("%s-capture-write-errors", tap_names[i]);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_atomic_counter,
+				NULL, NULL, &(s->tap[i].werr), NULL);
+		g_free(name);
+	}
+
+	/* SCC receive time lost waiting for the guest to return RxBDs */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		name = g_strdup_printf("scc%d-rx-stalls", i + 1);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_counter,
+				NULL, NULL, &(s->scc[i].stats.stalls), NULL);
+		g_free(name);
+		name = g_strdup_printf("scc%d-rx-stall-ns", i + 1);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_counter,
+				NULL, NULL, &(s->scc[i].rx_stall_ns), NULL);
+		g_free(name);
+	}
+
+	/* FCC Ethernet frames dropped before reaching memory */
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		name = g_strdup_printf("fcc%d-rx-filtered", i + 1);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_counter,
+				NULL, NULL, &(s->fcc[i].eth_rx_filtered), NULL);
+		g_free(name);
+		name = g_strdup_printf("fcc%d-rx-discarded", i + 1);
+		object_property_add(obj, name, "uint64", mpc8560_cpm_get_counter,
+				NULL, NULL, &(s->fcc[i].eth_rx_discarded), NULL);
+		g_free(name);
+	}
+
+	/* CP passes, and those that left work over for the next one */
+	object_property_add(obj, "cp-passes", "uint64", mpc8560_cpm_get_counter,
+			NULL, NULL, &(s->cp_passes), NULL);
+	object_property_add(obj, "cp-deferred", "uint64", mpc8560_cpm_get_counter,
+			NULL, NULL, &(s->cp_deferred), NULL);
+
+	/* per channel counters, "stats" returns all of them at once */
+	object_property_add(obj, "stats", "CPMStats", mpc8560_cpm_get_all_stats,
+			NULL, NULL, NULL, NULL);
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		name = g_strdup_printf("scc%d-stats", i + 1);
+		object_property_add(obj, name, "CPMChanStats", mpc8560_cpm_get_stats,
+				NULL, NULL, &(s->scc[i].stats), NULL);
+		g_free(name);
+	}
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		name = g_strdup_printf("fcc%d-stats", i + 1);
+		object_property_add(obj, name, "CPMChanStats", mpc8560_cpm_get_stats,
+				NULL, NULL, &(s->fcc[i].stats), NULL);
+		g_free(name);
+	}
+	for (i = 0; i < CPM_NUM_MCC; i++) {
+		name = g_strdup_printf("mcc%d-stats", i + 1);
+		object_property_add(obj, name, "CPMMccStats", mpc8560_cpm_get_mcc_stats,
+				NULL, NULL, &(s->mcc[i]), NULL);
+		g_free(name);
+	}
+
+	/* event raised -> event cleared by the guest, log2 histograms */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		name = g_strdup_printf("scc%d-irq-latency", i + 1);
+		object_property_add(obj, name, "CPMIrqLatency", mpc8560_cpm_get_irq_latency,
+				NULL, NULL, &(s->scc[i].irq_lat), NULL);
+		g_free(name);
+	}
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		name = g_strdup_printf("fcc%d-irq-latency", i + 1);
+		object_property_add(obj, name, "CPMIrqLatency", mpc8560_cpm_get_irq_latency,
+				NULL, NULL, &(s->fcc[i].irq_lat), NULL);
+		g_free(name);
+	}
+	for (i = 0; i < CPM_NUM_MCC; i++) {
+		name = g_strdup_printf("mcc%d-irq-latency", i + 1);
+		object_property_add(obj, name, "CPMIrqLatency", mpc8560_cpm_get_irq_latency,
+				NULL, NULL, &(s->mcc[i].irq_lat), NULL);
+		g_free(name);
+	}
+
+//	memory_region_init_io(&s->cpm_space, OBJECT(s), &mpc8560_cpm_ops, s,
+//							"mpc8560-cpm", MPC8560_CPM_MMIO_SIZE);
+//	sysbus_init_mmio(d, &(s->iomem));
+	
+	return ;
+}
+
+/**
+ * @fn static void mpc8560_cpm_scc_attach(CPMScc* c)
+ * @brief Connects an SCC to c->chr, from the "sccN" property or, for SCC1, mpc8560_cpm_init_serial()
+ *
+ */
+static void mpc8560_cpm_scc_attach(CPMScc* c)
+{
+	QEMUSerialSetParams ssp;
+
+	qemu_chr_add_handlers( c->chr, scc_can_receive, scc_receive, scc_event, c );
+
+	ssp.speed = 114583; /* baud rate 115200 actual freq 114583 */
+	ssp.parity = 'N';
+	ssp.data_bits = 8;
+	ssp.stop_bits = 1;
+	qemu_chr_fe_ioctl( c->chr, CHR_IOCTL_SERIAL_SET_PARAMS, &ssp );
+
+	return ;
+}
+
+void mpc8560_cpm_init_serial(CPMState* s, CharDriverState* chr)
+{
+	if( NULL == chr )
+		hw_error("%s:%d] Char device not initialized.\n", __func__, __LINE__);
+	
+	/* assign serial0 -> SCC1, unless the "scc1" property already did */
+	if( !CPM_HAS(s, BLK_SCC_1) )
+		fprintf( stderr, "%s:%d] SCC1 is left out, (%s) ignored.\n", __func__, __LINE__, chr->label );
+	else if( s->scc[0].chr )
+		fprintf( stderr, "%s:%d] SCC1 already attached, (%s) ignored.\n", __func__, __LINE__, chr->label );
+	else if( !strncmp( chr->label, "serial0", strlen("serial0")) )
+	{
+		s->scc[0].chr = chr;
+		mpc8560_cpm_scc_attach(&(s->scc[0]));
+	}
+	else
+		fprintf( stderr, "%s:%d] Initializing Char device (%s) ignored.\n", __func__, __LINE__, chr->label );
+	
+	return ;
+}
+
+static void mpc8560_cpm_realize(DeviceState* dev, Error** errp)
+{
+//	SysBusDevice* d = SYS_BUS_DEVICE(dev);
+	CPMState* s = MPC8560_CPM(dev);
+	int i;
+	int t;
+
+	DPRINTF("HIT");
+
+	/* a backend on a block that is left out is a configuration error, not a silent no-op */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		if (s->scc[i].chr && !CPM_HAS(s, BLK_SCC_1 + i)) {
+			error_setg(errp, "scc%d is set but has-scc%d is off", i + 1, i + 1);
+			return ;
+		} else { /* QAC */ }
+	}
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		if ((s->fcc[i].conf.peers.ncs[0] || s->fcc[i].chr) && !CPM_HAS(s, BLK_FCC_1 + i)) {
+			error_setg(errp, "fcc%d has a backend but has-fcc%d is off", i + 1, i + 1);
+			return ;
+		} else { /* QAC */ }
+	}
+	for (i = 0; i < CPM_NUM_SI; i++) {
+		for (t = 0; t < CPM_SI_TDMS; t++) {
+			if (s->si[i].tdm[t].chr && !CPM_HAS(s, BLK_MCC_1 + i)) {
+				error_setg(errp, "si%d-tdm%c is set but has-mcc%d is off", i + 1, 'a' + t, i + 1);
+				return ;
+			} else { /* QAC */ }
+		}
+	}
+	if (s->instram_trace && !CPM_HAS(s, BLK_INSTRAM)) {
+		error_setg(errp, "instram-trace needs has-instram");
+		return ;
+	} else { /* QAC */ }
+	
+	/* BD processing is taken off the MMIO path */
+	s->cp_bh = qemu_bh_new( mpc8560_cpm_cp_bh, s );
+
+	/* ** Initializing subregion ** */
+	memory_region_init_ram( &(s->dpram1), NULL, "cpm.dpram1", CPM_SIZE_DPRAM );
+	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPRAM1), &(s->dpram1) );
+	/* BD tables stay plain RAM, ready TxBDs are spotted through the dirty log */
+	memory_region_set_log( &(s->dpram1), true, DIRTY_MEMORY_VGA );
+
+	memory_region_init_ram( &(s->dpram2), NULL, "cpm.dpram2", CPM_SIZE_DPRAM );
+	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPRAM2), &(s->dpram2) );
+	/* UART table and Ethernet filter updates are spotted through the dirty log of the parameter pages */
+	memory_region_set_log( &(s->dpram2), true, DIRTY_MEMORY_VGA );
+	
+	/* default mmio area(it cover the whole cpm registers area 0x90000 - 0x91fff) */
+	memory_region_init_io( &(s->whole_mmio), OBJECT(s), &mpc8560_cpm_default_ops, s, "cpm.mmio", 0x2000 ); 
+	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_REG_CEAR), &(s->whole_mmio) );
+
+	/* interrupt controller */
+	memory_region_init_io( &(s->intctrl), OBJECT(s), &mpc8560_cpm_intctrl_ops, s, "cpm.intctrl", 0x80 );
+	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_SICR), &(s->intctrl), 1 );
+	
+	/* Communications Processor */
+	memory_region_init_io( &(s->cp_mmio), OBJECT(s), &mpc8560_cpm_cp_ops, s, "cpm.cp", 0x20 );
+	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_CPCR), &(s->cp_mmio), 1 );
+
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		s->scc[i].s = s;
+		s->scc[i].idx = i;
+	}
+	/* SCCx, one region for the four, the registers of a left out SCC read as zero and ignore writes */
+	if (CPM_HAS(s, BLK_SCC_1) || CPM_HAS(s, BLK_SCC_2) || CPM_HAS(s, BLK_SCC_3) || CPM_HAS(s, BLK_SCC_4)) {
+		memory_region_init_io( &(s->sccx), OBJECT(s), &mpc8560_cpm_sccx_ops, s, "cpm.sccx", 0x80 );
+		memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_GSMR_L1), &(s->sccx), 1 );
+	} else { /* QAC */ }
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		if (!CPM_HAS(s, BLK_SCC_1 + i))
+			continue;
+		else { /* QAC */ }
+		/* the receiver exists without a backend, DIAG loopback feeds it */
+		cpm_ring_create( &(s->scc[i].rx_ring), SCC_RX_RING_LEN );
+		cpm_ring_create( &(s->scc[i].echo_ring), SCC_ECHO_RING_LEN );
+		s->scc[i].status_poll = qemu_new_timer_ns( vm_clock, (QEMUTimerCB*)scc_update_timer_cb, &(s->scc[i]) );
+		s->scc[i].fifo_timeout_timer = qemu_new_timer_ns( vm_clock, (QEMUTimerCB*)scc_fifo_timeout_int, &(s->scc[i]) );
+		/* armed by GSMR_L[ENT/ENR] */
+		s->scc[i].bd_poll = qemu_new_timer_ns( vm_clock, mpc8560_cpm_scc_bd_poll_cb, &(s->scc[i]) );
+		s->scc[i].bd_poll_ns = SCC_BD_POLL_MIN_NS;
+		if (s->scc[i].chr)
+			mpc8560_cpm_scc_attach(&(s->scc[i]));
+		else { /* QAC */ }
+	}
+
+	/* Parallel I/O ports A ~ D */
+	memory_region_init_io( &(s->ioport_mmio), OBJECT(s), &mpc8560_cpm_ioport_ops, s, "cpm.ioport", 0x80 );
+	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_PDIRA), &(s->ioport_mmio), 1 );
+
+	/* SI routing RAM and registers, MCC 1 ~ 2, SIx goes with MCCx */
+	if (CPM_HAS(s, BLK_MCC_1) || CPM_HAS(s, BLK_MCC_2)) {
+		memory_region_init_io( &(s->si_mmio), OBJECT(s), &mpc8560_cpm_si_ops, s, "cpm.si", 0x40 );
+		memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_SI1AMR), &(s->si_mmio), 1 );
+		s->tdm_timer = qemu_new_timer_ns( vm_clock, mpc8560_cpm_tdm_timer_cb, s );
+		/* one table for both, channel numbers stay global */
+		s->mcc_ch_num = CPM_MCC_CHANNELS;
+		s->mcc_ch = g_new0(CPMMccChannel, s->mcc_ch_num);
+	} else { /* QAC */ }
+	for (i = 0; i < CPM_NUM_SI; i++) {
+		if (!CPM_HAS(s, BLK_MCC_1 + i))
+			continue;
+		else { /* QAC */ }
+		/* trapped so that writes invalidate the compiled plans */
+		memory_region_init_io( &(s->si[i].ram_mmio), OBJECT(s), &mpc8560_cpm_siram_ops, &(s->si[i]),
+				i ? "cpm.si2ram" : "cpm.si1ram", SI_RAM_RX + CPM_SIZE_SI1RxRAM );
+		memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_SI1TxRAM) + (i * 0x800), &(s->si[i].ram_mmio) );
+		s->si[i].plan_dirty = 0xf;
+
+		for (t = 0; t < CPM_SI_TDMS; t++) {
+			s->si[i].plan[t][0].seg = g_new0(CPMSiSeg, CPM_SI_PLAN_MAX);
+			s->si[i].plan[t][1].seg = g_new0(CPMSiSeg, CPM_SI_PLAN_MAX);
+			s->si[i].tdm[t].s = s;
+			s->si[i].tdm[t].si = i;
+			s->si[i].tdm[t].idx = t;
+			if (s->si[i].tdm[t].chr) {
+				fifo8_create( &(s->si[i].tdm[t].rx_fifo), CPM_TDM_MAX_FRAME * CPM_TDM_BATCH_FRAMES );
+				qemu_chr_add_handlers( s->si[i].tdm[t].chr, mpc8560_cpm_tdm_can_receive,
+						mpc8560_cpm_tdm_receive, NULL, &(s->si[i].tdm[t]) );
+			} else { /* QAC */ }
+		}
+	}
+
+	/* FCC 1 ~ 3, TC layer, the registers of a left out FCC read as zero */
+	if (CPM_HAS(s, BLK_FCC_1) || CPM_HAS(s, BLK_FCC_2) || CPM_HAS(s, BLK_FCC_3)) {
+		memory_region_init_io( &(s->fcc_mmio), OBJECT(s), &mpc8560_cpm_fcc_ops, s, "cpm.fcc", 0x60 );
+		memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_GFMR1), &(s->fcc_mmio), 1 );
+		s->atm_timer = qemu_new_timer_ns( vm_clock, mpc8560_cpm_atm_timer_cb, s );
+	} else { /* QAC */ }
+	if (CPM_HAS(s, BLK_FCC_1) || CPM_HAS(s, BLK_FCC_2)) {
+		memory_region_init_io( &(s->tc_mmio), OBJECT(s), &mpc8560_cpm_tc_ops, s, "cpm.tc", 0x104 );
+		memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_TCMODE1), &(s->tc_mmio), 1 );
+	} else { /* QAC */ }
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		s->fcc[i].s = s;
+		s->fcc[i].idx = i;
+		if (s->fcc[i].conf.peers.ncs[0]) {
+			qemu_macaddr_default_if_unset( &(s->fcc[i].conf.macaddr) );
+			s->fcc[i].nic = qemu_new_nic( &net_mpc8560_cpm_fcc_info, &(s->fcc[i].conf),
+					object_get_typename(OBJECT(s)), DEVICE(s)->id, &(s->fcc[i]) );
+			qemu_format_nic_info_str( qemu_get_queue(s->fcc[i].nic), s->fcc[i].conf.macaddr.a );
+		} else { /* QAC */ }
+	}
+	for (i = 0; i < CPM_NUM_ATM_FCC; i++) {
+		if (!CPM_HAS(s, BLK_FCC_1 + i))
+			continue;
+		else { /* QAC */ }
+		s->fcc[i].atm_ch_num = CPM_ATM_CHANNELS;
+		s->fcc[i].atm_ch = g_new0(CPMAtmChannel, s->fcc[i].atm_ch_num);
+		s->fcc[i].atm_lookup = g_hash_table_new(g_direct_hash, g_direct_equal);
+		s->fcc[i].tx_batch = g_malloc(CPM_ATM_CELL * CPM_ATM_BATCH_CELLS);
+		if (s->fcc[i].chr)
+			qemu_chr_add_handlers( s->fcc[i].chr, mpc8560_cpm_atm_can_receive,
+					mpc8560_cpm_atm_receive, NULL, &(s->fcc[i]) );
+		else { /* QAC */ }
+	}
+
+	/* MDIO/MDC are claimed from the gpio lines once attached */
+	s->mdio.mdc_port = -1;
+	s->mdio.mdio_port = -1;
+	if ((s->mdio.mdc_pin < CPM_IOPORT_GPIOS) && (s->mdio.mdio_pin < CPM_IOPORT_GPIOS)) {
+		s->mdio.mdc_port = s->mdio.mdc_pin / CPM_IOPORT_PINS;
+		s->mdio.mdc_mask = IOPORT_PIN_MASK(s->mdio.mdc_pin % CPM_IOPORT_PINS);
+		s->mdio.mdio_port = s->mdio.mdio_pin / CPM_IOPORT_PINS;
+		s->mdio.mdio_mask = IOPORT_PIN_MASK(s->mdio.mdio_pin % CPM_IOPORT_PINS);
+		s->ioport[s->mdio.mdc_port].pin_claim |= s->mdio.mdc_mask;
+		s->ioport[s->mdio.mdio_port].pin_claim |= s->mdio.mdio_mask;
+		/* released line is pulled up */
+		s->ioport[s->mdio.mdio_port].pin_in |= s->mdio.mdio_mask;
+	} else if ((s->mdio.mdc_pin != CPM_MDIO_PIN_NONE) || (s->mdio.mdio_pin != CPM_MDIO_PIN_NONE)) {
+		error_setg(errp, "mdc-pin and mdio-pin must both name a port pin");
+		return ;
+	} else { /* QAC */ }
+
 
-		/* SCC4 */	
-		case BCTS(CPM_REG_GSMR_L4):
-			break;
-		case BCTS(CPM_REG_GSMR_H4):
-			break;
-		case BCTS(CPM_REG_PSMR4):
-			break;
-		case BCTS(CPM_REG_TODR4):
-			break;
-		case BCTS(CPM_REG_DSR4):
-			break;
-		case BCTS(CPM_REG_SCCE4):
-			break;
-		case BCTS(CPM_REG_SCCM4):
-			break;
-		case BCTS(CPM_REG_SCCS4):
-			break;
-#endif /* Not implemented yet */
+	/* Instruction RAM, plain RAM so microcode reads back and migrates */
+	if (CPM_HAS(s, BLK_INSTRAM)) {
+		memory_region_init_ram( &(s->dpinstram), NULL, "cpm.instram", CPM_SIZE_DPINSTRAM );
+		vmstate_register_ram( &(s->dpinstram), DEVICE(s) );
+		memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPINSTRAM), &(s->dpinstram) );
+		if (s->instram_trace)
+			memory_region_set_log( &(s->dpinstram), true, DIRTY_MEMORY_VGA );
+		else { /* QAC */ }
+	} else { /* QAC */ }
+	
+	return ;
+}
 
-		default :
-			fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
-					__func__, __LINE__, (int)addr, (unsigned)value);
+/* ******************** MIGRATION ******************** */
+/* a ring travels as its fill level followed by the pending bytes */
+static int get_cpm_ring(QEMUFile* f, void* pv, size_t size)
+{
+	CPMRing* r = pv;
+	uint32_t used = qemu_get_be32(f);
+	uint8_t buf[256];
+	uint32_t n;
+
+	if (used > r->size)
+		return -EINVAL;
+	else { /* QAC */ }
+
+	cpm_ring_reset(r);
+	while (used > 0) {
+		n = MIN(used, sizeof(buf));
+		qemu_get_buffer(f, buf, n);
+		cpm_ring_push(r, buf, n);
+		used -= n;
+	}
+
+	return 0;
+}
+
+static void put_cpm_ring(QEMUFile* f, void* pv, size_t size)
+{
+	CPMRing* r = pv;
+	uint32_t used = cpm_ring_used(r);
+	uint32_t tail = r->tail;
+	uint32_t off;
+	uint32_t n;
+
+	qemu_put_be32(f, used);
+	while (used > 0) {
+		off = tail & (r->size - 1);
+		n = MIN(used, r->size - off);
+		qemu_put_buffer(f, r->data + off, n);
+		tail += n;
+		used -= n;
 	}
+
 	return ;
 }
 
-static uint64_t mpc8560_cpm_dpram_read(void* opaque, hwaddr addr, unsigned size)
-{// FIXME : temporary
-	uint32_t ret = 0;
+static const VMStateInfo vmstate_info_cpm_ring =
+{
+	.name = "cpm-ring",
+	.get = get_cpm_ring,
+	.put = put_cpm_ring,
+};
+
+static const VMStateDescription vmstate_cpm_ioport =
+{
+	.name = "mpc8560-cpm/ioport",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(pdir, CPMIOPort),
+		VMSTATE_UINT32(ppar, CPMIOPort),
+		VMSTATE_UINT32(psor, CPMIOPort),
+		VMSTATE_UINT32(podr, CPMIOPort),
+		VMSTATE_UINT32(pdat, CPMIOPort),
+		VMSTATE_UINT32(pin_in, CPMIOPort),
+		VMSTATE_UINT32(pin_out, CPMIOPort),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static bool mpc8560_cpm_scc1_needed(void* opaque)
+{
 	CPMState* s = (CPMState*)opaque;
-	
-	switch( addr )
-	{
-		case 0x0: 	/* 0xe1080080 -> bdstatus */
-		case 0x1:
-			PARTIAL_READ( 0x0, s->bd_status, addr, size, ret);
-			break;
-		case 0x2:	/* 0xe1080082 -> bdLength */
-		case 0x3:
-			PARTIAL_READ( 0x2, s->bd_dlen, addr, size, ret);
-			break;
-		default : /* should never reach here */
-			fprintf( stderr, "%s:%d] Unknown register raed: %x\n",
-					__func__, __LINE__, (int)addr);
+
+	return CPM_HAS(s, BLK_SCC_1) && ((s->scc[0].chr != NULL) || GSMR_L_DIAG(s->scc[0].gsmr_l));
+}
+
+static const VMStateDescription vmstate_cpm_scc1 =
+{
+	.name = "mpc8560-cpm/scc1",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT64(scc[0].rxbd, CPMState),
+		VMSTATE_SINGLE(scc[0].rx_ring, CPMState, 0, vmstate_info_cpm_ring, CPMRing),
+		VMSTATE_UINT8(scc[0].rx_fifo_itl, CPMState),
+		VMSTATE_TIMER(scc[0].fifo_timeout_timer, CPMState),
+		VMSTATE_TIMER(scc[0].status_poll, CPMState),
+		VMSTATE_UINT8(scc[0].uart_hunt, CPMState),
+		VMSTATE_UINT8(scc[0].uart_brk_pending, CPMState),
+		VMSTATE_UINT32(scc[0].uart_brk_at, CPMState),
+		VMSTATE_UINT8(scc[0].rx_stalled, CPMState),
+		VMSTATE_UINT32(scc[0].tx_done, CPMState),
+		VMSTATE_INT64(scc[0].rx_stall_start, CPMState),
+		VMSTATE_UINT8(scc[0].rx_ov_pending, CPMState),
+		VMSTATE_UINT32(scc[0].rx_ov_at, CPMState),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+/* SCC2 ~ 4 data path, receive and BISYNC state together, SCC1 keeps its own subsections */
+static const VMStateDescription vmstate_cpm_scc_data =
+{
+	.name = "mpc8560-cpm/scc-data",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT64(rxbd, CPMScc),
+		VMSTATE_SINGLE(rx_ring, CPMScc, 0, vmstate_info_cpm_ring, CPMRing),
+		VMSTATE_UINT8(rx_fifo_itl, CPMScc),
+		VMSTATE_TIMER(fifo_timeout_timer, CPMScc),
+		VMSTATE_TIMER(status_poll, CPMScc),
+		VMSTATE_UINT8(uart_hunt, CPMScc),
+		VMSTATE_UINT8(uart_brk_pending, CPMScc),
+		VMSTATE_UINT32(uart_brk_at, CPMScc),
+		VMSTATE_UINT8(rx_stalled, CPMScc),
+		VMSTATE_UINT32(tx_done, CPMScc),
+		VMSTATE_INT64(rx_stall_start, CPMScc),
+		VMSTATE_UINT8(rx_ov_pending, CPMScc),
+		VMSTATE_UINT32(rx_ov_at, CPMScc),
+		VMSTATE_UINT16(bsc_rx_crc, CPMScc),
+		VMSTATE_UINT16(bsc_rx_bcs_in, CPMScc),
+		VMSTATE_UINT8(bsc_rx_dle, CPMScc),
+		VMSTATE_UINT8(bsc_rx_bcs, CPMScc),
+		VMSTATE_UINT8(bsc_rx_hunt_after, CPMScc),
+		VMSTATE_UINT16(bsc_tx_crc, CPMScc),
+		VMSTATE_UINT8(bsc_tx_open, CPMScc),
+		VMSTATE_UINT8_ARRAY(bsc_tx_tail, CPMScc, 4),
+		VMSTATE_UINT8(bsc_tx_tail_len, CPMScc),
+		VMSTATE_END_OF_LIST()
 	}
+};
 
+static bool mpc8560_cpm_scc_data_needed(CPMState* s, int n)
+{
+	return CPM_HAS(s, BLK_SCC_1 + n) && ((s->scc[n].chr != NULL) || GSMR_L_DIAG(s->scc[n].gsmr_l)
+			|| (GSMR_L_MODE(s->scc[n].gsmr_l) == GSMR_MODE_BISYNC));
+}
 
-	DPRINTF("opaque=%p, addr=%x, size=%x ret=%x", opaque, (uint32_t)addr, size, ret);
-	return ret;
+static bool mpc8560_cpm_scc2_needed(void* opaque)
+{
+	return mpc8560_cpm_scc_data_needed((CPMState*)opaque, 1);
+}
+
+static bool mpc8560_cpm_scc3_needed(void* opaque)
+{
+	return mpc8560_cpm_scc_data_needed((CPMState*)opaque, 2);
+}
+
+static bool mpc8560_cpm_scc4_needed(void* opaque)
+{
+	return mpc8560_cpm_scc_data_needed((CPMState*)opaque, 3);
 }
 
-static void mpc8560_cpm_dpram_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
-{// FIXME : temporary
+static const VMStateDescription vmstate_cpm_scc2 =
+{
+	.name = "mpc8560-cpm/scc2",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_STRUCT(scc[1], CPMState, 1, vmstate_cpm_scc_data, CPMScc),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static const VMStateDescription vmstate_cpm_scc3 =
+{
+	.name = "mpc8560-cpm/scc3",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_STRUCT(scc[2], CPMState, 1, vmstate_cpm_scc_data, CPMScc),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static const VMStateDescription vmstate_cpm_scc4 =
+{
+	.name = "mpc8560-cpm/scc4",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_STRUCT(scc[3], CPMState, 1, vmstate_cpm_scc_data, CPMScc),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static bool mpc8560_cpm_bsc_needed(void* opaque)
+{
 	CPMState* s = (CPMState*)opaque;
-	//SysBusDevice* d = SYS_BUS_DEVICE(opaque);
-	//addr &= MPC8560_CPM_MMIO_SIZE - 1;
 
-	DPRINTF("opaque= %p, addr= %x, value= %lx size=%x", opaque, (uint32_t)addr, value, size);
-		
-	switch( addr )
-	{
-		case 0x0:	/* 0xe1080080 -> bdstatus */
-		case 0x1:
-			PARTIAL_WRITE( 0x0, s->bd_status, addr, size, value);
-			DPRINTF("bd_status -> %x", s->bd_status );
-			
-			/* Detecting R bit */
-			/* FIXME : Cannot actively response to a changes of TBPTR */
-			if( s->bd_status & 0x8000 ) /* R bit set? */
-				mpc8560_cpm_frame_tx_cb(opaque, PG_SCC_1);
-			break;
-		case 0x2:	/* 0xe1080082 -> bdlength */
-		case 0x3:
-			PARTIAL_WRITE( 0x2, s->bd_dlen, addr, size, value);
-			DPRINTF("bd_dlen -> %x", s->bd_dlen );
-			break;
-		default :
-			fprintf( stderr, "%s:%d] Unknown register write: %x = %x\n",
-					__func__, __LINE__, (int)addr, (unsigned)value);
+	return CPM_HAS(s, BLK_SCC_1) && (GSMR_L_MODE(s->scc[0].gsmr_l) == GSMR_MODE_BISYNC);
+}
+
+/* BISYNC block in progress, SYNC/DLE and the tables are compiled again on load */
+static const VMStateDescription vmstate_cpm_bsc =
+{
+	.name = "mpc8560-cpm/scc1-bisync",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT16(scc[0].bsc_rx_crc, CPMState),
+		VMSTATE_UINT16(scc[0].bsc_rx_bcs_in, CPMState),
+		VMSTATE_UINT8(scc[0].bsc_rx_dle, CPMState),
+		VMSTATE_UINT8(scc[0].bsc_rx_bcs, CPMState),
+		VMSTATE_UINT8(scc[0].bsc_rx_hunt_after, CPMState),
+		VMSTATE_UINT16(scc[0].bsc_tx_crc, CPMState),
+		VMSTATE_UINT8(scc[0].bsc_tx_open, CPMState),
+		VMSTATE_UINT8_ARRAY(scc[0].bsc_tx_tail, CPMState, 4),
+		VMSTATE_UINT8(scc[0].bsc_tx_tail_len, CPMState),
+		VMSTATE_END_OF_LIST()
 	}
+};
 
-	return ;
+static bool mpc8560_cpm_mdio_needed(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+
+	return (s->mdio.mdc_port >= 0);
 }
 
-static uint64_t mpc8560_cpm_instram_debug_read(void* opaque, hwaddr addr, unsigned size)
+static const VMStateDescription vmstate_cpm_mdio =
 {
-	uint32_t ret = 0;
-	DPRINTF("READ ACCESS INSTRUCTION RAM");
-	return ret;
+	.name = "mpc8560-cpm/mdio",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(mdio.state, CPMState),
+		VMSTATE_UINT32(mdio.count, CPMState),
+		VMSTATE_UINT32(mdio.shift, CPMState),
+		VMSTATE_UINT8(mdio.reg, CPMState),
+		VMSTATE_UINT16_ARRAY(mdio.phy_regs, CPMState, CPM_MDIO_NUM_REGS),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static bool mpc8560_cpm_sdma_needed(void* opaque)
+{
+	/* SDMA is never left out, SMAER holds the last fault even after SMEVR is acknowledged */
+	return true;
 }
 
-static void mpc8560_cpm_instram_debug_write(void* opaque, hwaddr addr, uint64_t value, unsigned size)
+static const VMStateDescription vmstate_cpm_sdma =
 {
-	DPRINTF("WRITE ACCESS INSTRUCTION RAM");
-	return ;
+	.name = "mpc8560-cpm/sdma",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(sdma.smaer, CPMState),
+		VMSTATE_UINT32(sdma.smevr, CPMState),
+		VMSTATE_UINT32(sdma.smctr, CPMState),
+		VMSTATE_UINT32(sdma.lmaer, CPMState),
+		VMSTATE_UINT32(sdma.lmevr, CPMState),
+		VMSTATE_UINT32(sdma.lmctr, CPMState),
+		VMSTATE_END_OF_LIST()
+	}
+};
+
+static bool mpc8560_cpm_regs_needed(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+	int i;
+
+	for (i = 4; i < CPM_NUM_BRG; i++) {
+		if (s->brgc[i])
+			return true;
+		else { /* QAC */ }
+	}
+	for (i = 2; i < CPM_NUM_SCC; i++) {
+		if (s->scc[i].gsmr_l || s->scc[i].gsmr_h || s->scc[i].psmr || s->scc[i].todr
+			|| s->scc[i].scce || s->scc[i].resv || s->scc[i].sccm || s->scc[i].sccs
+			|| (s->scc[i].dsr != 0x7e7e))
+			return true;
+		else { /* QAC */ }
+	}
+
+	return s->scc[1].resv != 0;
 }
 
-static const MemoryRegionOps mpc8560_cpm_default_ops =
+/* BRG5 ~ 8 and SCC3 ~ 4 registers, held since the register blocks are indexed */
+static const VMStateDescription vmstate_cpm_regs =
 {
-	.read		= mpc8560_cpm_default_read,
-	.write		= mpc8560_cpm_default_write,
-	.endianness	= DEVICE_BIG_ENDIAN,
-//	.impl = {	.min_access_size = 4,
-//				.max_access_size = 4,
-//	},
+	.name = "mpc8560-cpm/brg-scc",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(brgc[4], CPMState),
+		VMSTATE_UINT32(brgc[5], CPMState),
+		VMSTATE_UINT32(brgc[6], CPMState),
+		VMSTATE_UINT32(brgc[7], CPMState),
+		VMSTATE_UINT16(scc[1].resv, CPMState),
+		VMSTATE_UINT32(scc[2].gsmr_l, CPMState),
+		VMSTATE_UINT32(scc[2].gsmr_h, CPMState),
+		VMSTATE_UINT16(scc[2].psmr, CPMState),
+		VMSTATE_UINT16(scc[2].todr, CPMState),
+		VMSTATE_UINT16(scc[2].dsr, CPMState),
+		VMSTATE_UINT16(scc[2].scce, CPMState),
+		VMSTATE_UINT16(scc[2].resv, CPMState),
+		VMSTATE_UINT16(scc[2].sccm, CPMState),
+		VMSTATE_UINT8(scc[2].sccs, CPMState),
+		VMSTATE_UINT32(scc[3].gsmr_l, CPMState),
+		VMSTATE_UINT32(scc[3].gsmr_h, CPMState),
+		VMSTATE_UINT16(scc[3].psmr, CPMState),
+		VMSTATE_UINT16(scc[3].todr, CPMState),
+		VMSTATE_UINT16(scc[3].dsr, CPMState),
+		VMSTATE_UINT16(scc[3].scce, CPMState),
+		VMSTATE_UINT16(scc[3].resv, CPMState),
+		VMSTATE_UINT16(scc[3].sccm, CPMState),
+		VMSTATE_UINT8(scc[3].sccs, CPMState),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
-static const MemoryRegionOps mpc8560_cpm_intctrl_ops = 
+static const VMStateDescription vmstate_cpm_si =
 {
-	.read		= mpc8560_cpm_intctrl_read,
-	.write		= mpc8560_cpm_intctrl_write,
-	.endianness = DEVICE_BIG_ENDIAN,
-//	.impl = { 	.min_access_size = 4,
-//				.max_access_size = 4,
-//	},
+	.name = "mpc8560-cpm/si/unit",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT16_ARRAY(mr, CPMSi, CPM_SI_TDMS),
+		VMSTATE_UINT8(gmr, CPMSi),
+		VMSTATE_UINT8(cmdr, CPMSi),
+		VMSTATE_UINT8(str, CPMSi),
+		VMSTATE_UINT16(rsr, CPMSi),
+		VMSTATE_UINT16_ARRAY(txram, CPMSi, CPM_SI_RAM_ENTRIES),
+		VMSTATE_UINT16_ARRAY(rxram, CPMSi, CPM_SI_RAM_ENTRIES),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
-static const MemoryRegionOps mpc8560_cpm_cp_ops =
+static const VMStateDescription vmstate_cpm_mcc =
 {
-	.read		= mpc8560_cpm_cp_read,
-	.write		= mpc8560_cpm_cp_write,
-	.endianness = DEVICE_BIG_ENDIAN,
-//	.impl = {	.min_access_size = 4,
-//				.max_access_size = 4,
-//	},
+	.name = "mpc8560-cpm/mcc/unit",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT16(mcce, CPMMcc),
+		VMSTATE_UINT16(mccm, CPMMcc),
+		VMSTATE_UINT8(mccf, CPMMcc),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
-static const MemoryRegionOps mpc8560_cpm_sccx_ops =
+static const VMStateDescription vmstate_cpm_mcc_ch =
 {
-	.read		= mpc8560_cpm_sccx_read,
-	.write		= mpc8560_cpm_sccx_write,
-	.endianness	= DEVICE_BIG_ENDIAN,
-//	.impl = {	.min_access_size = 4,
-//				.max_access_size = 4,
-//	},
+	.name = "mpc8560-cpm/mcc/channel",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT8(tx_on, CPMMccChannel),
+		VMSTATE_UINT8(rx_on, CPMMccChannel),
+		VMSTATE_UINT8(hdlc, CPMMccChannel),
+		VMSTATE_UINT8(crc32, CPMMccChannel),
+		VMSTATE_UINT8(tx_state, CPMMccChannel),
+		VMSTATE_UINT8(tx_qlen, CPMMccChannel),
+		VMSTATE_UINT8(tx_ones, CPMMccChannel),
+		VMSTATE_UINT8(tx_fcs_idx, CPMMccChannel),
+		VMSTATE_UINT32(tx_q, CPMMccChannel),
+		VMSTATE_UINT32(tx_crc, CPMMccChannel),
+		VMSTATE_UINT64(tx_bd, CPMMccChannel),
+		VMSTATE_UINT64(tx_ptr, CPMMccChannel),
+		VMSTATE_UINT16(tx_len, CPMMccChannel),
+		VMSTATE_UINT16(tx_off, CPMMccChannel),
+		VMSTATE_UINT8_ARRAY(tx_pf, CPMMccChannel, CPM_SDMA_BURST),
+		VMSTATE_UINT8(tx_pf_pos, CPMMccChannel),
+		VMSTATE_UINT8(tx_pf_len, CPMMccChannel),
+		VMSTATE_UINT8(rx_hunt, CPMMccChannel),
+		VMSTATE_UINT8(rx_nacc, CPMMccChannel),
+		VMSTATE_UINT8(rx_ones, CPMMccChannel),
+		VMSTATE_UINT8(rx_first, CPMMccChannel),
+		VMSTATE_UINT32(rx_acc, CPMMccChannel),
+		VMSTATE_UINT32(rx_crc, CPMMccChannel),
+		VMSTATE_UINT64(rx_bd, CPMMccChannel),
+		VMSTATE_UINT64(rx_ptr, CPMMccChannel),
+		VMSTATE_UINT16(rx_max, CPMMccChannel),
+		VMSTATE_UINT16(rx_cnt, CPMMccChannel),
+		VMSTATE_UINT32(rx_flen, CPMMccChannel),
+		VMSTATE_UINT8_ARRAY(rx_pf, CPMMccChannel, CPM_SDMA_BURST),
+		VMSTATE_UINT8(rx_pf_len, CPMMccChannel),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
-static const MemoryRegionOps mpc8560_cpm_dpram_ops =
-{// FIXME : for temporary use until cpm enabled, forcing dpram to mmio
-	.read		= mpc8560_cpm_dpram_read,
-	.write		= mpc8560_cpm_dpram_write,
-	.endianness	= DEVICE_BIG_ENDIAN,
-	.impl = {	.min_access_size = 1,
-				.max_access_size = 2,
-	},
+static bool mpc8560_cpm_si_needed(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
+
+	/* SI RAM and SIxMR are programmed before SIxGMR, so nothing short of the block says idle */
+	return CPM_HAS(s, BLK_MCC_1) || CPM_HAS(s, BLK_MCC_2);
+}
+
+static const VMStateDescription vmstate_cpm_si_mcc =
+{
+	.name = "mpc8560-cpm/si",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_STRUCT_ARRAY(si, CPMState, CPM_NUM_SI, 1, vmstate_cpm_si, CPMSi),
+		VMSTATE_STRUCT_ARRAY(mcc, CPMState, CPM_NUM_MCC, 1, vmstate_cpm_mcc, CPMMcc),
+		VMSTATE_STRUCT_VARRAY_POINTER_INT32(mcc_ch, CPMState, mcc_ch_num, vmstate_cpm_mcc_ch, CPMMccChannel),
+		VMSTATE_TIMER(tdm_timer, CPMState),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
-static const MemoryRegionOps mpc8560_cpm_instram_debug_ops =
+static const VMStateDescription vmstate_cpm_atm_ch =
 {
-	.read		= mpc8560_cpm_instram_debug_read,
-	.write		= mpc8560_cpm_instram_debug_write,
-	.endianness = DEVICE_BIG_ENDIAN,
-//	.impl = {	.min_access_size = 2,
-//				.max_access_size = 2,
-//	},
+	.name = "mpc8560-cpm/atm/channel",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT8(tx_on, CPMAtmChannel),
+		VMSTATE_UINT8(tx_pad, CPMAtmChannel),
+		VMSTATE_UINT8(rx_on, CPMAtmChannel),
+		VMSTATE_UINT8(rx_discard, CPMAtmChannel),
+		VMSTATE_UINT64(tx_bd, CPMAtmChannel),
+		VMSTATE_UINT16(tx_len, CPMAtmChannel),
+		VMSTATE_UINT16(tx_off, CPMAtmChannel),
+		VMSTATE_UINT32(tx_flen, CPMAtmChannel),
+		VMSTATE_UINT32(tx_crc, CPMAtmChannel),
+		VMSTATE_UINT64(rx_bd, CPMAtmChannel),
+		VMSTATE_UINT16(rx_max, CPMAtmChannel),
+		VMSTATE_UINT16(rx_cnt, CPMAtmChannel),
+		VMSTATE_UINT32(rx_flen, CPMAtmChannel),
+		VMSTATE_UINT32(rx_crc, CPMAtmChannel),
+		VMSTATE_UINT8(rx_first, CPMAtmChannel),
+		VMSTATE_END_OF_LIST()
+	}
 };
 
+static const VMStateDescription vmstate_cpm_fcc =
+{
+	.name = "mpc8560-cpm/fcc/unit",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(gfmr, CPMFcc),
+		VMSTATE_UINT32(fpsmr, CPMFcc),
+		VMSTATE_UINT16(ftodr, CPMFcc),
+		VMSTATE_UINT16(fdsr, CPMFcc),
+		VMSTATE_UINT32(fcce, CPMFcc),
+		VMSTATE_UINT32(fccm, CPMFcc),
+		VMSTATE_UINT8(fccs, CPMFcc),
+		VMSTATE_UINT8_ARRAY(rx_cell, CPMFcc, CPM_ATM_CELL),
+		VMSTATE_UINT32(rx_cell_len, CPMFcc),
+		VMSTATE_UINT32(tx_rr, CPMFcc),
+		VMSTATE_UINT64(eth_rbd, CPMFcc),
+		VMSTATE_UINT64(eth_tbd, CPMFcc),
+		VMSTATE_STRUCT_VARRAY_POINTER_INT32(atm_ch, CPMFcc, atm_ch_num, vmstate_cpm_atm_ch, CPMAtmChannel),
+		VMSTATE_END_OF_LIST()
+	}
+};
 
-static void mpc8560_cpm_initfn(Object* obj)
+static const VMStateDescription vmstate_cpm_tc =
 {
-//	SysBusDevice* d = SYS_BUS_DEVICE(obj);
-	CPMState* s = MPC8560_CPM(obj);
+	.name = "mpc8560-cpm/tc/unit",
+	.version_id = 1,
+	.minimum_version_id = 1,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT16(tcmode, CPMTc),
+		VMSTATE_UINT16(cdsmr, CPMTc),
+		VMSTATE_UINT16(tcer, CPMTc),
+		VMSTATE_UINT16(tcmr, CPMTc),
+		VMSTATE_UINT64(rcc, CPMTc),
+		VMSTATE_UINT64(fcc, CPMTc),
+		VMSTATE_UINT64(ccc, CPMTc),
+		VMSTATE_UINT64(icc, CPMTc),
+		VMSTATE_UINT64(tcc, CPMTc),
+		VMSTATE_UINT64(ecc, CPMTc),
+		VMSTATE_END_OF_LIST()
+	}
+};
 
-	DPRINTF("HIT");	
+static bool mpc8560_cpm_fcc_needed(void* opaque)
+{
+	CPMState* s = (CPMState*)opaque;
 
-	/* Creating a CPM memory address space and will be attached as a subregion of ccsr_space */
-	memory_region_init(&(s->cpm_space), obj, "mpc8560-cpm", 0x40000);
+	/* FPSMR, FTODR and the TC setup are programmed before GFMR[ENT/ENR] */
+	return CPM_HAS(s, BLK_FCC_1) || CPM_HAS(s, BLK_FCC_2) || CPM_HAS(s, BLK_FCC_3);
+}
 
+static const VMStateDescription vmstate_cpm_fcc_tc =
+{
+	.name = "mpc8560-cpm/fcc",
+	.version_id = 2,
+	.minimum_version_id = 2,	/* ATM channels only for a present FCC1 ~ 2 */
+	.fields = (VMStateField[]) {
+		VMSTATE_STRUCT_ARRAY(fcc, CPMState, CPM_NUM_FCC, 1, vmstate_cpm_fcc, CPMFcc),
+		VMSTATE_STRUCT_ARRAY(tc, CPMState, CPM_NUM_TC, 1, vmstate_cpm_tc, CPMTc),
+		VMSTATE_UINT16(tcgsr, CPMState),
+		VMSTATE_UINT16(tcger, CPMState),
+		VMSTATE_TIMER(atm_timer, CPMState),
+		VMSTATE_END_OF_LIST()
+	}
+};
 
-//	memory_region_init_io(&s->cpm_space, OBJECT(s), &mpc8560_cpm_ops, s,
-//							"mpc8560-cpm", MPC8560_CPM_MMIO_SIZE);
-//	sysbus_init_mmio(d, &(s->iomem));
-	
-	return ;
+/**
+ * @fn static int mpc8560_cpm_post_load(void* opaque, int version_id)
+ * @brief Rebuilds what is derived from the guest tables and drives the interrupt line again
+ *
+ */
+static int mpc8560_cpm_post_load(void* opaque, int version_id)
+{
+	CPMState* s = (CPMState*)opaque;
+	int i;
+
+	for (i = 0; i < CPM_NUM_SI; i++)
+		s->si[i].plan_dirty = 0xf;
+
+	for (i = 0; i < CPM_NUM_SCC; i++)
+		mpc8560_cpm_uart_compile(&(s->scc[i]));
+
+	for (i = 0; i < CPM_NUM_ATM_FCC; i++) {
+		if (s->fcc[i].atm_lookup)
+			mpc8560_cpm_atm_build_lookup(s, i);
+		else { /* QAC */ }
+	}
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		if (s->fcc[i].nic)
+			mpc8560_cpm_eth_latch(s, i);
+		else { /* QAC */ }
+	}
+
+	/* queued work is not migrated, a TxBD still marked ready is picked up again */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		if (!CPM_HAS(s, BLK_SCC_1 + i))
+			continue;
+		else { /* QAC */ }
+		mpc8560_cpm_cp_kick(s, CP_WORK_SCC_TX(i));
+		mpc8560_cpm_scc_bd_poll_arm(&(s->scc[i]));
+	}
+
+	mpc8560_cpm_update_irq(s);
+
+	return 0;
 }
 
-void mpc8560_cpm_init_serial(CPMState* s, CharDriverState* chr)
+static const VMStateDescription vmstate_mpc8560_cpm =
 {
-	QEMUSerialSetParams ssp;
-	
-	if( NULL == chr )
-		hw_error("%s:%d] Char device not initialized.\n", __func__, __LINE__);
-	
-	/* assign serial0 -> SCC1 */
-	if( !strncmp( chr->label, "serial0", strlen("serial0")) )
-	{
-		s->serial_scc1 = chr;
-		qemu_chr_add_handlers( s->serial_scc1, scc_can_receive, scc_receive, scc_event, s );
-		fifo8_create( &(s->recv_fifo_scc1), SCC_TXRX_FIFO_LEN );
-		s->scc_status_poll = qemu_new_timer_ns( vm_clock, (QEMUTimerCB*)scc_update_timer_cb, s );
-		s->fifo_timeout_timer = qemu_new_timer_ns( vm_clock, (QEMUTimerCB*)scc_fifo_timeout_int, s );
-
-		ssp.speed = 114583; /* baud rate 115200 actual freq 114583 */
-		ssp.parity = 'N';
-		ssp.data_bits = 8;
-		ssp.stop_bits = 1;
-		qemu_chr_fe_ioctl( s->serial_scc1, CHR_IOCTL_SERIAL_SET_PARAMS, &ssp );
+	.name = TYPE_MPC8560_CPM,
+	.version_id = 2,
+	.minimum_version_id = 2,
+	.post_load = mpc8560_cpm_post_load,
+	.fields = (VMStateField[]) {
+		VMSTATE_UINT32(cear, CPMState),
+		VMSTATE_UINT16(ceer, CPMState),
+		VMSTATE_UINT16(cemr, CPMState),
+
+		VMSTATE_UINT32(sicr, CPMState),
+		VMSTATE_UINT32(sivec, CPMState),
+		VMSTATE_UINT32(sipnr_h, CPMState),
+		VMSTATE_UINT32(sipnr_l, CPMState),
+		VMSTATE_UINT32(scprr_h, CPMState),
+		VMSTATE_UINT32(scprr_l, CPMState),
+		VMSTATE_UINT32(simr_h, CPMState),
+		VMSTATE_UINT32(simr_l, CPMState),
+		VMSTATE_UINT32(siexr, CPMState),
+
+		VMSTATE_UINT32(sccr, CPMState),
+
+		VMSTATE_STRUCT_ARRAY(ioport, CPMState, CPM_NUM_IOPORTS, 1, vmstate_cpm_ioport, CPMIOPort),
+
+		VMSTATE_UINT32(brgc[0], CPMState),
+		VMSTATE_UINT32(brgc[1], CPMState),
+		VMSTATE_UINT32(brgc[2], CPMState),
+		VMSTATE_UINT32(brgc[3], CPMState),
+
+		VMSTATE_UINT32(cpcr, CPMState),
+		VMSTATE_UINT32(rccr, CPMState),
+		VMSTATE_UINT16(rter, CPMState),
+		VMSTATE_UINT16(rtmr, CPMState),
+		VMSTATE_UINT16(rtscr, CPMState),
+		VMSTATE_UINT16(rtsr, CPMState),
+
+		VMSTATE_UINT32(scc[0].gsmr_l, CPMState),
+		VMSTATE_UINT32(scc[0].gsmr_h, CPMState),
+		VMSTATE_UINT16(scc[0].psmr, CPMState),
+		VMSTATE_UINT16(scc[0].todr, CPMState),
+		VMSTATE_UINT16(scc[0].dsr, CPMState),
+		VMSTATE_UINT16(scc[0].scce, CPMState),
+		VMSTATE_UINT16(scc[0].resv, CPMState),
+		VMSTATE_UINT16(scc[0].sccm, CPMState),
+		VMSTATE_UINT8(scc[0].sccs, CPMState),
+
+		VMSTATE_UINT32(scc[1].gsmr_l, CPMState),
+		VMSTATE_UINT32(scc[1].gsmr_h, CPMState),
+		VMSTATE_UINT16(scc[1].psmr, CPMState),
+		VMSTATE_UINT16(scc[1].todr, CPMState),
+		VMSTATE_UINT16(scc[1].dsr, CPMState),
+		VMSTATE_UINT16(scc[1].scce, CPMState),
+		VMSTATE_UINT16(scc[1].sccm, CPMState),
+		VMSTATE_UINT8(scc[1].sccs, CPMState),
+
+		VMSTATE_UINT8(cmxsi1cr, CPMState),
+		VMSTATE_UINT8(cmxsi2cr, CPMState),
+		VMSTATE_UINT32(cmxfcr, CPMState),
+		VMSTATE_UINT32(cmxscr, CPMState),
+		VMSTATE_UINT32(cmxuar, CPMState),
+		VMSTATE_END_OF_LIST()
+	},
+	/* blocks that may be idle are only sent when in use */
+	.subsections = (VMStateSubsection[]) {
+		{
+			.vmsd = &vmstate_cpm_scc1,
+			.needed = mpc8560_cpm_scc1_needed,
+		}, {
+			.vmsd = &vmstate_cpm_bsc,
+			.needed = mpc8560_cpm_bsc_needed,
+		}, {
+			.vmsd = &vmstate_cpm_scc2,
+			.needed = mpc8560_cpm_scc2_needed,
+		}, {
+			.vmsd = &vmstate_cpm_scc3,
+			.needed = mpc8560_cpm_scc3_needed,
+		}, {
+			.vmsd = &vmstate_cpm_scc4,
+			.needed = mpc8560_cpm_scc4_needed,
+		}, {
+			.vmsd = &vmstate_cpm_mdio,
+			.needed = mpc8560_cpm_mdio_needed,
+		}, {
+			.vmsd = &vmstate_cpm_sdma,
+			.needed = mpc8560_cpm_sdma_needed,
+		}, {
+			.vmsd = &vmstate_cpm_si_mcc,
+			.needed = mpc8560_cpm_si_needed,
+		}, {
+			.vmsd = &vmstate_cpm_fcc_tc,
+			.needed = mpc8560_cpm_fcc_needed,
+		}, {
+			.vmsd = &vmstate_cpm_regs,
+			.needed = mpc8560_cpm_regs_needed,
+		}, {
+			/* empty */
+		}
 	}
-	else
-		fprintf( stderr, "%s:%d] Initializing Char device (%s) ignored.\n", __func__, __LINE__, chr->label );
-	
-	return ;
-}
+};
 
-static void mpc8560_cpm_realize(DeviceState* dev, Error** errp)
+static Property mpc8560_cpm_properties[] =
+{
+	DEFINE_PROP_CHR("scc1", CPMState, scc[0].chr),
+	DEFINE_PROP_CHR("scc2", CPMState, scc[1].chr),
+	DEFINE_PROP_CHR("scc3", CPMState, scc[2].chr),
+	DEFINE_PROP_CHR("scc4", CPMState, scc[3].chr),
+	DEFINE_PROP_BOOL("instram-trace", CPMState, instram_trace, false),
+	DEFINE_PROP_BIT("has-scc1", CPMState, blocks, BLK_SCC_1, true),
+	DEFINE_PROP_BIT("has-scc2", CPMState, blocks, BLK_SCC_2, true),
+	DEFINE_PROP_BIT("has-scc3", CPMState, blocks, BLK_SCC_3, true),
+	DEFINE_PROP_BIT("has-scc4", CPMState, blocks, BLK_SCC_4, true),
+	DEFINE_PROP_BIT("has-fcc1", CPMState, blocks, BLK_FCC_1, true),
+	DEFINE_PROP_BIT("has-fcc2", CPMState, blocks, BLK_FCC_2, true),
+	DEFINE_PROP_BIT("has-fcc3", CPMState, blocks, BLK_FCC_3, true),
+	DEFINE_PROP_BIT("has-mcc1", CPMState, blocks, BLK_MCC_1, true),
+	DEFINE_PROP_BIT("has-mcc2", CPMState, blocks, BLK_MCC_2, true),
+	DEFINE_PROP_BIT("has-instram", CPMState, blocks, BLK_INSTRAM, true),
+	DEFINE_PROP_UINT32("mdc-pin", CPMState, mdio.mdc_pin, CPM_MDIO_PIN_NONE),
+	DEFINE_PROP_UINT32("mdio-pin", CPMState, mdio.mdio_pin, CPM_MDIO_PIN_NONE),
+	DEFINE_PROP_UINT32("phy-addr", CPMState, mdio.phy_addr, 0),
+	DEFINE_PROP_MACADDR("fcc1-mac", CPMState, fcc[0].conf.macaddr),
+	DEFINE_PROP_NETDEV("fcc1-netdev", CPMState, fcc[0].conf.peers),
+	DEFINE_PROP_MACADDR("fcc2-mac", CPMState, fcc[1].conf.macaddr),
+	DEFINE_PROP_NETDEV("fcc2-netdev", CPMState, fcc[1].conf.peers),
+	DEFINE_PROP_MACADDR("fcc3-mac", CPMState, fcc[2].conf.macaddr),
+	DEFINE_PROP_NETDEV("fcc3-netdev", CPMState, fcc[2].conf.peers),
+	DEFINE_PROP_CHR("fcc1-atm", CPMState, fcc[0].chr),
+	DEFINE_PROP_CHR("fcc2-atm", CPMState, fcc[1].chr),
+	DEFINE_PROP_CHR("si1-tdma", CPMState, si[0].tdm[0].chr),
+	DEFINE_PROP_CHR("si1-tdmb", CPMState, si[0].tdm[1].chr),
+	DEFINE_PROP_CHR("si1-tdmc", CPMState, si[0].tdm[2].chr),
+	DEFINE_PROP_CHR("si1-tdmd", CPMState, si[0].tdm[3].chr),
+	DEFINE_PROP_CHR("si2-tdma", CPMState, si[1].tdm[0].chr),
+	DEFINE_PROP_CHR("si2-tdmb", CPMState, si[1].tdm[1].chr),
+	DEFINE_PROP_CHR("si2-tdmc", CPMState, si[1].tdm[2].chr),
+	DEFINE_PROP_CHR("si2-tdmd", CPMState, si[1].tdm[3].chr),
+	DEFINE_PROP_END_OF_LIST(),
+};
+
+/**
+ * @fn static void mpc8560_cpm_unrealize(DeviceState* dev, Error** errp)
+ * @brief Undoes what realize started running
+ *
+ */
+static void mpc8560_cpm_unrealize(DeviceState* dev, Error** errp)
 {
-//	SysBusDevice* d = SYS_BUS_DEVICE(dev);
 	CPMState* s = MPC8560_CPM(dev);
+	int i;
+	int t;
 
-	DPRINTF("HIT");
-	
-	/* ** Initializing subregion ** */
-	memory_region_init_ram( &(s->dpram1), NULL, "cpm.dpram1", CPM_SIZE_DPRAM );
-	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPRAM1), &(s->dpram1) );
+	if (s->cp_bh) {
+		qemu_bh_delete( s->cp_bh );
+		s->cp_bh = NULL;
+	} else { /* QAC */ }
 
-	memory_region_init_ram( &(s->dpram2), NULL, "cpm.dpram2", CPM_SIZE_DPRAM );
-	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPRAM2), &(s->dpram2) );
-	
-	/* default mmio area(it cover the whole cpm registers area 0x90000 - 0x91fff) */
-	memory_region_init_io( &(s->whole_mmio), OBJECT(s), &mpc8560_cpm_default_ops, s, "cpm.mmio", 0x2000 ); 
-	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_REG_CEAR), &(s->whole_mmio) );
+	/* SCC data paths, a watch left behind would fire on a device that is gone */
+	for (i = 0; i < CPM_NUM_SCC; i++) {
+		if (s->scc[i].tx_watch) {
+			g_source_remove( s->scc[i].tx_watch );
+			s->scc[i].tx_watch = 0;
+		} else { /* QAC */ }
+		if (!s->scc[i].bd_poll)
+			continue;
+		else { /* QAC */ }
+		qemu_free_timer( s->scc[i].bd_poll );
+		qemu_free_timer( s->scc[i].status_poll );
+		qemu_free_timer( s->scc[i].fifo_timeout_timer );
+		s->scc[i].bd_poll = NULL;
+		s->scc[i].status_poll = NULL;
+		s->scc[i].fifo_timeout_timer = NULL;
+		cpm_ring_destroy( &(s->scc[i].rx_ring) );
+		cpm_ring_destroy( &(s->scc[i].echo_ring) );
+	}
 
-	/* interrupt controller */
-	memory_region_init_io( &(s->intctrl), OBJECT(s), &mpc8560_cpm_intctrl_ops, s, "cpm.intctrl", 0x80 );
-	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_SICR), &(s->intctrl), 1 );
-	
-	/* Communications Processor */
-	memory_region_init_io( &(s->cp_mmio), OBJECT(s), &mpc8560_cpm_cp_ops, s, "cpm.cp", 0x20 );
-	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_CPCR), &(s->cp_mmio), 1 );
+	/* channel tables of the optional blocks */
+	mpc8560_cpm_mcc_free_taps(s);
+	g_free( s->mcc_ch );
+	s->mcc_ch = NULL;
+	s->mcc_ch_num = 0;
+	for (i = 0; i < CPM_NUM_SI; i++) {
+		for (t = 0; t < CPM_SI_TDMS; t++) {
+			if (s->si[i].tdm[t].tx_watch) {
+				g_source_remove( s->si[i].tdm[t].tx_watch );
+				s->si[i].tdm[t].tx_watch = 0;
+			} else { /* QAC */ }
+			g_free( s->si[i].tdm[t].tx_batch );
+			s->si[i].tdm[t].tx_batch = NULL;
+			s->si[i].tdm[t].tx_pending = 0;
+		}
+	}
+	for (i = 0; i < CPM_NUM_FCC; i++) {
+		g_free( s->fcc[i].atm_ch );
+		s->fcc[i].atm_ch = NULL;
+		s->fcc[i].atm_ch_num = 0;
+	}
 
-	/* SCCx */
-	memory_region_init_io( &(s->sccx), OBJECT(s), &mpc8560_cpm_sccx_ops, s, "cpm.sccx", 0x80 );
-	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_REG_GSMR_L1), &(s->sccx), 1 );
+	return ;
+}
 
+/**
+ * @fn static void mpc8560_cpm_finalize(Object* obj)
+ * @brief Stops the capture writers, whatever they still hold goes to the files first
+ *
+ */
+static void mpc8560_cpm_finalize(Object* obj)
+{
+	CPMState* s = MPC8560_CPM(obj);
+	int i;
 
-	/* Initializing overlap memory space */
-	// TODO : connect scattered address by using alias 
-	// temporary use for detecting 1st TxBDs R bit because CPM clock source not enabled yet 
-	memory_region_init_io( &(s->cpm_dpram_temp), OBJECT(s), &mpc8560_cpm_dpram_ops, s, "cpm.dpram.mmio.temp", 0x4 );
-	memory_region_add_subregion_overlap( &(s->cpm_space), 0x80, &(s->cpm_dpram_temp), 1 );
-	
-	/* Instruction RAM */
-	memory_region_init_ram( &(s->dpinstram), NULL, "cpm.instram", CPM_SIZE_DPINSTRAM );
-	memory_region_add_subregion( &(s->cpm_space), BCTC(CPM_BASE_DPINSTRAM), &(s->dpinstram) );
+	for (i = 0; i < CPM_NUM_TAPS; i++) {
+		mpc8560_cpm_tap_stop(s, i);
+		g_free(s->tap[i].path);
+		s->tap[i].path = NULL;
+	}
 
-	/* FIXME: for debug */
-	memory_region_init_io( &(s->cpinstemp), OBJECT(s), &mpc8560_cpm_instram_debug_ops, s, "cpm.inst.dbg", CPM_SIZE_DPINSTRAM );
-	memory_region_add_subregion_overlap( &(s->cpm_space), BCTC(CPM_BASE_DPINSTRAM), &(s->cpinstemp), 1 );
-	
 	return ;
 }
 
@@ -1498,9 +7018,12 @@ static void mpc8560_cpm_class_init(ObjectClass* oc, void* data)
 	DeviceClass* dc = DEVICE_CLASS(oc);
 
 	DPRINTF("HIT");	
+	mpc8560_cpm_crc16_init();
 	dc->realize = mpc8560_cpm_realize;
-	//dc->props = ;
+	dc->unrealize = mpc8560_cpm_unrealize;
+	dc->props = mpc8560_cpm_properties;
 	dc->reset = mpc8560_cpm_reset;
+	dc->vmsd = &vmstate_mpc8560_cpm;
 
 	return ;
 }
@@ -1511,6 +7034,7 @@ static const TypeInfo mpc8560_cpm_info =
 	.parent			= TYPE_SYS_BUS_DEVICE,
 	.instance_size	= sizeof(CPMState),
 	.instance_init	= mpc8560_cpm_initfn,
+	.instance_finalize	= mpc8560_cpm_finalize,
 	.class_init 	= mpc8560_cpm_class_init,
 };
 
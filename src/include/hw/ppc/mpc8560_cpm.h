@@ -19,7 +19,11 @@
 #define __MPC8560_CPM__
 /* ******************** HEADER (INCLUDE) SECTION ******************* */
 #include "sysemu/char.h"
+#include "net/net.h"
+#include "qemu/thread.h"
 #include "qemu/fifo8.h"
+#include "qemu/bitmap.h"
+#include "hw/ppc/mpc8560_cpm_ring.h"
 /* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
 #define BASE_CCSR_TO_CPM(addr)	((addr) - (0x80000))
 #define BCTC(addr)	BASE_CCSR_TO_CPM(addr)
@@ -36,6 +40,18 @@
 #define BASE_CPM_TO_CP(addr)	((addr) - (0x919c0))
 #define BCTCP(addr)	BASE_CPM_TO_CP(addr)
 
+#define BASE_CPM_TO_IOPORT(addr)	((addr) - (0x90d00))
+#define BCTIO(addr)	BASE_CPM_TO_IOPORT(addr)
+
+#define BASE_CPM_TO_FCC(addr)	((addr) - (0x91300))
+#define BCTF(addr)	BASE_CPM_TO_FCC(addr)
+
+#define BASE_CPM_TO_TC(addr)	((addr) - (0x91400))
+#define BCTTC(addr)	BASE_CPM_TO_TC(addr)
+
+#define BASE_CPM_TO_SI(addr)	((addr) - (0x91b20))
+#define BCTSI(addr)	BASE_CPM_TO_SI(addr)
+
 /* ********** CPM Memory Map ********** */
 /* ****** CPM Dual-Port RAM ****** */
 #define CPM_BASE_DPRAM1 (0x80000ULL)    /* Dual-port RAM / RW / - */
@@ -394,8 +410,56 @@
 /* ****** Instruction RAM ****** */
 #define CPM_BASE_DPINSTRAM  (0xa0000ULL)    /* Dual-port RAM(instruction RAM only) / / undef */
 #define CPM_SIZE_DPINSTRAM  (0x8000)
+#define CPM_INSTRAM_TRACE_GRAIN	(0x400)	/* instram-trace reports writes at this granularity */
+
+#define CPM_NUM_SCC			(4)
+#define CPM_NUM_BRG			(8)
+#define CPM_SCC_STRIDE		(0x20)	/* SCCx register block, GSMR_L1 ~ GSMR_L2 */
+#define CPM_CACHELINE		(CPM_RING_CACHELINE)	/* registers start a line apart from the BD path state */
+#define CPM_LAT_BUCKETS		(32)	/* log2 ns, the last one also takes everything above ~4s */
 
 #define SCC_TXRX_FIFO_LEN	(32)
+#define SCC_RX_RING_LEN		(4096)	/* backend -> RxBD staging, power of two */
+#define SCC_ECHO_RING_LEN	(1024)	/* DIAG echo data the backend has not taken yet, power of two */
+
+/* ****** Capture ****** */
+#define CPM_TAP_SNAPLEN		(65535)
+#define CPM_TAP_RING_LEN	(1 << 20)	/* pcapng blocks waiting for the writer */
+
+/* ****** Parallel I/O Ports ****** */
+#define CPM_NUM_IOPORTS		(4)		/* Port A ~ D */
+#define CPM_IOPORT_PINS		(32)	/* pins per port, pin 0 is the MSB */
+#define CPM_IOPORT_GPIOS	(CPM_NUM_IOPORTS * CPM_IOPORT_PINS)
+
+/* ****** SI / MCC ****** */
+#define CPM_NUM_SI			(2)
+#define CPM_SI_TDMS			(4)		/* TDMa ~ TDMd per SI */
+#define CPM_SI_RAM_ENTRIES	(CPM_SIZE_SI1TxRAM / 2)
+#define CPM_SI_BANK_ENTRIES	(32)
+#define CPM_NUM_MCC			(2)
+#define CPM_MCC_PER_MCC		(128)
+#define CPM_MCC_CHANNELS	(CPM_NUM_MCC * CPM_MCC_PER_MCC)
+#define CPM_TDM_MAX_FRAME	(CPM_SI_RAM_ENTRIES * 8)	/* bytes, every entry 8 bytes wide */
+#define CPM_TDM_BATCH_FRAMES	(8)		/* 1ms of 125us frames per backend exchange */
+#define CPM_TDM_TX_QUEUE	(2 * CPM_TDM_MAX_FRAME * CPM_TDM_BATCH_FRAMES)	/* a batch held back and the next one */
+#define CPM_SI_PLAN_MAX		(CPM_SI_RAM_ENTRIES * 8)	/* segments, every entry up to 8 x 8 bits */
+
+/* ****** SDMA ****** */
+#define CPM_SDMA_BURST		(32)	/* bytes moved per transfer by the serial channels */
+
+/* ****** FCC / ATM / TC Layer ****** */
+#define CPM_NUM_FCC			(3)
+#define CPM_NUM_ATM_FCC		(2)		/* FCC3 has no UTOPIA */
+#define CPM_NUM_TC			(8)
+#define CPM_ATM_CHANNELS	(256)	/* internal RCT/TCT entries per FCC */
+#define CPM_ATM_CELL		(53)
+#define CPM_ATM_PAYLOAD		(48)
+#define CPM_ETH_MAX_FRAME	(2048)	/* longest frame taken either way, MFLR caps it further */
+#define CPM_ATM_BATCH_CELLS	(64)	/* cells per FCC per 1ms backend exchange */
+
+/* ****** MDIO bit-bang PHY ****** */
+#define CPM_MDIO_PIN_NONE	(0xffffffff)	/* mdc-pin/mdio-pin not attached */
+#define CPM_MDIO_NUM_REGS	(32)
 
 /* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
 typedef enum
@@ -458,6 +522,48 @@ typedef enum
 
 } TYPE_INT_SRC_PRI;	/* Interrupt Source Priority Levels */
 
+typedef enum
+{
+	IC_I2C		=	1,
+	IC_SPI		=	2,
+	IC_RISC_TB	=	3,
+	IC_SDMA		=	10,
+	IC_TIMER_1	=	12,
+	IC_TIMER_2	=	13,
+	IC_TIMER_3	=	14,
+	IC_TIMER_4	=	15,
+	IC_FCC_1	=	32,
+	IC_FCC_2	=	33,
+	IC_FCC_3	=	34,
+	IC_MCC_1	=	36,
+	IC_MCC_2	=	37,
+	IC_SCC_1	=	40,
+	IC_SCC_2	=	41,
+	IC_SCC_3	=	42,
+	IC_SCC_4	=	43,
+	IC_PC_15	=	48,	/* PC15 ~ PC0 are coded 48 ~ 63 */
+	IC_PC_0		=	63
+
+} TYPE_INT_SRC_CODE;	/* Interrupt Source Code (SIVEC[0:5]) */
+
+typedef enum
+{
+	IOPORT_A	=	0,
+	IOPORT_B	=	1,
+	IOPORT_C	=	2,
+	IOPORT_D	=	3
+
+} TYPE_IOPORT;
+
+typedef enum
+{
+	MDIO_ST_IDLE	=	0,	/* counting preamble */
+	MDIO_ST_CMD		=	1,	/* ST, OP, PHYAD, REGAD */
+	MDIO_ST_READ	=	2,	/* PHY drives TA and DATA */
+	MDIO_ST_WRITE	=	3	/* station drives TA and DATA */
+
+} TYPE_MDIO_STATE;
+
 typedef enum
 {
 	SC_SCC_1	=	0x04,
@@ -491,6 +597,29 @@ typedef enum
 
 } TYPE_CP_CMD_SCC;
 
+typedef enum
+{
+	OP_MCC_INIT_RX_TX_PARAMS	=	0x00,
+	OP_MCC_INIT_RX_PARAMS		=	0x01,
+	OP_MCC_INIT_TX_PARAMS		=	0x02,
+	OP_MCC_STOP_TX				=	0x04,
+	OP_MCC_STOP_RX				=	0x09
+
+} TYPE_CP_CMD_MCC;
+
+typedef enum
+{
+	OP_FCC_INIT_RX_TX_PARAMS	=	0x00,
+	OP_FCC_INIT_RX_PARAMS		=	0x01,
+	OP_FCC_INIT_TX_PARAMS		=	0x02,
+	OP_FCC_STOP_TX				=	0x04,	/* ATM: channel in CPCR[MCN] */
+	OP_FCC_GRACEFUL_STOP_TX		=	0x05,
+	OP_FCC_RESTART_TX			=	0x06,
+	OP_FCC_SET_GROUP_ADDRESS	=	0x08,	/* Ethernet: hashes TADDR into GADDR/IADDR */
+	OP_FCC_ATM_TRANSMIT			=	0x0a	/* ATM: channel in CPCR[MCN] */
+
+} TYPE_CP_CMD_FCC;
+
 
 /* ********** Parameter RAM Offset ********** */
 typedef enum
@@ -501,7 +630,9 @@ typedef enum
 	PG_SCC_4	=	0x88300,
 	PG_FCC_1	=	0x88400,
 	PG_FCC_2	=	0x88500,
-	PG_FCC_3	=	0x88600
+	PG_FCC_3	=	0x88600,
+	PG_MCC_1	=	0x88700,
+	PG_MCC_2	=	0x88800
 	/* TODO : will be continued */
 } TYPE_PRAM_PAGE; /* Parameter RAM Page Address Offset */
 
@@ -527,7 +658,531 @@ typedef enum
 
 } TYPE_SCC_PRAM_OFFSET; /* SCC Parameter RAM Offset */
 
+typedef enum
+{
+	UR_MAX_IDL	=	0x38,
+	UR_IDLC		=	0x3a,
+	UR_BRKCR	=	0x3c,
+	UR_PAREC	=	0x3e,	/* receive parity error counter */
+	UR_FRMEC	=	0x40,
+	UR_NOSEC	=	0x42,
+	UR_BRKEC	=	0x44,	/* receive break condition counter */
+	UR_BRKLN	=	0x46,
+	UR_UADDR1	=	0x48,	/* multidrop addresses */
+	UR_UADDR2	=	0x4a,
+	UR_RTEMP	=	0x4c,
+	UR_TOSEQ	=	0x4e,
+	UR_CHARACTER1	=	0x50,	/* control character table, up to CHARACTER8 */
+	UR_RCCM		=	0x60,	/* control character mask */
+	UR_RCCR		=	0x62,	/* last rejected control character */
+	UR_RLBC		=	0x64
+
+} TYPE_UART_PRAM_OFFSET; /* SCC UART Parameter RAM Offset */
+
+typedef enum
+{
+	BS_CRCC		=	0x34,
+	BS_PRCRC	=	0x38,	/* receive BCS preset */
+	BS_PTCRC	=	0x3a,	/* transmit BCS preset */
+	BS_PAREC	=	0x3c,
+	BS_BSYNC	=	0x3e,	/* SYNC character */
+	BS_BDLE		=	0x40,	/* DLE character */
+	BS_CHARACTER1	=	0x42,	/* control character table, up to CHARACTER8 */
+	BS_RCCM		=	0x52	/* control character mask */
+
+} TYPE_BISYNC_PRAM_OFFSET; /* SCC BISYNC Parameter RAM Offset */
+
+typedef enum
+{
+	MR_MCCBASE	=	0x00,	/* BD table base in external memory */
+	MR_MCCSTATE	=	0x04,
+	MR_MRBLR	=	0x06,	/* Max Receive Buffer Length, all channels */
+	MR_GRFTHR	=	0x08,
+	MR_GRFCNT	=	0x0a,
+	MR_TINTBASE	=	0x18,	/* TX interrupt circular table */
+	MR_TINTPTR	=	0x1c,
+	MR_XTRABASE	=	0x2c,	/* DPRAM offset of the TBASE/TBPTR/RBASE/RBPTR table */
+	MR_RINTBASE0	=	0x40,	/* RX interrupt circular table 0 */
+	MR_RINTPTR0	=	0x44
+
+} TYPE_MCC_PRAM_OFFSET; /* MCC Global Parameter RAM Offset */
+
+typedef enum
+{
+	MC_TSTATE	=	0x00,
+	MC_TBDFLAGS	=	0x10,
+	MC_TBDCNT	=	0x12,
+	MC_TBDPTR	=	0x14,
+	MC_INTMSK	=	0x18,	/* events that go to the interrupt tables */
+	MC_CHAMR	=	0x1a,	/* Channel mode register */
+	MC_TCRC		=	0x1c,
+	MC_RSTATE	=	0x20,
+	MC_RBDFLAGS	=	0x30,
+	MC_RBDCNT	=	0x32,
+	MC_RBDPTR	=	0x34,
+	MC_MFLR		=	0x38,	/* Max Frame Length */
+	MC_MAX_CNT	=	0x3a,
+	MC_RCRC		=	0x3c,
+	MC_SIZE		=	0x40	/* channel n lives at DPRAM1 + (n * 64) */
+
+} TYPE_MCC_CH_OFFSET; /* MCC Channel-Specific Parameter Offset */
+
+typedef enum
+{
+	MX_TBASE	=	0x0,	/* offsets relative to MCCBASE */
+	MX_TBPTR	=	0x2,
+	MX_RBASE	=	0x4,
+	MX_RBPTR	=	0x6,
+	MX_SIZE		=	0x8
+
+} TYPE_MCC_XTRA_OFFSET; /* MCC Extra Channel Parameter Offset */
+
+typedef enum
+{
+	MCC_TX_IDLE	=	0,	/* flags or idles, polling for a ready TxBD */
+	MCC_TX_DATA	=	1,
+	MCC_TX_FCS	=	2,
+	MCC_TX_CLOSE	=	3	/* closing flag */
+
+} TYPE_MCC_TX_STATE;
+
+typedef enum
+{
+	TAP_SCC_1	=	0,
+	TAP_SCC_2	=	1,
+	TAP_SCC_3	=	2,
+	TAP_SCC_4	=	3,
+	TAP_FCC_1	=	4,
+	TAP_FCC_2	=	5,
+	TAP_FCC_3	=	6,
+	TAP_MCC_1	=	7,	/* one pcapng interface per channel */
+	TAP_MCC_2	=	8,
+	CPM_NUM_TAPS	=	9
+
+} TYPE_CPM_TAP;
+
+typedef enum
+{
+	BLK_SCC_1	=	0,
+	BLK_SCC_2	=	1,
+	BLK_SCC_3	=	2,
+	BLK_SCC_4	=	3,
+	BLK_FCC_1	=	4,
+	BLK_FCC_2	=	5,
+	BLK_FCC_3	=	6,
+	BLK_MCC_1	=	7,	/* together with SI1 */
+	BLK_MCC_2	=	8,	/* together with SI2 */
+	BLK_INSTRAM	=	9,
+	CPM_NUM_BLOCKS	=	10
+
+} TYPE_CPM_BLOCK;	/* blocks that can be left out, see the has-* properties */
+
+typedef enum
+{
+	AP_INT_RCT_BASE	=	0x10,	/* DPRAM offset of the internal receive connection table */
+	AP_INT_TCT_BASE	=	0x12,	/* DPRAM offset of the internal transmit connection table */
+	AP_INTT_BASE	=	0x2c,	/* DPRAM offset of the interrupt queue table */
+	AP_BD_BASE_EXT	=	0x30	/* BD tables base in external memory */
+
+} TYPE_ATM_PRAM_OFFSET; /* FCC ATM Parameter RAM Offset, the subset used by the model */
+
+typedef enum
+{
+	FE_MRBLR	=	0x06,	/* maximum receive buffer length */
+	FE_RBASE	=	0x0c,	/* first RxBD, external memory */
+	FE_TBASE	=	0x1c,	/* first TxBD, external memory */
+	FE_RBPTR	=	0x28,	/* current RxBD */
+	FE_TBPTR	=	0x2c,	/* current TxBD */
+	FE_CRCEC	=	0x4c,	/* CRC error counter */
+	FE_DISFC	=	0x54,	/* discarded frame counter, no RxBD */
+	FE_GADDRH	=	0x60,	/* group address hash filter */
+	FE_GADDRL	=	0x64,
+	FE_MFLR		=	0x70,	/* maximum frame length */
+	FE_PADDRH	=	0x72,	/* station address, bytes 5 4 */
+	FE_PADDRM	=	0x74,	/* bytes 3 2 */
+	FE_PADDRL	=	0x76,	/* bytes 1 0 */
+	FE_IADDRH	=	0xa0,	/* individual address hash filter */
+	FE_IADDRL	=	0xa4,
+	FE_TADDRH	=	0xaa,	/* SET GROUP ADDRESS operand, same layout as PADDR */
+	FE_TADDRM	=	0xac,
+	FE_TADDRL	=	0xae
+
+} TYPE_FEN_PRAM_OFFSET; /* FCC Ethernet Parameter RAM Offset, the subset used by the model */
+
+typedef enum
+{
+	CT_FLAGS	=	0x00,	/* ATM_CT_AAL */
+	CT_CELL_HDR	=	0x04,	/* GFC/VPI/VCI/PTI/CLP of the connection */
+	CT_BD_BASE	=	0x08,	/* offsets relative to BD_BASE_EXT */
+	CT_BD_PTR	=	0x0a,
+	CT_MRBLR	=	0x0c,	/* RCT only */
+	CT_MAX_LEN	=	0x0e,	/* RCT only, max CPCS-PDU length */
+	CT_INTMSK	=	0x10,	/* events that go to the interrupt queue */
+	CT_SIZE		=	0x20
+
+} TYPE_ATM_CT_OFFSET; /* ATM RCT/TCT entry Offset */
+
+typedef enum
+{
+	INTQ_BASE	=	0x0,
+	INTQ_PTR	=	0x4,
+	INTQ_SIZE	=	0x8
+
+} TYPE_ATM_INTQ_OFFSET; /* ATM interrupt queue table entry Offset */
+
 typedef struct CPMState CPMState;
+
+typedef struct CPMIOPort CPMIOPort;
+struct CPMIOPort
+{
+	uint32_t pdir;	/* data direction register / RW / 0x0000_0000 */
+	uint32_t ppar;	/* pin assignment register / RW / 0x0000_0000 */
+	uint32_t psor;	/* special options register / RW / 0x0000_0000 */
+	uint32_t podr;	/* open drain register / RW / 0x0000_0000 */
+	uint32_t pdat;	/* data register / RW / 0x0000_0000 */
+
+	uint32_t pin_in;	/* levels driven onto the pins from the board side */
+	uint32_t pin_out;	/* levels last delivered to the gpio out lines */
+	uint32_t pin_claim;	/* pins consumed inside the device (MDIO), never delivered */
+};
+
+typedef struct CPMTap CPMTap;
+struct CPMTap
+{
+	CPMRing ring;	/* pcapng blocks, filled on the data path */
+	int on;
+	int fd;
+	int stop;
+	int idle;	/* the writer found the ring empty and sleeps, or is about to */
+	char* path;
+	QemuThread thread;
+	QemuSemaphore sem;	/* posted when data lands in a ring the writer left empty */
+	uint64_t dropped;	/* blocks lost to a full ring */
+	uint64_t werr;		/* writes that failed, their data is lost, atomic as the writer counts them */
+};
+
+typedef struct CPMSdma CPMSdma;
+struct CPMSdma
+{
+	uint32_t smaer;	/* (0x90050ULL) System bus address error register / R / 0x0000_0000 */
+	uint32_t smevr;	/* (0x90058ULL) System bus event register / RW / 0x0000_0000 */
+	uint32_t smctr;	/* (0x9005cULL) System bus control register / RW / 0x3800_0000 */
+	uint32_t lmaer;	/* (0x90060ULL) Local bus address error register / R / 0x0000_0000 */
+	uint32_t lmevr;	/* (0x90068ULL) Local bus event register / RW / 0x0000_0000 */
+	uint32_t lmctr;	/* (0x9006cULL) Local bus control register / RW / 0x3800_0000 */
+
+	uint64_t xfers;		/* transfers submitted */
+	uint64_t bytes;
+	uint64_t faults;
+};
+
+/* Host side only, neither reset nor migrated */
+typedef struct CPMChanStats CPMChanStats;
+struct CPMChanStats
+{
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint64_t rx_frames;
+	uint64_t tx_frames;
+	uint64_t rx_bds;	/* BDs handed back to the core */
+	uint64_t tx_bds;
+	uint64_t stalls;	/* receive held off waiting for an empty RxBD */
+	uint64_t overruns;	/* received data lost */
+	uint64_t crc_errors;
+	uint64_t irqs;		/* interrupts, or interrupt table entries, raised */
+	uint64_t commands;	/* CP commands issued to the channel */
+};
+
+/* event line raised -> guest clears the event, bucket n holds [2^n, 2^(n+1)) ns */
+typedef struct CPMIrqLatency CPMIrqLatency;
+struct CPMIrqLatency
+{
+	uint8_t pending;
+	int64_t vm_raised;
+	int64_t host_raised;
+	uint64_t vm_hist[CPM_LAT_BUCKETS];
+	uint64_t host_hist[CPM_LAT_BUCKETS];
+};
+
+/* SCCx, the registers and what every BD or event touches come first, the tables and timers after it */
+typedef struct CPMScc CPMScc;
+struct CPMScc
+{
+	/* GSMR_Lx ~ SCCSx */
+	uint32_t gsmr_l;
+	uint32_t gsmr_h;
+	uint16_t psmr;
+	uint16_t todr;
+	uint16_t dsr;
+	uint16_t scce;
+	uint16_t resv;	/* Errata Rev. 1 */
+	uint16_t sccm;
+	uint8_t sccs;
+
+	/* BD path */
+	uint8_t tx_blocked;
+	uint8_t rx_stalled;	/* data waits in rx_ring for an empty RxBD */
+	uint8_t uart_hunt;	/* automatic multidrop, skipping a message for another station */
+	uint8_t uart_brk_pending;
+	uint8_t rx_ov_pending;
+	uint8_t uart_data_mask;	/* character length */
+	uint8_t uart_xbit;	/* parity or address bit above the data, 0 for 8-bit characters */
+	uint8_t uart_md;	/* PSMR[UM] */
+	uint8_t uart_uaddr[2];
+	uint8_t idx;
+	uint32_t tx_done;	/* bytes of the ready TxBD the backend already took */
+	uint32_t uart_brk_at;	/* ring position the break was received at */
+	uint32_t rx_ov_at;	/* ring position data was lost at */
+	hwaddr rxbd;		/* RxBD being filled */
+	CPMState* s;
+	CharDriverState* chr;
+	guint tx_watch;		/* backend full, waiting for G_IO_OUT */
+	uint8_t rx_fifo_itl;	/* Interrupt trigger level for rx_ring */
+
+	/* UART receive classification, compiled from PSMR and the parameter RAM */
+	DECLARE_BITMAP(uart_special, 256) __attribute__((aligned(CPM_CACHELINE)));	/* raw character needs more than a copy */
+	DECLARE_BITMAP(uart_cc, 256);	/* matches the control character table */
+	DECLARE_BITMAP(uart_cc_rej, 256);	/* ... an entry with R set */
+
+	/* BISYNC, uart_special and uart_cc are shared with the UART */
+	DECLARE_BITMAP(bsc_cc_bcs, 256);	/* control character followed by a BCS */
+	DECLARE_BITMAP(bsc_cc_hunt, 256);	/* ... after which the receiver hunts for SYNC */
+	int16_t bsc_sync;	/* BSYNC, -1 when not valid */
+	int16_t bsc_dle;	/* BDLE, -1 when not valid */
+	uint16_t bsc_rx_crc;	/* BCS accumulated over the block */
+	uint16_t bsc_rx_bcs_in;	/* BCS as received */
+	uint8_t bsc_rx_dle;	/* transparent, the last character was DLE */
+	uint8_t bsc_rx_bcs;	/* BCS bytes still to come */
+	uint8_t bsc_rx_hunt_after;
+	uint16_t bsc_tx_crc;
+	uint8_t bsc_tx_open;	/* block in progress, its SYNs are out */
+	uint8_t bsc_tx_tail[4];	/* stuffed DLE, SYNs and BCS the line has not taken yet */
+	uint8_t bsc_tx_tail_len;
+
+	CPMRing rx_ring;	/* filled by the backend, drained into RxBDs */
+	CPMRing echo_ring;	/* DIAG echo, sent back out as the backend takes it */
+
+	/* Pacing and accounting */
+	QEMUTimer* fifo_timeout_timer;
+	QEMUTimer* status_poll;
+	QEMUTimer* bd_poll;	/* TxBD R bit poll, RxBD E bit while receive is stalled */
+	int64_t bd_poll_ns;	/* current interval, backs off while idle */
+	int64_t rx_stall_start;
+	uint64_t rx_stall_ns;	/* vm_clock time spent stalled */
+	CPMChanStats stats;
+	CPMIrqLatency irq_lat;
+};
+
+typedef struct CPMMccChannel CPMMccChannel;
+struct CPMMccChannel
+{
+	uint8_t tx_on;
+	uint8_t rx_on;
+	uint8_t hdlc;		/* CHAMR[MODE], transparent otherwise */
+	uint8_t crc32;		/* CHAMR[CRC] */
+
+	/* Transmitter, serial bits are queued LSB first */
+	uint8_t tx_state;	/* TYPE_MCC_TX_STATE */
+	uint8_t tx_qlen;
+	uint8_t tx_ones;
+	uint8_t tx_fcs_idx;
+	uint32_t tx_q;
+	uint32_t tx_crc;
+	hwaddr tx_bd;
+	hwaddr tx_ptr;
+	uint16_t tx_len;
+	uint16_t tx_off;
+	uint8_t tx_pf[CPM_SDMA_BURST];	/* prefetched TxBD data */
+	uint8_t tx_pf_pos;
+	uint8_t tx_pf_len;
+	GByteArray* tx_tap;	/* frame gathered for the capture, NULL until one runs */
+	uint32_t tx_tap_len;	/* bytes in that frame, beyond the snap length too */
+
+	/* Receiver */
+	uint8_t rx_hunt;	/* discarding until the next flag */
+	uint8_t rx_nacc;
+	uint8_t rx_ones;
+	uint8_t rx_first;	/* next closed BD is the first of its frame */
+	uint32_t rx_acc;
+	uint32_t rx_crc;
+	hwaddr rx_bd;		/* 0 while no RxBD is open */
+	hwaddr rx_ptr;
+	uint16_t rx_max;	/* MRBLR latched when the RxBD was opened */
+	uint16_t rx_cnt;	/* bytes in the open RxBD */
+	uint32_t rx_flen;	/* bytes in the current frame */
+	uint8_t rx_pf[CPM_SDMA_BURST];	/* RxBD data not yet written */
+	uint8_t rx_pf_len;
+	GByteArray* rx_tap;
+	uint32_t rx_tap_len;
+
+	CPMChanStats stats;
+};
+
+typedef struct CPMAtmChannel CPMAtmChannel;
+struct CPMAtmChannel
+{
+	uint8_t tx_on;
+	uint8_t tx_pad;		/* frame data done, padding up to the trailer */
+	uint8_t rx_on;
+	uint8_t rx_discard;	/* no RxBD, dropping up to the last cell */
+
+	/* AAL5 segmentation */
+	hwaddr tx_bd;		/* 0 while no TxBD is open */
+	uint16_t tx_len;
+	uint16_t tx_off;
+	uint32_t tx_flen;	/* CPCS-PDU payload bytes so far */
+	uint32_t tx_crc;
+
+	/* AAL5 reassembly */
+	hwaddr rx_bd;		/* 0 while no RxBD is open */
+	uint16_t rx_max;
+	uint16_t rx_cnt;
+	uint32_t rx_flen;	/* bytes received for the current CPCS-PDU */
+	uint32_t rx_crc;
+	uint8_t rx_first;
+};
+
+typedef struct CPMFcc CPMFcc;
+struct CPMFcc
+{
+	/* Ethernet BD path, receive filters are latched from the parameter RAM */
+	hwaddr eth_rbd;		/* RBPTR */
+	hwaddr eth_tbd;		/* TBPTR */
+	uint64_t eth_gaddr;	/* GADDRH:GADDRL, bit n is hash bin n */
+	uint64_t eth_iaddr;	/* IADDRH:IADDRL */
+	uint8_t eth_paddr[6];
+	uint16_t eth_mflr;
+	uint64_t eth_rx_filtered;	/* frames refused by the address filter, never DMA'd */
+	uint64_t eth_rx_discarded;	/* frames lost for lack of an RxBD, DISFC */
+
+	CPMChanStats stats;	/* Ethernet, or all ATM channels together */
+	CPMIrqLatency irq_lat;
+
+	CPMState* s;
+	uint8_t idx;
+
+	/* GFMRx ~ FCCSx */
+	uint32_t gfmr __attribute__((aligned(CPM_CACHELINE)));	/* GFMRx */
+	uint32_t fpsmr;	/* FPSMRx */
+	uint16_t ftodr;	/* FTODRx */
+	uint16_t fdsr;	/* FDSRx */
+	uint32_t fcce;	/* FCCEx */
+	uint32_t fccm;	/* FCCMx */
+	uint8_t fccs;	/* FCCSx */
+
+	/* ATM over UTOPIA, FCC1 ~ 2 only */
+	CharDriverState* chr;	/* 53 byte cells, back to back */
+	uint8_t rx_cell[CPM_ATM_CELL];
+	uint32_t rx_cell_len;
+	uint8_t* tx_batch;
+	CPMAtmChannel* atm_ch;	/* CPM_ATM_CHANNELS, allocated in realize for a present FCC1 ~ 2 */
+	int32_t atm_ch_num;	/* 0 while atm_ch is not allocated */
+	GHashTable* atm_lookup;	/* VPI/VCI -> channel + 1, built on INIT RX */
+	uint32_t tx_rr;		/* next channel served by the transmitter */
+
+	/* Ethernet backend */
+	NICConf conf;
+	NICState* nic;
+};
+
+/* TC layer block, counters are kept wide and only narrowed when the guest reads them */
+typedef struct CPMTc CPMTc;
+struct CPMTc
+{
+	uint16_t tcmode;	/* TCMODEx */
+	uint16_t cdsmr;		/* CDSMRx */
+	uint16_t tcer;		/* TCERx */
+	uint16_t tcmr;		/* TCMRx */
+
+	uint64_t rcc;	/* received cells */
+	uint64_t fcc;	/* filtered cells (no connection) */
+	uint64_t ccc;	/* HEC corrected cells */
+	uint64_t icc;	/* idle/unassigned cells */
+	uint64_t tcc;	/* transmitted cells */
+	uint64_t ecc;	/* HEC errored cells */
+};
+
+typedef struct CPMSiTdm CPMSiTdm;
+struct CPMSiTdm
+{
+	CharDriverState* chr;	/* framed timeslot data, back to back */
+	Fifo8 rx_fifo;
+	uint8_t* tx_batch;	/* CPM_TDM_TX_QUEUE, frames the backend has not taken yet come first */
+	uint32_t tx_pending;	/* bytes at the head of tx_batch */
+	guint tx_watch;		/* backend full, waiting for G_IO_OUT */
+	CPMState* s;
+	uint8_t si;
+	uint8_t idx;
+};
+
+/* One gather/scatter step of a compiled routing table, at most 8 bits of a MCC channel */
+typedef struct CPMSiSeg CPMSiSeg;
+struct CPMSiSeg
+{
+	uint16_t pos;	/* bit offset within the frame */
+	uint8_t nbits;
+	uint8_t ch;		/* channel within the MCC */
+};
+
+typedef struct CPMSiPlan CPMSiPlan;
+struct CPMSiPlan
+{
+	CPMSiSeg* seg;	/* CPM_SI_PLAN_MAX */
+	uint32_t nseg;
+	uint32_t bytes;	/* frame length */
+};
+
+typedef struct CPMSi CPMSi;
+struct CPMSi
+{
+	uint16_t mr[CPM_SI_TDMS];	/* SIxAMR ~ SIxDMR */
+	uint8_t gmr;	/* SIxGMR */
+	uint8_t cmdr;	/* SIxCMDR */
+	uint8_t str;	/* SIxSTR */
+	uint16_t rsr;	/* SIxRSR */
+
+	MemoryRegion ram_mmio;	/* SIxTxRAM and SIxRxRAM */
+	uint16_t txram[CPM_SI_RAM_ENTRIES];
+	uint16_t rxram[CPM_SI_RAM_ENTRIES];
+
+	/* compiled from the active tables, [TDM][0: Tx, 1: Rx] */
+	CPMSiPlan plan[CPM_SI_TDMS][2];
+	uint8_t plan_dirty;	/* SI_GMR_EN(t) layout */
+
+	CPMSiTdm tdm[CPM_SI_TDMS];
+};
+
+typedef struct CPMMcc CPMMcc;
+struct CPMMcc
+{
+	uint16_t mcce;	/* MCCx event register */
+	uint16_t mccm;	/* MCCx mask register */
+	uint8_t mccf;	/* MCCx configuration register */
+
+	CPMIrqLatency irq_lat;	/* one per MCC, its channels share MCCE */
+};
+
+typedef struct CPMMdio CPMMdio;
+struct CPMMdio
+{
+	/* Properties, pins are numbered (port * 32) + pin */
+	uint32_t mdc_pin;
+	uint32_t mdio_pin;
+	uint32_t phy_addr;
+
+	int mdc_port;		/* -1 when not attached, keeps the PDATx fast path to one compare */
+	int mdio_port;
+	uint32_t mdc_mask;
+	uint32_t mdio_mask;
+
+	uint32_t state;		/* TYPE_MDIO_STATE */
+	uint32_t count;		/* preamble ones, or bits of the current field */
+	uint32_t shift;
+	uint8_t reg;
+
+	uint16_t phy_regs[CPM_MDIO_NUM_REGS];
+};
+
 struct CPMState
 {
 	/*< private >*/
@@ -535,41 +1190,39 @@ struct CPMState
 
 	/*< public >*/
 	qemu_irq irq;	/* pin out to openpic */
-	
-	CharDriverState* serial_scc1;
-	Fifo8 recv_fifo_scc1;
-	uint8 recv_fifo_itl_scc1;	/* Interrupt trigger level for recv_fifo */
-	QEMUTimer* fifo_timeout_timer;
-	QEMUTimer* scc_status_poll;
+	qemu_irq ioport_out[CPM_IOPORT_GPIOS];	/* Port A ~ D pins, (port * 32) + pin */
 
 	MemoryRegion cpm_space;
 
+	/* Channel work queued from MMIO, run from the main loop */
+	QEMUBH* cp_bh;
+	uint32_t cp_work;	/* CP_WORK_* */
+	uint64_t cp_passes;
+	uint64_t cp_deferred;	/* passes where a channel ran out of budget */
+
 	/* Dual-Port RAM */
 	MemoryRegion dpram1;
 	MemoryRegion dpram2;
 
-	/* SIx RAM */
+	/* SIx RAM, see CPMSi */
 
 	/* Instruction RAM */
 	MemoryRegion dpinstram;
+	bool instram_trace;	/* log microcode downloads, through dirty tracking */
+
+	uint32_t blocks;	/* TYPE_CPM_BLOCK bits, a block left out gets no regions, timers or backends */
+
+	CPMTap tap[CPM_NUM_TAPS];	/* pcapng capture, set through the *-capture properties */
 
 	/* Regions for MMIO */
 	MemoryRegion whole_mmio;
 	MemoryRegion intctrl; 	/* Interrupt Controller */
 	MemoryRegion cp_mmio;
 	MemoryRegion sccx;		/* SCCx */
-
-	/* FIXME START: temporary, remove later this region */
-	MemoryRegion cpm_dpram_temp;
-	MemoryRegion cpinstemp;
-	
-	hwaddr cur_rxbd_addr;
-	uint16_t bd_status;
-	uint16_t bd_dlen;
-//	uint32_t bd_pbuf;
-//	uint32_t bd_buffer;
-
-	/* FIXME END */
+	MemoryRegion ioport_mmio;	/* Port A ~ D */
+	MemoryRegion si_mmio;	/* SI1, MCC1, SI2, MCC2 */
+	MemoryRegion fcc_mmio;	/* FCC1 ~ 3 */
+	MemoryRegion tc_mmio;	/* TC Layer 1 ~ 8, General */
 
 	/* Parameter RAM variables */
 
@@ -579,6 +1232,8 @@ struct CPMState
 	uint16_t cemr;
 
 	/* SDMA */
+	CPMSdma sdma;
+
 	/* Interrupt Controller */
 	uint32_t sicr;
 	uint32_t sivec;
@@ -594,26 +1249,21 @@ struct CPMState
 	uint32_t sccr;
 
 	/* Input/Output Port */
-	uint32_t pdirc;	/*	(0x90d40ULL) Port C data direction register / RW / 0x0000_0000 */
-	uint32_t pparc; /*	(0x90d44ULL) Port C pin assignment register / RW / 0x0000_0000 */
-	uint32_t psorc; /*	(0x90d48ULL) Port C special options register / RW / 0x0000_0000 */
-	uint32_t podrc; /*	(0x90d4cULL) Port C open drain register / RW / 0x0000_0000 */
-	uint32_t pdatc; /*	(0x90d50ULL) Port C data register / RW / 0x0000_0000 */
-	uint32_t pdird;	/*  (0x90d60ULL) Port D data direction register / RW / 0x0000_0000 */
-	uint32_t ppard; /*  (0x90d64ULL) Port D pin assignment register / RW / 0x0000_0000 */
-	uint32_t psord; /*  (0x90d68ULL) Port D special options register / RW / 0x0000_0000 */
-	uint32_t podrd; /*  (0x90d6cULL) Port D open drain register / RW / 0x0000_0000 */
-	uint32_t pdatd; /*  (0x90d70ULL) Port D data register / RW / 0x0000_0000 */
+	CPMIOPort ioport[CPM_NUM_IOPORTS];	/* (0x90d00ULL + 0x20 * port) Port A ~ D */
+	CPMMdio mdio;	/* PHY management bit-banged on port pins */
 
 	/* Timers */
 	/* FCC 1 ~ 3 */
+	CPMFcc fcc[CPM_NUM_FCC];
+	QEMUTimer* atm_timer;	/* one tick per CPM_ATM_BATCH_CELLS */
+
 	/* TC Layer 1 ~ 8, General */
+	CPMTc tc[CPM_NUM_TC];	/* TC n carries the cells of FCC n */
+	uint16_t tcgsr;	/* (0x91500ULL) TC general status register / RW / 0x0000 */
+	uint16_t tcger;	/* (0x91502ULL) TC general event register / RW / 0x0000 */
 	/* I2C */
 	/* BRGs 1 ~ 8 */
-	uint32_t brgc1;	/*	(0x919f0ULL) BRG1 configuration register / RW / 0x0000_0000 */
-	uint32_t brgc2; /*  (0x919f4ULL) BRG2 configuration register / RW / 0x0000_0000 */
-	uint32_t brgc3; /*  (0x919f8ULL) BRG3 configuration register / RW / 0x0000_0000 */
-	uint32_t brgc4; /*	(0x919fcULL) BRG4 configuration register / RW / 0x0000_0000 */
+	uint32_t brgc[CPM_NUM_BRG];	/* BRGC1 ~ 4 (0x919f0ULL), BRGC5 ~ 8 (0x915f0ULL) / RW / 0x0000_0000 */
 
 	/* Communications Processor */
 	uint32_t cpcr;
@@ -623,29 +1273,15 @@ struct CPMState
 	uint16_t rtscr;
 	uint16_t rtsr;
 
-	/* SCC1 */
-	uint32_t gsmr_l1;
-	uint32_t gsmr_h1;
-	uint16_t psmr1;
-	uint16_t todr1;
-	uint16_t dsr1;
-	uint16_t scce1;
-	uint16_t scc_resv1; /* Errata Rev. 1 */
-	uint16_t sccm1;
-	uint8_t sccs1;
-
-	/* SCC2 */
-	uint32_t gsmr_l2;
-	uint32_t gsmr_h2;
-	uint16_t psmr2;
-	uint16_t todr2;
-	uint16_t dsr2;
-	uint16_t scce2;
-	uint16_t sccm2;
-	uint8_t sccs2;
-
-	/* SCC3 */
-	/* SCC4 */
+	/* ****** SCC 1 ~ 4 ****** */
+	CPMScc scc[CPM_NUM_SCC];
+
+	/* ****** SI 1 ~ 2, MCC 1 ~ 2 ****** */
+	CPMSi si[CPM_NUM_SI];
+	CPMMcc mcc[CPM_NUM_MCC];
+	CPMMccChannel* mcc_ch;	/* CPM_MCC_CHANNELS, allocated in realize with MCC1 or MCC2, MCC2 starts at 128 */
+	int32_t mcc_ch_num;	/* 0 while mcc_ch is not allocated */
+	QEMUTimer* tdm_timer;	/* one tick per CPM_TDM_BATCH_FRAMES */
 
 	/* ****** CPM Mux ****** */
 	uint8_t cmxsi1cr; /* (0x91b00ULL) CPM mux SI1 clock route register / RW / 0x00 */
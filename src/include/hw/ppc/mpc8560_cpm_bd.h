@@ -0,0 +1,147 @@
+/*
+ * QEMU PowerPC MPC8560 communication processor module
+ * Buffer descriptor ring engine
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * *****************************************************************
+ *
+ * Walks a ring of 8 byte BDs (status, length, buffer pointer) without
+ * knowing where they live.  Every access goes through a CPMBdMem, so the
+ * same engine runs on guest memory in the device and on a plain byte
+ * array anywhere else.  The channel keeps its own notion of where the
+ * ring pointer is stored (parameter RAM, device state) and only hands the
+ * engine the base and current BD.
+ *
+ * Only <stdint.h> is needed, so the engine builds and is tested on its
+ * own (tests/mpc8560-cpm-bd-test.c).
+ *
+ */
+
+#if !defined (__MPC8560_CPM_BD__)
+#define __MPC8560_CPM_BD__
+/* ******************** HEADER (INCLUDE) SECTION ******************* */
+#include <stdint.h>
+/* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
+#define CPM_BD_SIZE		(0x8)
+#define CPM_BD_LEN		(0x2)	/* data length */
+#define CPM_BD_PTR		(0x4)	/* buffer pointer */
+
+/* status bits common to every protocol */
+#define CPM_BD_OWN		(0x8000)	/* RxBD E, TxBD R, the CP owns the BD */
+#define CPM_BD_W		(0x2000)	/* last BD in the ring */
+#define CPM_BD_I		(0x1000)	/* interrupt on close */
+#define CPM_BD_L		(0x0800)	/* last in frame */
+
+/* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
+typedef uint64_t cpm_bd_addr_t;	/* as wide as hwaddr, the accessors decide what it means */
+
+typedef struct CPMBdMem CPMBdMem;
+struct CPMBdMem
+{
+	uint16_t (*ld16)(void* opaque, cpm_bd_addr_t addr);
+	uint32_t (*ld32)(void* opaque, cpm_bd_addr_t addr);
+	void (*st16)(void* opaque, cpm_bd_addr_t addr, uint16_t value);
+	void* opaque;
+};
+
+typedef struct CPMBdRing CPMBdRing;
+struct CPMBdRing
+{
+	const CPMBdMem* mem;
+	cpm_bd_addr_t base;	/* where W takes the ring back to */
+	cpm_bd_addr_t cur;	/* BD the channel works on */
+};
+
+/* one BD as fetched, status is what it was when fetched */
+typedef struct CPMBd CPMBd;
+struct CPMBd
+{
+	cpm_bd_addr_t addr;
+	uint16_t status;
+	uint16_t len;
+	uint32_t ptr;
+};
+
+/* ************************* CODE SECTION ************************** */
+static inline void cpm_bd_ring_init(CPMBdRing* r, const CPMBdMem* mem, cpm_bd_addr_t base, cpm_bd_addr_t cur)
+{
+	r->mem = mem;
+	r->base = base;
+	r->cur = cur;
+
+	return ;
+}
+
+static inline uint16_t cpm_bd_status(CPMBdRing* r)
+{
+	return r->mem->ld16(r->mem->opaque, r->cur);
+}
+
+/**
+ * @fn static inline int cpm_bd_fetch(CPMBdRing* r, CPMBd* bd)
+ * @brief Reads the current BD, returns non-zero when the CP owns it
+ *
+ * Length and pointer are only read for an owned BD, the guest may still
+ * be filling in one it has not handed over.
+ */
+static inline int cpm_bd_fetch(CPMBdRing* r, CPMBd* bd)
+{
+	const CPMBdMem* m = r->mem;
+
+	bd->addr = r->cur;
+	bd->status = m->ld16(m->opaque, r->cur);
+	if (!(bd->status & CPM_BD_OWN))
+		return 0;
+	else { /* QAC */ }
+	bd->len = m->ld16(m->opaque, r->cur + CPM_BD_LEN);
+	bd->ptr = m->ld32(m->opaque, r->cur + CPM_BD_PTR);
+
+	return 1;
+}
+
+static inline void cpm_bd_set_len(CPMBdRing* r, const CPMBd* bd, uint16_t len)
+{
+	r->mem->st16(r->mem->opaque, bd->addr + CPM_BD_LEN, len);
+
+	return ;
+}
+
+/**
+ * @fn static inline void cpm_bd_next(CPMBdRing* r, uint16_t status)
+ * @brief Moves to the BD after one with the given status, W wraps to base
+ *
+ */
+static inline void cpm_bd_next(CPMBdRing* r, uint16_t status)
+{
+	if (status & CPM_BD_W)
+		r->cur = r->base;
+	else
+		r->cur = r->cur + CPM_BD_SIZE;
+
+	return ;
+}
+
+/**
+ * @fn static inline uint16_t cpm_bd_close(CPMBdRing* r, const CPMBd* bd, uint16_t clear, uint16_t set)
+ * @brief Hands a BD back to the core and moves on, returns the status written
+ *
+ * The status is read again first, so bits the core changed while the CP
+ * held the BD (I, W) are the ones that count.
+ */
+static inline uint16_t cpm_bd_close(CPMBdRing* r, const CPMBd* bd, uint16_t clear, uint16_t set)
+{
+	const CPMBdMem* m = r->mem;
+	uint16_t status = m->ld16(m->opaque, bd->addr);
+
+	status = (status & ~(CPM_BD_OWN | clear)) | set;
+	m->st16(m->opaque, bd->addr, status);
+	cpm_bd_next(r, status);
+
+	return status;
+}
+
+#endif /* !defined (__MPC8560_CPM_BD__) */
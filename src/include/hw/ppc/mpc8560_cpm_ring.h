@@ -0,0 +1,155 @@
+/*
+ * QEMU PowerPC MPC8560 communication processor module
+ * Single-producer/single-consumer byte ring between backends and channel engines
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * *****************************************************************
+ *
+ * One side only ever moves head (the backend pushing received data), the
+ * other only ever moves tail (the engine draining it into BDs), so neither
+ * needs a lock.  Both indices run free and are masked on use; the ring is
+ * full when they are size apart.
+ *
+ */
+
+#if !defined (__MPC8560_CPM_RING__)
+#define __MPC8560_CPM_RING__
+/* ******************** HEADER (INCLUDE) SECTION ******************* */
+#include "qemu-common.h"
+#include "qemu/atomic.h"
+/* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
+#define CPM_RING_CACHELINE	(64)
+
+/* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
+typedef struct CPMRing CPMRing;
+struct CPMRing
+{
+	/* producer */
+	uint32_t head;
+	uint8_t pad_head[CPM_RING_CACHELINE - sizeof(uint32_t)];
+
+	/* consumer */
+	uint32_t tail;
+	uint8_t pad_tail[CPM_RING_CACHELINE - sizeof(uint32_t)];
+
+	/* fixed once created */
+	uint8_t* data;
+	uint32_t size;	/* power of two */
+};
+
+/* ************************* CODE SECTION ************************** */
+static inline void cpm_ring_create(CPMRing* r, uint32_t size)
+{
+	assert(size && !(size & (size - 1)));
+
+	r->data = g_malloc(size);
+	r->size = size;
+	r->head = 0;
+	r->tail = 0;
+
+	return ;
+}
+
+static inline void cpm_ring_destroy(CPMRing* r)
+{
+	g_free(r->data);
+	r->data = NULL;
+
+	return ;
+}
+
+/* only while neither side runs, e.g. on reset */
+static inline void cpm_ring_reset(CPMRing* r)
+{
+	r->head = 0;
+	r->tail = 0;
+
+	return ;
+}
+
+static inline uint32_t cpm_ring_used(CPMRing* r)
+{
+	return atomic_read(&(r->head)) - atomic_read(&(r->tail));
+}
+
+static inline uint32_t cpm_ring_free(CPMRing* r)
+{
+	return r->size - cpm_ring_used(r);
+}
+
+/**
+ * @fn static inline uint32_t cpm_ring_push(CPMRing* r, const uint8_t* buf, uint32_t n)
+ * @brief Producer side, copies as much of buf as fits and returns that count
+ *
+ */
+static inline uint32_t cpm_ring_push(CPMRing* r, const uint8_t* buf, uint32_t n)
+{
+	uint32_t head = r->head;
+	uint32_t off = head & (r->size - 1);
+	uint32_t first;
+
+	n = MIN(n, r->size - (head - atomic_read(&(r->tail))));
+	first = MIN(n, r->size - off);
+	memcpy(r->data + off, buf, first);
+	memcpy(r->data, buf + first, n - first);
+
+	/* data must be visible before the consumer sees the new head */
+	smp_wmb();
+	atomic_set(&(r->head), head + n);
+
+	return n;
+}
+
+/**
+ * @fn static inline uint32_t cpm_ring_peek(CPMRing* r, uint8_t* buf, uint32_t n)
+ * @brief Consumer side, copies up to n bytes out but leaves them queued
+ *
+ */
+static inline uint32_t cpm_ring_peek(CPMRing* r, uint8_t* buf, uint32_t n)
+{
+	uint32_t tail = r->tail;
+	uint32_t off = tail & (r->size - 1);
+	uint32_t first;
+
+	n = MIN(n, atomic_read(&(r->head)) - tail);
+	/* no byte is read before the head that covers it */
+	smp_rmb();
+	first = MIN(n, r->size - off);
+	memcpy(buf, r->data + off, first);
+	memcpy(buf + first, r->data, n - first);
+
+	return n;
+}
+
+/**
+ * @fn static inline void cpm_ring_drop(CPMRing* r, uint32_t n)
+ * @brief Consumer side, releases n bytes already peeked
+ *
+ */
+static inline void cpm_ring_drop(CPMRing* r, uint32_t n)
+{
+	/* the copy must be done before the producer may reuse the space */
+	smp_mb();
+	atomic_set(&(r->tail), r->tail + n);
+
+	return ;
+}
+
+/**
+ * @fn static inline uint32_t cpm_ring_pop(CPMRing* r, uint8_t* buf, uint32_t n)
+ * @brief Consumer side, copies up to n bytes out and returns that count
+ *
+ */
+static inline uint32_t cpm_ring_pop(CPMRing* r, uint8_t* buf, uint32_t n)
+{
+	n = cpm_ring_peek(r, buf, n);
+	cpm_ring_drop(r, n);
+
+	return n;
+}
+
+#endif /* !defined (__MPC8560_CPM_RING__) */
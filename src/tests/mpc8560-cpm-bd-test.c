@@ -0,0 +1,324 @@
+/*
+ * QEMU PowerPC MPC8560 communication processor module
+ * Buffer descriptor ring engine tests
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * *****************************************************************
+ *
+ * Runs hw/ppc/mpc8560_cpm_bd.h on a plain byte array laid out like DPRAM,
+ * big endian, no QEMU involved. The test plays the core, handing BDs over
+ * and back, the engine plays the CP.
+ *
+ * The walk benchmark prints one JSON line like the qtest benchmarks:
+ *
+ *   cpm-bench: {"bench":"bd_walk","block":"bd","ops":...,"ns":...,"rate":...}
+ *
+ * Built and run by "make check-unit", see tests/Makefile.mpc8560-cpm.
+ */
+
+/* ******************** HEADER (INCLUDE) SECTION ******************* */
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw/ppc/mpc8560_cpm_bd.h"
+/* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
+#define MEM_SIZE			(0x1000)
+#define RING_BASE			(0x100)	/* not at 0, W has to take the ring back here */
+#define NUM_BD				(4)
+#define BUF_BASE			(0x10000000)
+
+#define BENCH_NUM_BD		(64)
+#define BENCH_BDS			(4 * 1000 * 1000)
+
+/* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
+typedef struct BdMem BdMem;
+struct BdMem
+{
+	uint8_t b[MEM_SIZE];
+	unsigned ld16;	/* accesses, to see what the engine looks at */
+	unsigned ld32;
+	unsigned st16;
+};
+
+/* ************************* CODE SECTION ************************** */
+static uint16_t bd_ld16(void* opaque, cpm_bd_addr_t addr)
+{
+	BdMem* m = (BdMem*)opaque;
+
+	g_assert_cmpuint(addr + 2, <=, MEM_SIZE);
+	m->ld16++;
+
+	return (m->b[addr] << 8) | m->b[addr + 1];
+}
+
+static uint32_t bd_ld32(void* opaque, cpm_bd_addr_t addr)
+{
+	BdMem* m = (BdMem*)opaque;
+
+	g_assert_cmpuint(addr + 4, <=, MEM_SIZE);
+	m->ld32++;
+
+	return ((uint32_t)m->b[addr] << 24) | (m->b[addr + 1] << 16) | (m->b[addr + 2] << 8) | m->b[addr + 3];
+}
+
+static void bd_st16(void* opaque, cpm_bd_addr_t addr, uint16_t value)
+{
+	BdMem* m = (BdMem*)opaque;
+
+	g_assert_cmpuint(addr + 2, <=, MEM_SIZE);
+	m->st16++;
+	m->b[addr] = value >> 8;
+	m->b[addr + 1] = value;
+
+	return ;
+}
+
+/* the core side, written straight into the array */
+static void core_put16(BdMem* m, cpm_bd_addr_t addr, uint16_t value)
+{
+	m->b[addr] = value >> 8;
+	m->b[addr + 1] = value;
+
+	return ;
+}
+
+static uint16_t core_get16(BdMem* m, cpm_bd_addr_t addr)
+{
+	return (m->b[addr] << 8) | m->b[addr + 1];
+}
+
+static cpm_bd_addr_t bd_addr(int i)
+{
+	return RING_BASE + (i * CPM_BD_SIZE);
+}
+
+/**
+ * @fn static void bd_setup(BdMem* m, CPMBdMem* mem, CPMBdRing* r, int nbd, uint16_t flags)
+ * @brief Lays out a ring of nbd BDs at RING_BASE, W on the last, every BD with the given flags
+ *
+ */
+static void bd_setup(BdMem* m, CPMBdMem* mem, CPMBdRing* r, int nbd, uint16_t flags)
+{
+	uint32_t ptr;
+	int i;
+
+	memset(m, 0, sizeof(*m));
+	for (i = 0; i < nbd; i++) {
+		ptr = BUF_BASE + (i * 0x100);
+		core_put16(m, bd_addr(i), flags | ((i == nbd - 1) ? CPM_BD_W : 0));
+		core_put16(m, bd_addr(i) + CPM_BD_LEN, 0x10 + i);
+		core_put16(m, bd_addr(i) + CPM_BD_PTR, ptr >> 16);
+		core_put16(m, bd_addr(i) + CPM_BD_PTR + 2, ptr);
+	}
+	mem->ld16 = bd_ld16;
+	mem->ld32 = bd_ld32;
+	mem->st16 = bd_st16;
+	mem->opaque = m;
+	cpm_bd_ring_init(r, mem, RING_BASE, RING_BASE);
+
+	return ;
+}
+
+static void test_bd_wrap(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	int i;
+
+	bd_setup(&m, &mem, &r, NUM_BD, 0);
+	for (i = 0; i < NUM_BD; i++) {
+		g_assert_cmpuint(r.cur, ==, bd_addr(i));
+		cpm_bd_next(&r, cpm_bd_status(&r));
+	}
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+
+	/* W moved up by the core shortens the ring */
+	core_put16(&m, bd_addr(1), CPM_BD_W);
+	cpm_bd_next(&r, cpm_bd_status(&r));
+	cpm_bd_next(&r, cpm_bd_status(&r));
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+
+	/* a one BD ring stays where it is */
+	bd_setup(&m, &mem, &r, 1, 0);
+	cpm_bd_next(&r, cpm_bd_status(&r));
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+
+	return ;
+}
+
+static void test_bd_fetch(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	CPMBd bd;
+
+	bd_setup(&m, &mem, &r, NUM_BD, CPM_BD_OWN);
+	cpm_bd_next(&r, cpm_bd_status(&r));
+	g_assert(cpm_bd_fetch(&r, &bd));
+	g_assert_cmpuint(bd.addr, ==, bd_addr(1));
+	g_assert_cmpuint(bd.status, ==, CPM_BD_OWN);
+	g_assert_cmpuint(bd.len, ==, 0x11);
+	g_assert_cmpuint(bd.ptr, ==, BUF_BASE + 0x100);
+	/* fetching does not move on */
+	g_assert_cmpuint(r.cur, ==, bd_addr(1));
+
+	cpm_bd_set_len(&r, &bd, 0x1234);
+	g_assert_cmpuint(core_get16(&m, bd_addr(1) + CPM_BD_LEN), ==, 0x1234);
+	g_assert_cmpuint(core_get16(&m, bd_addr(1)), ==, CPM_BD_OWN);
+
+	return ;
+}
+
+static void test_bd_close(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	CPMBd bd;
+	uint16_t status;
+
+	bd_setup(&m, &mem, &r, NUM_BD, CPM_BD_OWN | 0x0003);
+	g_assert(cpm_bd_fetch(&r, &bd));
+
+	/* I set by the core while the CP holds the BD is what the close sees */
+	core_put16(&m, bd_addr(0), CPM_BD_OWN | CPM_BD_I | 0x0003);
+	status = cpm_bd_close(&r, &bd, 0x0001, CPM_BD_L);
+	g_assert_cmpuint(status, ==, CPM_BD_I | CPM_BD_L | 0x0002);
+	g_assert_cmpuint(core_get16(&m, bd_addr(0)), ==, status);
+	g_assert_cmpuint(r.cur, ==, bd_addr(1));
+
+	/* nor is I made up, L only when asked for */
+	g_assert(cpm_bd_fetch(&r, &bd));
+	status = cpm_bd_close(&r, &bd, 0, 0);
+	g_assert_cmpuint(status, ==, 0x0003);
+	g_assert(!(status & (CPM_BD_I | CPM_BD_L)));
+
+	/* W read at the close wraps, even when the core set it late */
+	g_assert(cpm_bd_fetch(&r, &bd));
+	core_put16(&m, bd_addr(2), CPM_BD_OWN | CPM_BD_W);
+	status = cpm_bd_close(&r, &bd, 0, CPM_BD_L);
+	g_assert_cmpuint(status, ==, CPM_BD_W | CPM_BD_L);
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+
+	return ;
+}
+
+static void test_bd_empty(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	CPMBd bd;
+	int i;
+
+	bd_setup(&m, &mem, &r, NUM_BD, 0);
+	for (i = 0; i < NUM_BD; i++) {
+		m.ld16 = 0;
+		m.ld32 = 0;
+		g_assert(!cpm_bd_fetch(&r, &bd));
+		g_assert_cmpuint(bd.addr, ==, bd_addr(i));
+		/* the core may be filling it in, only the status is looked at */
+		g_assert_cmpuint(m.ld16, ==, 1);
+		g_assert_cmpuint(m.ld32, ==, 0);
+		cpm_bd_next(&r, bd.status);
+	}
+	g_assert_cmpuint(m.st16, ==, 0);
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+
+	return ;
+}
+
+static void test_bd_full(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	CPMBd bd;
+	int n;
+
+	/* every BD handed over, the CP takes them all in one lap and stops at base */
+	bd_setup(&m, &mem, &r, NUM_BD, CPM_BD_OWN | CPM_BD_I);
+	for (n = 0; cpm_bd_fetch(&r, &bd); n++) {
+		g_assert_cmpint(n, <, NUM_BD);
+		g_assert_cmpuint(bd.addr, ==, bd_addr(n));
+		cpm_bd_close(&r, &bd, 0, CPM_BD_L);
+	}
+	g_assert_cmpint(n, ==, NUM_BD);
+	g_assert_cmpuint(r.cur, ==, RING_BASE);
+	for (n = 0; n < NUM_BD; n++)
+		g_assert_cmpuint(core_get16(&m, bd_addr(n)),
+				==, CPM_BD_I | CPM_BD_L | ((n == NUM_BD - 1) ? CPM_BD_W : 0));
+
+	/* one BD handed back, the CP picks up exactly that one */
+	core_put16(&m, bd_addr(0), CPM_BD_OWN);
+	g_assert(cpm_bd_fetch(&r, &bd));
+	cpm_bd_close(&r, &bd, 0, 0);
+	g_assert(!cpm_bd_fetch(&r, &bd));
+	g_assert_cmpuint(bd.addr, ==, bd_addr(1));
+
+	return ;
+}
+
+static int64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((int64_t)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/**
+ * @fn static void test_bench_bd_walk(void)
+ * @brief Fetch and close throughput, the core hands every BD straight back
+ *
+ */
+static void test_bench_bd_walk(void)
+{
+	static BdMem m;
+	CPMBdMem mem;
+	CPMBdRing r;
+	CPMBd bd;
+	int64_t start;
+	int64_t ns;
+	int i;
+
+	bd_setup(&m, &mem, &r, BENCH_NUM_BD, CPM_BD_OWN);
+	start = bench_now();
+	for (i = 0; i < BENCH_BDS; i++) {
+		g_assert(cpm_bd_fetch(&r, &bd));
+		cpm_bd_set_len(&r, &bd, bd.len);
+		cpm_bd_close(&r, &bd, 0, CPM_BD_L);
+		core_put16(&m, bd.addr, CPM_BD_OWN | ((bd.addr == bd_addr(BENCH_NUM_BD - 1)) ? CPM_BD_W : 0));
+	}
+	ns = bench_now() - start;
+	printf("cpm-bench: {\"bench\":\"bd_walk\",\"block\":\"bd\",\"ops\":%d,\"ns\":%" PRId64
+			",\"rate\":%.1f,\"unit\":\"bds/s\"}\n",
+			BENCH_BDS, ns, ns ? ((double)BENCH_BDS * 1e9) / ns : 0.0);
+	fflush(stdout);
+
+	return ;
+}
+
+int main(int argc, char** argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/mpc8560-cpm-bd/wrap", test_bd_wrap);
+	g_test_add_func("/mpc8560-cpm-bd/fetch", test_bd_fetch);
+	g_test_add_func("/mpc8560-cpm-bd/close", test_bd_close);
+	g_test_add_func("/mpc8560-cpm-bd/empty", test_bd_empty);
+	g_test_add_func("/mpc8560-cpm-bd/full", test_bd_full);
+	g_test_add_func("/mpc8560-cpm-bd/bench/walk", test_bench_bd_walk);
+
+	return g_test_run();
+}
@@ -0,0 +1,370 @@
+/*
+ * QEMU PowerPC MPC8560 communication processor module
+ * qtest performance benchmarks
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * *****************************************************************
+ *
+ * Drives the CPM registers and the DPRAM BD rings straight from the host,
+ * no guest firmware runs. SCC1 is attached to a unix socket through the
+ * "scc1" property, so the test is both ends of the line.
+ *
+ * Every result is one JSON object per line on stdout, prefixed with
+ * "cpm-bench: " so it can be picked out of the gtester log:
+ *
+ *   cpm-bench: {"bench":"mmio","block":"scc1","ops":20000,"ns":...,"rate":...}
+ *
+ * MMIO numbers include the qtest round trip, they are meant to be compared
+ * between QEMU versions on one host, not read as guest access costs.
+ *
+ * The board that instantiates the CPM is not part of this tree, set
+ * QTEST_CPM_MACHINE to its machine name (default "mpc8560"). Built and run
+ * by "make check-qtest-ppc" once tests/Makefile includes
+ * tests/Makefile.mpc8560-cpm.
+ */
+
+/* ******************** HEADER (INCLUDE) SECTION ******************* */
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "libqtest.h"
+/* ************* MACROS, CONSTANTS, COMPILATION FLAGS ************** */
+/* mirrored from hw/ppc/mpc8560_cpm.h, qtest programs do not include device headers */
+#define CCSRBAR				(0xE1000000ULL)
+#define CCSR(off)			(CCSRBAR + (off))
+#define DPRAM1(off)			(CCSR(0x80000ULL) + (off))
+#define SCC1_PRAM(off)		(CCSR(0x88000ULL) + (off))
+
+#define REG_SIVEC			(0x90c04ULL)
+#define REG_SIPNR_L			(0x90c0cULL)
+#define REG_SIMR_L			(0x90c20ULL)
+#define REG_PDATA			(0x90d10ULL)
+#define REG_GFMR1			(0x91300ULL)
+#define REG_CPCR			(0x919c0ULL)
+#define REG_BRGC1			(0x919f0ULL)
+#define REG_GSMR_L1			(0x91a00ULL)
+#define REG_TODR1			(0x91a0cULL)
+#define REG_SCCE1			(0x91a10ULL)
+#define REG_SCCM1			(0x91a14ULL)
+
+#define PRAM_RBASE			(0x00)
+#define PRAM_TBASE			(0x02)
+#define PRAM_MRBLR			(0x06)
+
+#define IC_SCC_1			(40)
+#define SC_SCC_1			(0x04)
+#define CPCR_FLG			(0x00010000)
+#define OP_INIT_RX_TX		(0x0)
+
+#define BENCH_MMIO_OPS		(20000)
+#define BENCH_TX_BYTES		(256 * 1024)
+#define BENCH_RX_ROUNDS		(200)
+#define BENCH_IRQ_ROUNDS	(200)
+#define BENCH_POLL_LIMIT	(100000)	/* register reads before a round is given up */
+
+#define RXBD_OFF			(0x000)	/* DPRAM1 */
+#define TXBD_OFF			(0x100)
+#define NUM_BD				(8)
+#define BD_BUF_LEN			(1024)
+#define RX_BUF				(0x00100000ULL)	/* guest RAM */
+#define TX_BUF				(RX_BUF + (NUM_BD * BD_BUF_LEN))
+
+#define BD_OWN				(0x8000)	/* RxBD E, TxBD R */
+#define BD_W				(0x2000)
+#define BD_I				(0x1000)
+
+#define GSMR_L_UART_EN		(0x00000034)	/* MODE UART, ENT, ENR */
+#define SCCE_RX				(0x0001)
+#define SCCE_TX				(0x0002)
+#define CPCR_SCC1_INIT		((SC_SCC_1 << 21) | CPCR_FLG | OP_INIT_RX_TX)
+#define SIMR_L_SCC1			(0x1U << (63 - IC_SCC_1))
+#define SIVEC_CODE(v)		((v) >> 26)
+#define SCC1_TICK_NS		(10 * 1000 * 1000)	/* SCC1 drains received data every 10ms */
+
+/* ***************** STRUCTURES, TYPE DEFINITIONS ****************** */
+typedef struct BenchReg BenchReg;
+struct BenchReg
+{
+	const char* block;
+	uint64_t addr;
+	int width;	/* bytes */
+};
+
+/* ************************** GLOBAL DATA ************************** */
+static char sock_path[] = "/tmp/cpm-bench-XXXXXX";
+static int sock_fd = -1;
+static int tx_next;	/* TxBD the CP looks at next */
+static int rx_next;
+
+static const BenchReg bench_regs[] = {
+	{ "scc1",	CCSR(REG_SCCM1),	2 },
+	{ "brg",	CCSR(REG_BRGC1),	4 },
+	{ "sic",	CCSR(REG_SIMR_L),	4 },
+	{ "ioport",	CCSR(REG_PDATA),	4 },
+	{ "fcc1",	CCSR(REG_GFMR1),	4 },
+	{ "dpram1",	DPRAM1(0x800),			4 },
+};
+
+/* ************************* CODE SECTION ************************** */
+static int64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((int64_t)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+static void bench_report(const char* bench, const char* block, uint64_t ops, int64_t ns, const char* unit)
+{
+	printf("cpm-bench: {\"bench\":\"%s\",\"block\":\"%s\",\"ops\":%" PRIu64 ",\"ns\":%" PRId64
+			",\"rate\":%.1f,\"unit\":\"%s\"}\n",
+			bench, block, ops, ns, ns ? ((double)ops * 1e9) / ns : 0.0, unit);
+	fflush(stdout);
+
+	return ;
+}
+
+static void bench_report_latency(const char* bench, int64_t* lat, int n)
+{
+	int64_t sum = 0;
+	int64_t min = lat[0];
+	int64_t max = lat[0];
+	int i;
+
+	for (i = 0; i < n; i++) {
+		sum += lat[i];
+		min = MIN(min, lat[i]);
+		max = MAX(max, lat[i]);
+	}
+	printf("cpm-bench: {\"bench\":\"%s\",\"block\":\"scc1\",\"rounds\":%d,\"min_ns\":%" PRId64
+			",\"avg_ns\":%" PRId64 ",\"max_ns\":%" PRId64 "}\n",
+			bench, n, min, n ? (sum / n) : 0, max);
+	fflush(stdout);
+
+	return ;
+}
+
+/**
+ * @fn static void bench_scc1_setup(void)
+ * @brief UART SCC1 with NUM_BD RxBDs and TxBDs, the SCC1 interrupt unmasked
+ *
+ */
+static void bench_scc1_setup(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_BD; i++) {
+		writew(DPRAM1(RXBD_OFF + (i * 8)), BD_OWN | BD_I | ((i == NUM_BD - 1) ? BD_W : 0));
+		writew(DPRAM1(RXBD_OFF + (i * 8) + 2), 0);
+		writel(DPRAM1(RXBD_OFF + (i * 8) + 4), RX_BUF + (i * BD_BUF_LEN));
+		writew(DPRAM1(TXBD_OFF + (i * 8)), (i == NUM_BD - 1) ? BD_W : 0);
+		writew(DPRAM1(TXBD_OFF + (i * 8) + 2), 0);
+		writel(DPRAM1(TXBD_OFF + (i * 8) + 4), TX_BUF + (i * BD_BUF_LEN));
+	}
+	writew(SCC1_PRAM(PRAM_RBASE), RXBD_OFF);
+	writew(SCC1_PRAM(PRAM_TBASE), TXBD_OFF);
+	writew(SCC1_PRAM(PRAM_MRBLR), BD_BUF_LEN);
+	writel(CCSR(REG_CPCR), CPCR_SCC1_INIT);
+
+	writew(CCSR(REG_SCCM1), SCCE_RX | SCCE_TX);
+	writew(CCSR(REG_SCCE1), 0xffff);
+	writel(CCSR(REG_SIMR_L), SIMR_L_SCC1);
+	writel(CCSR(REG_GSMR_L1), GSMR_L_UART_EN);
+
+	return ;
+}
+
+/**
+ * @fn static uint64_t bench_tx_bd(uint16_t len, uint16_t flags)
+ * @brief Hands the next TxBD over to the CP and asks for it straight away, returns its address
+ *
+ */
+static uint64_t bench_tx_bd(uint16_t len, uint16_t flags)
+{
+	const uint64_t bd = DPRAM1(TXBD_OFF + (tx_next * 8));
+
+	writew(bd + 2, len);
+	writew(bd, BD_OWN | flags | ((tx_next == NUM_BD - 1) ? BD_W : 0));
+	writew(CCSR(REG_TODR1), 0x8000);
+	tx_next = (tx_next + 1) % NUM_BD;
+
+	return bd;
+}
+
+static void test_bench_mmio(void)
+{
+	const BenchReg* r;
+	uint32_t v;
+	int64_t start;
+	int i;
+	int k;
+
+	for (k = 0; k < G_N_ELEMENTS(bench_regs); k++) {
+		r = &(bench_regs[k]);
+		/* the value read is written back, no block changes mode under the other benchmarks */
+		v = (r->width == 2) ? readw(r->addr) : readl(r->addr);
+		start = bench_now();
+		for (i = 0; i < BENCH_MMIO_OPS; i++) {
+			if (r->width == 2) {
+				writew(r->addr, v);
+				v = readw(r->addr);
+			} else {
+				writel(r->addr, v);
+				v = readl(r->addr);
+			}
+		}
+		bench_report("mmio", r->block, 2 * BENCH_MMIO_OPS, bench_now() - start, "ops/s");
+	}
+
+	return ;
+}
+
+static void test_bench_scc_tx(void)
+{
+	uint8_t buf[BD_BUF_LEN];
+	uint64_t got = 0;
+	uint64_t bd;
+	int64_t start;
+	ssize_t n;
+	int polls;
+	int i;
+
+	memset(buf, 0x5a, sizeof(buf));
+	for (i = 0; i < NUM_BD; i++)
+		memwrite(TX_BUF + (i * BD_BUF_LEN), buf, sizeof(buf));
+
+	start = bench_now();
+	while (got < BENCH_TX_BYTES) {
+		bd = bench_tx_bd(BD_BUF_LEN, 0);
+		for (polls = 0; (readw(bd) & BD_OWN) && (polls < BENCH_POLL_LIMIT); polls++)
+			;
+		g_assert(!(readw(bd) & BD_OWN));
+		n = recv(sock_fd, buf, sizeof(buf), MSG_WAITALL);
+		g_assert_cmpint(n, ==, BD_BUF_LEN);
+		got += n;
+	}
+	bench_report("scc_tx", "scc1", got, bench_now() - start, "bytes/s");
+
+	return ;
+}
+
+static void test_bench_scc_rx_latency(void)
+{
+	int64_t lat[BENCH_RX_ROUNDS];
+	uint64_t bd;
+	int64_t start;
+	uint8_t c = 0xa5;
+	int polls;
+	int i;
+
+	for (i = 0; i < BENCH_RX_ROUNDS; i++) {
+		bd = DPRAM1(RXBD_OFF + (rx_next * 8));
+		start = bench_now();
+		g_assert_cmpint(send(sock_fd, &c, 1, 0), ==, 1);
+		for (polls = 0; (readw(bd) & BD_OWN) && (polls < BENCH_POLL_LIMIT); polls++)
+			clock_step(SCC1_TICK_NS);
+		lat[i] = bench_now() - start;
+		g_assert(!(readw(bd) & BD_OWN));
+		g_assert_cmpint(readw(bd + 2), ==, 1);
+
+		/* back to the CP */
+		writew(bd, BD_OWN | BD_I | ((rx_next == NUM_BD - 1) ? BD_W : 0));
+		rx_next = (rx_next + 1) % NUM_BD;
+		writew(CCSR(REG_SCCE1), SCCE_RX);
+		writel(CCSR(REG_SIPNR_L), SIMR_L_SCC1);
+	}
+	bench_report_latency("scc_rx_latency", lat, BENCH_RX_ROUNDS);
+
+	return ;
+}
+
+static void test_bench_irq_latency(void)
+{
+	int64_t lat[BENCH_IRQ_ROUNDS];
+	uint8_t c;
+	int64_t start;
+	int polls;
+	int i;
+
+	/* nothing left pending from the other benchmarks */
+	writew(CCSR(REG_SCCE1), 0xffff);
+	writel(CCSR(REG_SIPNR_L), SIMR_L_SCC1);
+	for (i = 0; i < BENCH_IRQ_ROUNDS; i++) {
+		start = bench_now();
+		bench_tx_bd(1, BD_I);
+		for (polls = 0; (SIVEC_CODE(readl(CCSR(REG_SIVEC))) != IC_SCC_1) && (polls < BENCH_POLL_LIMIT); polls++)
+			;
+		lat[i] = bench_now() - start;
+		g_assert_cmpint(SIVEC_CODE(readl(CCSR(REG_SIVEC))), ==, IC_SCC_1);
+		g_assert_cmpint(recv(sock_fd, &c, 1, MSG_WAITALL), ==, 1);
+
+		/* acknowledge, SCCE first and then SIPNR */
+		writew(CCSR(REG_SCCE1), SCCE_TX);
+		writel(CCSR(REG_SIPNR_L), SIMR_L_SCC1);
+	}
+	bench_report_latency("irq_latency", lat, BENCH_IRQ_ROUNDS);
+
+	return ;
+}
+
+static int bench_connect(const char* path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	g_assert(fd >= 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	g_assert_cmpint(connect(fd, (struct sockaddr*)&addr, sizeof(addr)), ==, 0);
+
+	return fd;
+}
+
+int main(int argc, char** argv)
+{
+	const char* machine = getenv("QTEST_CPM_MACHINE");
+	QTestState* s;
+	char* args;
+	int fd;
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	fd = mkstemp(sock_path);
+	g_assert(fd >= 0);
+	close(fd);
+	unlink(sock_path);
+
+	args = g_strdup_printf("-machine %s -chardev socket,id=scc1,path=%s,server,nowait"
+			" -global mpc8560-cpm.scc1=scc1", machine ? machine : "mpc8560", sock_path);
+	s = qtest_start(args);
+	sock_fd = bench_connect(sock_path);
+	bench_scc1_setup();
+
+	g_test_add_func("/mpc8560-cpm/bench/mmio", test_bench_mmio);
+	g_test_add_func("/mpc8560-cpm/bench/scc-tx", test_bench_scc_tx);
+	g_test_add_func("/mpc8560-cpm/bench/scc-rx-latency", test_bench_scc_rx_latency);
+	g_test_add_func("/mpc8560-cpm/bench/irq-latency", test_bench_irq_latency);
+	ret = g_test_run();
+
+	close(sock_fd);
+	qtest_quit(s);
+	unlink(sock_path);
+	g_free(args);
+
+	return ret;
+}